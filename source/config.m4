@@ -17,6 +17,11 @@ PHP_ARG_ENABLE(hdb, whether to enable hdb support,
 Make sure that the comment is aligned:
 [  --enable-hdb           Enable hdb support])
 
+PHP_ARG_ENABLE(hdb-fetch-arena, whether to allocate hdb field values from the fetch arena,
+[  --disable-hdb-fetch-arena
+                          Allocate the field values hdb returns one by one
+                          instead of from their statement's fetch arena], yes, no)
+
 if test "$PHP_HDB" != "no"; then
     hdb_src_class="\
            conn.cpp \
@@ -29,6 +34,7 @@ if test "$PHP_HDB" != "no"; then
            shared/core_results.cpp \
            shared/core_stream.cpp \
            shared/core_init.cpp \ 
+           shared/core_pool.cpp \
            shared/core_stmt.cpp \
            shared/core_util.cpp \
            shared/FormattedPrint.cpp \
@@ -56,6 +62,9 @@ if test "$PHP_HDB" != "no"; then
   dnl PHP_ADD_LIBRARY(odbcHDB, 1, HDB_SHARED_LIBADD)
   PHP_SUBST(HDB_SHARED_LIBADD)
   AC_DEFINE(HAVE_HDB, 1, [ ])
+  if test "$PHP_HDB_FETCH_ARENA" != "no"; then
+      AC_DEFINE(HDB_FETCH_ARENA, 1, [Allocate the field values hdb returns from their statement's fetch arena])
+  fi
   PHP_ADD_INCLUDE($hdb_shared_path)
   PHP_ADD_INCLUDE($hdb_common_path)
   dnl PHP_SUBST(HDB_SHARED_LIBADD)
@@ -130,8 +130,38 @@ struct bool_conn_attr_func {
     }
 };
 
+struct stmt_cache_size_func {
+
+    static void func( connection_option const* /*option*/, _In_ zval* value, _Inout_ hdb_conn* conn, std::string& /*conn_str*/ )
+    {
+        CHECK_CUSTOM_ERROR(( Z_LVAL_P( value ) < 0 ), conn, SS_HDB_ERROR_INVALID_STMT_CACHE_SIZE ) {
+            throw ss::SSException();
+        }
+
+        // a size of zero leaves the cache disabled
+        if( Z_LVAL_P( value ) > 0 ) {
+            core_hdb_enable_stmt_cache( conn, Z_LVAL_P( value ));
+        }
+    }
+};
+
+// turns on the HANA driver's CHAR_AS_UTF8 property, so SQL_C_CHAR data is exchanged as UTF-8 and UTF-8 string
+// fields can be read without the round trip through UTF-16
+struct char_as_utf8_func {
+
+    static void func( _In_ connection_option const* option, _In_ zval* value, _Inout_ hdb_conn* conn, _Out_ std::string& conn_str )
+    {
+        conn->char_as_utf8 = ( zend_is_true( value ) != 0 );
+        if( conn->char_as_utf8 ) {
+            conn_str += option->odbc_name;
+            conn_str += "=TRUE;";
+        }
+    }
+};
+
 //// *** internal functions ***
 
+void connect_common( INTERNAL_FUNCTION_PARAMETERS, _In_z_ const char* func, _In_ bool persistent );
 void hdb_conn_close_stmts( _Inout_ ss_hdb_conn* conn );
 void validate_conn_options( _Inout_ hdb_context& ctx, _In_ zval* user_options_z, _Inout_ char** uid, _Inout_ char** pwd, 
                             _Inout_ HashTable* ss_conn_options_ht );
@@ -158,7 +188,10 @@ const char* ss_hdb_conn::resource_name = "ss_hdb_conn";
 
 namespace SSStmtOptionNames {
     const char QUERY_TIMEOUT[]= "QueryTimeout";
+    const char SCROLLABLE[] = "Scrollable";
     const char CLIENT_BUFFER_MAX_SIZE[] = INI_BUFFERED_QUERY_LIMIT;
+    const char STREAM_CHUNK_SIZE[] = "StreamChunkSize";
+    const char PREFETCH_ROWS[] = "PrefetchRows";
 }
 
 namespace SSConnOptionNames {
@@ -167,11 +200,16 @@ namespace SSConnOptionNames {
 // and the name put into the connection string. MARS is the only one that's different.
 const char PWD[] = "PWD";
 const char UID[] = "UID";
+const char StatementCacheSize[] = "StatementCacheSize";
+const char CharAsUtf8[] = "CharAsUtf8";
+const char CHAR_AS_UTF8[] = "CHAR_AS_UTF8";
 }
 
 enum SS_CONN_OPTIONS {
     
     SS_CONN_OPTION_DATE_AS_STRING = HDB_CONN_OPTION_DRIVER_SPECIFIC,
+    SS_CONN_OPTION_STMT_CACHE_SIZE,
+    SS_CONN_OPTION_CHAR_AS_UTF8,
 };
 
 //List of all statement options supported by this driver
@@ -188,6 +226,24 @@ const stmt_option SS_STMT_OPTS[] = {
     //    HDB_STMT_OPTION_CLIENT_BUFFER_MAX_SIZE, 
     //    std::unique_ptr<stmt_option_buffered_query_limit>( new stmt_option_buffered_query_limit )
     //},
+    {
+        SSStmtOptionNames::SCROLLABLE,
+        sizeof( SSStmtOptionNames::SCROLLABLE ),
+        HDB_STMT_OPTION_SCROLLABLE,
+        std::unique_ptr<stmt_option_ss_scrollable>( new stmt_option_ss_scrollable )
+    },
+    {
+        SSStmtOptionNames::STREAM_CHUNK_SIZE,
+        sizeof( SSStmtOptionNames::STREAM_CHUNK_SIZE ),
+        HDB_STMT_OPTION_STREAM_CHUNK_SIZE,
+        std::unique_ptr<stmt_option_stream_chunk_size>( new stmt_option_stream_chunk_size )
+    },
+    {
+        SSStmtOptionNames::PREFETCH_ROWS,
+        sizeof( SSStmtOptionNames::PREFETCH_ROWS ),
+        HDB_STMT_OPTION_PREFETCH_ROWS,
+        std::unique_ptr<stmt_option_prefetch_rows>( new stmt_option_prefetch_rows )
+    },
     { NULL, 0, HDB_STMT_OPTION_INVALID, std::unique_ptr<stmt_option_functor>{} },
 };
 
@@ -203,6 +259,24 @@ const connection_option SS_CONN_OPTS[] = {
     //    CONN_ATTR_BOOL,
     //    date_as_string_func::func
     //},
+    {
+        SSConnOptionNames::StatementCacheSize,
+        sizeof( SSConnOptionNames::StatementCacheSize ),
+        SS_CONN_OPTION_STMT_CACHE_SIZE,
+        SSConnOptionNames::StatementCacheSize,
+        sizeof( SSConnOptionNames::StatementCacheSize ),
+        CONN_ATTR_INT,
+        stmt_cache_size_func::func
+    },
+    {
+        SSConnOptionNames::CharAsUtf8,
+        sizeof( SSConnOptionNames::CharAsUtf8 ),
+        SS_CONN_OPTION_CHAR_AS_UTF8,
+        SSConnOptionNames::CHAR_AS_UTF8,
+        sizeof( SSConnOptionNames::CHAR_AS_UTF8 ),
+        CONN_ATTR_BOOL,
+        char_as_utf8_func::func
+    },
     { NULL, 0, HDB_CONN_OPTION_INVALID, NULL, 0 , CONN_ATTR_INVALID, NULL },  //terminate the table
 };
 
@@ -228,77 +302,32 @@ const connection_option SS_CONN_OPTS[] = {
 
 PHP_FUNCTION ( hdb_connect ) 
 {
-    
     LOG_FUNCTION( "hdb_connect" );
-    SET_FUNCTION_NAME( *g_ss_henv_cp );
-    SET_FUNCTION_NAME( *g_ss_henv_ncp );
-
-    reset_errors( );
 
-    const char* server = NULL;
-    zval* options_z = NULL;
-    char* uid = NULL;
-    char* pwd = NULL;
-    size_t server_len = 0;
-    zval conn_z;
-    ZVAL_UNDEF(&conn_z);
-    // get the server name and connection options
-    int result = zend_parse_parameters( ZEND_NUM_ARGS(), "s|a", &server, &server_len, &options_z );
-    
-    CHECK_CUSTOM_ERROR(( result == FAILURE ), *g_ss_henv_cp, SS_HDB_ERROR_INVALID_FUNCTION_PARAMETER, "hdb_connect" ) {
-        RETURN_FALSE;
-    }
-    
-    hash_auto_ptr ss_conn_options_ht;
-    hash_auto_ptr stmts;
-    ss_hdb_conn* conn = NULL;
-
-    try {
-
-        // Initialize the options array to be passed to the core layer
-        ALLOC_HASHTABLE( ss_conn_options_ht );
-        
-        core::hdb_zend_hash_init( *g_ss_henv_cp, ss_conn_options_ht, 10 /* # of buckets */, 
-                                 ZVAL_PTR_DTOR, 0 /*persistent*/ );
-   
-        // Either of g_ss_henv_cp or g_ss_henv_ncp can be used to propagate the error.
-        ::validate_conn_options( *g_ss_henv_cp, options_z, &uid, &pwd, ss_conn_options_ht );   
-     
-        // call the core connect function  
-        conn = static_cast<ss_hdb_conn*>( core_hdb_connect( *g_ss_henv_cp, *g_ss_henv_ncp, &core::allocate_conn<ss_hdb_conn>,
-                                                                  server, uid, pwd, ss_conn_options_ht, ss_error_handler,  
-                                                                  SS_CONN_OPTS, NULL, "hdb_connect" )); 
-        
-        HDB_ASSERT( conn != NULL, "hdb_connect: Invalid connection returned.  Exception should have been thrown." );
-        
-        // create a bunch of statements
-        ALLOC_HASHTABLE( stmts );
-    
-        core::hdb_zend_hash_init( *g_ss_henv_cp, stmts, 5, NULL /* dtor */, 0 /* persistent */ );
-
-        // register the connection with the PHP runtime 
-        
-        ss::zend_register_resource(conn_z, conn, ss_hdb_conn::descriptor, ss_hdb_conn::resource_name);
-
-        conn->stmts = stmts;
-        stmts.transferred();
-        RETURN_RES( Z_RES(conn_z) );
-    }
-    
-    catch( core::CoreException& ) {
-        
-        if( conn != NULL ) {
-         
-            conn->invalidate();
-        }
+    connect_common( INTERNAL_FUNCTION_PARAM_PASSTHRU, _FN_, false /*persistent*/ );
+}
 
-        RETURN_FALSE;
-    }
+// hdb_pconnect( string $serverName [, array $connectionInfo])
+//
+// Returns a connection resource like hdb_connect, but the connection outlives the
+// request.  When the connection is closed (or the request ends), its transaction is
+// rolled back, autocommit is turned back on and its session variables are unset, and
+// it is kept in a pool shared by the requests of the process.  A later call to
+// hdb_pconnect with the same server and connection options reuses it instead of
+// connecting again, as long as the connection is still alive.
+//
+// Parameters
+// The same as hdb_connect.
+//
+// Return Value
+// A PHP connection resource. If a connection cannot be successfully created and
+// opened, false is returned
 
-    catch( ... ) {
+PHP_FUNCTION ( hdb_pconnect )
+{
+    LOG_FUNCTION( "hdb_pconnect" );
 
-        DIE("hdb_connect: Unknown exception caught.");
-    }
+    connect_common( INTERNAL_FUNCTION_PARAM_PASSTHRU, _FN_, true /*persistent*/ );
 }
 
 // hdb_begin_transaction( resource $conn )
@@ -634,6 +663,45 @@ PHP_FUNCTION( hdb_server_info )
     }
 }
 
+// hdb_stmt_cache_stats( resource $conn )
+//
+// Returns how the connection's prepared statement cache is being used.  The
+// cache is enabled by the StatementCacheSize connection option.
+//
+// Parameters
+// $conn: The connection resource the cache belongs to.
+//
+// Return Value
+// An associative array with the following keys:
+//  Size
+//      The number of prepared statements the cache keeps at most (0 if disabled).
+//  Entries
+//      The number of prepared statements currently kept.
+//  Hits
+//      The number of calls to hdb_prepare that reused a cached statement.
+//  Misses
+//      The number of calls to hdb_prepare that prepared the statement on the server.
+
+PHP_FUNCTION( hdb_stmt_cache_stats )
+{
+    LOG_FUNCTION( "hdb_stmt_cache_stats" );
+
+    ss_hdb_conn* conn = NULL;
+    PROCESS_PARAMS( conn, "r", _FN_, 0 );
+
+    try {
+
+        core_hdb_get_stmt_cache_stats( conn, return_value );
+    }
+    catch( core::CoreException& ) {
+        RETURN_FALSE;
+    }
+    catch( ... ) {
+
+        DIE( "hdb_stmt_cache_stats: Unknown exception caught." );
+    }
+}
+
 
 // hdb_prepare( resource $conn, string $tsql [, array $params [, array $options]])
 // 
@@ -663,6 +731,14 @@ PHP_FUNCTION( hdb_server_info )
 //      Configures the driver to send all stream data at execution (true), or to
 //      send stream data in chunks (false). By default, the value is set to
 //      true. For more information, see hdb_send_stream_data.
+//   StreamChunkSize
+//      The most bytes read from a stream parameter and sent to the server at
+//      a time, from 1 to 4194304 (4 MB). By default, 8192 bytes are sent at a
+//      time.
+//   PrefetchRows
+//      The most rows of a forward only result set fetched from the server at
+//      a time, from 1 to 65536. By default, up to 64 rows are fetched at a
+//      time. Result sets with LOB columns are always fetched a row at a time.
 //
 // Return Value
 // A statement resource. If the statement resource cannot be created, false is returned.
@@ -710,11 +786,10 @@ PHP_FUNCTION( hdb_prepare )
             DIE( "hdb_prepare: sql string was null." );
         }
 
-        stmt = static_cast<ss_hdb_stmt*>( core_hdb_create_stmt( conn, core::allocate_stmt<ss_hdb_stmt>, 
-                                                                      ss_stmt_options_ht, SS_STMT_OPTS, 
-                                                                      ss_error_handler, NULL ) );
-       
-        core_hdb_prepare( stmt, sql, sql_len );
+        // the statement comes from the connection's statement cache when it has one and the SQL was prepared before
+        stmt = static_cast<ss_hdb_stmt*>( core_hdb_create_prepared_stmt( conn, core::allocate_stmt<ss_hdb_stmt>, sql, sql_len,
+                                                                               ss_stmt_options_ht, SS_STMT_OPTS,
+                                                                               ss_error_handler, NULL ) );
         
         if (params_z) {
             stmt->params_z = (zval *)hdb_malloc(sizeof(zval));
@@ -785,6 +860,14 @@ PHP_FUNCTION( hdb_prepare )
 //      Configures the driver to send all stream data at execution (true), or to
 //      send stream data in chunks (false). By default, the value is set to
 //      true. For more information, see hdb_send_stream_data.
+//   StreamChunkSize
+//      The most bytes read from a stream parameter and sent to the server at
+//      a time, from 1 to 4194304 (4 MB). By default, 8192 bytes are sent at a
+//      time.
+//   PrefetchRows
+//      The most rows of a forward only result set fetched from the server at
+//      a time, from 1 to 65536. By default, up to 64 rows are fetched at a
+//      time. Result sets with LOB columns are always fetched a row at a time.
 //
 // Return Value
 // A statement resource. If the statement resource cannot be created, false is returned.
@@ -893,6 +976,82 @@ void free_stmt_resource( _Inout_ zval* stmt_z )
 
 namespace {    
 
+// opens a connection for hdb_connect and hdb_pconnect, taking it from the persistent connection pool
+// when persistent is true
+
+void connect_common( INTERNAL_FUNCTION_PARAMETERS, _In_z_ const char* func, _In_ bool persistent )
+{
+    g_ss_henv_cp->set_func( func );
+    g_ss_henv_ncp->set_func( func );
+
+    reset_errors( );
+
+    const char* server = NULL;
+    zval* options_z = NULL;
+    char* uid = NULL;
+    char* pwd = NULL;
+    size_t server_len = 0;
+    zval conn_z;
+    ZVAL_UNDEF(&conn_z);
+    // get the server name and connection options
+    int result = zend_parse_parameters( ZEND_NUM_ARGS(), "s|a", &server, &server_len, &options_z );
+    
+    CHECK_CUSTOM_ERROR(( result == FAILURE ), *g_ss_henv_cp, SS_HDB_ERROR_INVALID_FUNCTION_PARAMETER, func ) {
+        RETURN_FALSE;
+    }
+    
+    hash_auto_ptr ss_conn_options_ht;
+    hash_auto_ptr stmts;
+    ss_hdb_conn* conn = NULL;
+
+    try {
+
+        // Initialize the options array to be passed to the core layer
+        ALLOC_HASHTABLE( ss_conn_options_ht );
+        
+        core::hdb_zend_hash_init( *g_ss_henv_cp, ss_conn_options_ht, 10 /* # of buckets */, 
+                                 ZVAL_PTR_DTOR, 0 /*persistent*/ );
+   
+        // Either of g_ss_henv_cp or g_ss_henv_ncp can be used to propagate the error.
+        ::validate_conn_options( *g_ss_henv_cp, options_z, &uid, &pwd, ss_conn_options_ht );   
+     
+        // call the core connect function  
+        conn = static_cast<ss_hdb_conn*>( core_hdb_connect( *g_ss_henv_cp, *g_ss_henv_ncp, &core::allocate_conn<ss_hdb_conn>,
+                                                                  server, uid, pwd, ss_conn_options_ht, ss_error_handler,  
+                                                                  SS_CONN_OPTS, NULL, func, persistent )); 
+        
+        HDB_ASSERT( conn != NULL, "connect_common: Invalid connection returned.  Exception should have been thrown." );
+        
+        // create a bunch of statements
+        ALLOC_HASHTABLE( stmts );
+    
+        core::hdb_zend_hash_init( *g_ss_henv_cp, stmts, 5, NULL /* dtor */, 0 /* persistent */ );
+
+        // register the connection with the PHP runtime 
+        
+        ss::zend_register_resource(conn_z, conn, ss_hdb_conn::descriptor, ss_hdb_conn::resource_name);
+
+        conn->stmts = stmts;
+        stmts.transferred();
+        RETURN_RES( Z_RES(conn_z) );
+    }
+    
+    catch( core::CoreException& ) {
+        
+        if( conn != NULL ) {
+         
+            conn->invalidate();
+        }
+
+        RETURN_FALSE;
+    }
+
+    catch( ... ) {
+
+        DIE( "%1!s!: Unknown exception caught.", func );
+    }
+}
+
 // must close all statement handles opened by this connection before closing the connection
 // no errors are returned, since close should always succeed
 
@@ -56,6 +56,12 @@ ZEND_BEGIN_ARG_INFO_EX( hdb_client_info_arginfo, 0, 0, 1 )
     ZEND_ARG_INFO( 0, conn )
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX( hdb_copy_field_to_stream_arginfo, 0, 0, 3 )
+    ZEND_ARG_INFO( 0, stmt )
+    ZEND_ARG_INFO( 0, field_index )
+    ZEND_ARG_INFO( 0, stream )
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX( hdb_commit_arginfo, 0, 0, 1 )
     ZEND_ARG_INFO( 0, conn )
 ZEND_END_ARG_INFO()
@@ -78,10 +84,25 @@ ZEND_BEGIN_ARG_INFO_EX( hdb_execute_arginfo, 0, 0, 1 )
     ZEND_ARG_INFO( 0, stmt )
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX( hdb_execute_batch_arginfo, 0, 0, 2 )
+    ZEND_ARG_INFO( 0, stmt )
+    ZEND_ARG_ARRAY_INFO( 0, rows, 0 )
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX( hdb_execute_async_arginfo, 0, 0, 1 )
+    ZEND_ARG_INFO( 0, stmt )
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX( hdb_fetch_arginfo, 0, 0, 1 )
     ZEND_ARG_INFO( 0, stmt )
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX( hdb_fetch_all_arginfo, 0, 0, 1 )
+    ZEND_ARG_INFO( 0, stmt )
+    ZEND_ARG_INFO( 0, fetch_type )
+    ZEND_ARG_INFO( 0, max_rows )
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX( hdb_fetch_array_arginfo, 0, 0, 1 )
     ZEND_ARG_INFO( 0, stmt )
     ZEND_ARG_INFO( 0, fetch_type )
@@ -131,6 +152,10 @@ ZEND_BEGIN_ARG_INFO( hdb_num_rows_arginfo, 0 )
     ZEND_ARG_INFO( 0, stmt )
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX( hdb_poll_arginfo, 0, 0, 1 )
+    ZEND_ARG_INFO( 0, stmt )
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX( hdb_prepare_arginfo, 0, 0, 2 )
     ZEND_ARG_INFO( 0, conn )
     ZEND_ARG_INFO( 0, tsql )
@@ -161,6 +186,15 @@ ZEND_BEGIN_ARG_INFO( hdb_server_info_arginfo, 0 )
     ZEND_ARG_INFO( 0, stmt )
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX( hdb_stmt_cache_stats_arginfo, 0, 0, 1 )
+    ZEND_ARG_INFO( 0, conn )
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX( hdb_wait_arginfo, 0, 0, 1 )
+    ZEND_ARG_ARRAY_INFO( 0, stmts, 0 )
+    ZEND_ARG_INFO( 0, timeout )
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO( hdb_sqltype_size_arginfo, 0 )
     ZEND_ARG_INFO( 0, size )
 ZEND_END_ARG_INFO()
@@ -177,6 +211,7 @@ ZEND_END_ARG_INFO()
 // function table with associated arginfo structures
 zend_function_entry hdb_functions[] = {
     PHP_FE( hdb_connect, hdb_connect_arginfo )
+    PHP_FE( hdb_pconnect, hdb_connect_arginfo )
     PHP_FE( hdb_close, hdb_close_arginfo )
     PHP_FE( hdb_commit, hdb_commit_arginfo )
     PHP_FE( hdb_begin_transaction, hdb_begin_transaction_arginfo )
@@ -186,9 +221,15 @@ zend_function_entry hdb_functions[] = {
     PHP_FE( hdb_get_config, hdb_get_config_arginfo )
     PHP_FE( hdb_prepare, hdb_prepare_arginfo )
     PHP_FE( hdb_execute, hdb_execute_arginfo )
+    PHP_FE( hdb_execute_batch, hdb_execute_batch_arginfo )
+    PHP_FE( hdb_execute_async, hdb_execute_async_arginfo )
+    PHP_FE( hdb_poll, hdb_poll_arginfo )
+    PHP_FE( hdb_wait, hdb_wait_arginfo )
     PHP_FE( hdb_query, hdb_query_arginfo )
     PHP_FE( hdb_fetch, hdb_fetch_arginfo )
     PHP_FE( hdb_get_field, hdb_get_field_arginfo )
+    PHP_FE( hdb_copy_field_to_stream, hdb_copy_field_to_stream_arginfo )
+    PHP_FE( hdb_fetch_all, hdb_fetch_all_arginfo )
     PHP_FE( hdb_fetch_array, hdb_fetch_array_arginfo )
     PHP_FE( hdb_fetch_object, hdb_fetch_object_arginfo )
     PHP_FE( hdb_has_rows, hdb_has_rows_arginfo )
@@ -200,6 +241,7 @@ zend_function_entry hdb_functions[] = {
     PHP_FE( HDB_PHPTYPE_STRING, hdb_phptype_encoding_arginfo )
     PHP_FE( hdb_client_info, hdb_client_info_arginfo )
     PHP_FE( hdb_server_info, hdb_server_info_arginfo )
+    PHP_FE( hdb_stmt_cache_stats, hdb_stmt_cache_stats_arginfo )
     PHP_FE( hdb_cancel, hdb_cancel_arginfo )
     PHP_FE( hdb_free_stmt, hdb_close_arginfo )
     PHP_FE( hdb_field_metadata, hdb_field_metadata_arginfo )
@@ -235,10 +277,55 @@ zend_module_entry g_hdb_module_entry =
     PHP_MODULE_GLOBALS(hdb),
     NULL,           
     NULL,
-    NULL,
+    ZEND_MODULE_POST_ZEND_DEACTIVATE_N(hdb),
     STANDARD_MODULE_PROPERTIES_EX
 };
 
+namespace {
+
+// Read the policies of the persistent connection pool from the INI entries.  An unknown validation mode is logged
+// and the default is used instead.
+void configure_conn_pool( void )
+{
+    // INI_INT needs the sizeof(param), so the names are copied into arrays (see PHP_RINIT)
+    char min_idle[] = INI_PREFIX INI_POOL_MIN_IDLE;
+    char max_idle[] = INI_PREFIX INI_POOL_MAX_IDLE;
+    char max_lifetime[] = INI_PREFIX INI_POOL_MAX_LIFETIME;
+    char idle_timeout[] = INI_PREFIX INI_POOL_IDLE_TIMEOUT;
+    char validation[] = INI_PREFIX INI_POOL_VALIDATION;
+
+    hdb_pool_policy policy;
+    policy.min_idle = std::max<zend_long>( INI_INT( min_idle ), 0 );
+    policy.max_idle = std::max<zend_long>( INI_INT( max_idle ), 0 );
+    policy.max_lifetime = std::max<zend_long>( INI_INT( max_lifetime ), 0 );
+    policy.idle_timeout = std::max<zend_long>( INI_INT( idle_timeout ), 0 );
+    policy.validation = HDB_POOL_VALIDATE_CONNECTION_DEAD;
+
+    const char* mode = INI_STR( validation );
+    if( mode == NULL || !stricmp( mode, INI_POOL_VALIDATION_CONNECTION_DEAD )) {
+        policy.validation = HDB_POOL_VALIDATE_CONNECTION_DEAD;
+    }
+    else if( !stricmp( mode, INI_POOL_VALIDATION_NONE )) {
+        policy.validation = HDB_POOL_VALIDATE_NONE;
+    }
+    else if( !stricmp( mode, INI_POOL_VALIDATION_QUERY )) {
+        policy.validation = HDB_POOL_VALIDATE_QUERY;
+    }
+    else {
+        LOG( SEV_ERROR, INI_PREFIX INI_POOL_VALIDATION " = %1!s! is not a valid validation mode.  Using "
+             INI_POOL_VALIDATION_CONNECTION_DEAD " instead.", mode );
+    }
+
+    LOG( SEV_NOTICE, INI_PREFIX INI_POOL_MIN_IDLE " = %1!d!", policy.min_idle );
+    LOG( SEV_NOTICE, INI_PREFIX INI_POOL_MAX_IDLE " = %1!d!", policy.max_idle );
+    LOG( SEV_NOTICE, INI_PREFIX INI_POOL_MAX_LIFETIME " = %1!d!", policy.max_lifetime );
+    LOG( SEV_NOTICE, INI_PREFIX INI_POOL_IDLE_TIMEOUT " = %1!d!", policy.idle_timeout );
+
+    core_hdb_pool_configure( policy );
+}
+
+}
+
 // Module initialization
 // This function is called once per execution of the Zend engine
 // We use it to:
@@ -272,6 +359,8 @@ PHP_MINIT_FUNCTION(hdb)
 
     LOG_FUNCTION( "PHP_MINIT_FUNCTION for php_hdb" );
 
+    configure_conn_pool();
+
     REGISTER_LONG_CONSTANT( "HDB_ERR_ERRORS",   HDB_ERR_ERRORS, CONST_PERSISTENT | CONST_CS );
     REGISTER_LONG_CONSTANT( "HDB_ERR_WARNINGS", HDB_ERR_WARNINGS, CONST_PERSISTENT | CONST_CS );
     REGISTER_LONG_CONSTANT( "HDB_ERR_ALL", HDB_ERR_ALL, CONST_PERSISTENT | CONST_CS );
@@ -404,17 +493,25 @@ PHP_MINIT_FUNCTION(hdb)
     REGISTER_LONG_CONSTANT( "HDB_SCROLL_ABSOLUTE", SQL_FETCH_ABSOLUTE, CONST_PERSISTENT | CONST_CS );
     REGISTER_LONG_CONSTANT( "HDB_SCROLL_RELATIVE", SQL_FETCH_RELATIVE, CONST_PERSISTENT | CONST_CS );
 
+    REGISTER_LONG_CONSTANT( "HDB_PARAM_SUCCESS",              SQL_PARAM_SUCCESS, CONST_PERSISTENT | CONST_CS );
+    REGISTER_LONG_CONSTANT( "HDB_PARAM_SUCCESS_WITH_INFO",    SQL_PARAM_SUCCESS_WITH_INFO, CONST_PERSISTENT | CONST_CS );
+    REGISTER_LONG_CONSTANT( "HDB_PARAM_ERROR",                SQL_PARAM_ERROR, CONST_PERSISTENT | CONST_CS );
+    REGISTER_LONG_CONSTANT( "HDB_PARAM_UNUSED",               SQL_PARAM_UNUSED, CONST_PERSISTENT | CONST_CS );
+    REGISTER_LONG_CONSTANT( "HDB_PARAM_DIAG_UNAVAILABLE",     SQL_PARAM_DIAG_UNAVAILABLE, CONST_PERSISTENT | CONST_CS );
+
     std::string fwd = "forward";
     std::string stc = "static";
     std::string dyn = "dynamic";
     std::string key = "keyset";
     std::string buf = "buffered";
+    std::string col = "buffered_columnar";
 
     REGISTER_STRING_CONSTANT( "HDB_CURSOR_FORWARD",         &fwd[0], CONST_PERSISTENT | CONST_CS );
     REGISTER_STRING_CONSTANT( "HDB_CURSOR_STATIC",          &stc[0], CONST_PERSISTENT | CONST_CS );
     REGISTER_STRING_CONSTANT( "HDB_CURSOR_DYNAMIC",         &dyn[0], CONST_PERSISTENT | CONST_CS );
     REGISTER_STRING_CONSTANT( "HDB_CURSOR_KEYSET",          &key[0], CONST_PERSISTENT | CONST_CS );
     REGISTER_STRING_CONSTANT( "HDB_CURSOR_CLIENT_BUFFERED", &buf[0], CONST_PERSISTENT | CONST_CS );
+    REGISTER_STRING_CONSTANT( "HDB_CURSOR_CLIENT_BUFFERED_COLUMNAR", &col[0], CONST_PERSISTENT | CONST_CS );
 
     try {
 
@@ -664,6 +761,18 @@ PHP_RSHUTDOWN_FUNCTION(hdb)
     return SUCCESS;
 }
 
+// Post deactivation
+// Called once the request's resources, including its connections, are destroyed and the response is complete.
+// Disconnects the pooled connections that were evicted or found dead during the request, so the script that
+// noticed them doesn't wait for it.
+
+ZEND_MODULE_POST_ZEND_DEACTIVATE_D(hdb)
+{
+    core_hdb_pool_reap();
+
+    return SUCCESS;
+}
+
 // Called for php_info();  Displays the INI settings registered and their current values
 PHP_MINFO_FUNCTION(hdb)
 {
@@ -131,6 +131,8 @@ PHP_MSHUTDOWN_FUNCTION(hdb);
 PHP_RINIT_FUNCTION(hdb);
 // request shutdown function
 PHP_RSHUTDOWN_FUNCTION(hdb);
+// called after the request's resources are destroyed
+ZEND_MODULE_POST_ZEND_DEACTIVATE_D(hdb);
 // module info function (info returned by phpinfo())
 PHP_MINFO_FUNCTION(hdb);
 
@@ -138,6 +140,7 @@ PHP_MINFO_FUNCTION(hdb);
 // Connection
 //*********************************************************************************************************************************
 PHP_FUNCTION(hdb_connect);
+PHP_FUNCTION(hdb_pconnect);
 PHP_FUNCTION(hdb_begin_transaction);
 PHP_FUNCTION(hdb_client_info);
 PHP_FUNCTION(hdb_close);
@@ -146,6 +149,7 @@ PHP_FUNCTION(hdb_query);
 PHP_FUNCTION(hdb_prepare);
 PHP_FUNCTION(hdb_rollback);
 PHP_FUNCTION(hdb_server_info);
+PHP_FUNCTION(hdb_stmt_cache_stats);
 
 struct ss_hdb_conn : hdb_conn
 {
@@ -176,8 +180,8 @@ void __cdecl hdb_conn_dtor( _Inout_ zend_resource *rsrc );
 
 // holds the field names for reuse by hdb_fetch_array/object as keys
 struct hdb_fetch_field_name {
-    char* name;
-    SQLLEN len;
+    zend_string* name;      // key shared by the rows of the result set, with its hash already computed
+    bool add_new;           // the key is neither numeric nor repeated, so it is added to a row without a lookup
 };
 
 struct stmt_option_ss_scrollable : public stmt_option_functor {
@@ -228,8 +232,12 @@ struct hdb_stream_encoding {
 
 // *** statement functions ***
 PHP_FUNCTION(hdb_cancel);
+PHP_FUNCTION(hdb_copy_field_to_stream);
 PHP_FUNCTION(hdb_execute);
+PHP_FUNCTION(hdb_execute_batch);
+PHP_FUNCTION(hdb_execute_async);
 PHP_FUNCTION(hdb_fetch);
+PHP_FUNCTION(hdb_fetch_all);
 PHP_FUNCTION(hdb_fetch_array);
 PHP_FUNCTION(hdb_fetch_object);
 PHP_FUNCTION(hdb_field_metadata);
@@ -239,8 +247,10 @@ PHP_FUNCTION(hdb_has_rows);
 PHP_FUNCTION(hdb_next_result);
 PHP_FUNCTION(hdb_num_fields);
 PHP_FUNCTION(hdb_num_rows);
+PHP_FUNCTION(hdb_poll);
 PHP_FUNCTION(hdb_rows_affected);
 PHP_FUNCTION(hdb_send_stream_data);
+PHP_FUNCTION(hdb_wait);
 
 // resource destructor
 void __cdecl hdb_stmt_dtor( _Inout_ zend_resource *rsrc );
@@ -313,8 +323,18 @@ ZEND_TSRMLS_CACHE_EXTERN();
 #define INI_LOG_SEVERITY                "LogSeverity"
 #define INI_LOG_SUBSYSTEMS              "LogSubsystems"
 #define INI_BUFFERED_QUERY_LIMIT        "ClientBufferMaxKBSize"
+#define INI_POOL_MIN_IDLE               "PoolMinIdle"
+#define INI_POOL_MAX_IDLE               "PoolMaxIdle"
+#define INI_POOL_MAX_LIFETIME           "PoolMaxLifetime"
+#define INI_POOL_IDLE_TIMEOUT           "PoolIdleTimeout"
+#define INI_POOL_VALIDATION             "PoolValidation"
 #define INI_PREFIX                      "hdb."
 
+// values of the PoolValidation INI entry
+#define INI_POOL_VALIDATION_NONE            "none"
+#define INI_POOL_VALIDATION_CONNECTION_DEAD "connection_dead"
+#define INI_POOL_VALIDATION_QUERY           "query"
+
 PHP_INI_BEGIN()
     STD_PHP_INI_BOOLEAN( INI_PREFIX INI_WARNINGS_RETURN_AS_ERRORS , "1", PHP_INI_ALL, OnUpdateBool, warnings_return_as_errors,
                          zend_hdb_globals, hdb_globals )
@@ -324,6 +344,12 @@ PHP_INI_BEGIN()
                        hdb_globals )
     STD_PHP_INI_ENTRY( INI_PREFIX INI_BUFFERED_QUERY_LIMIT, INI_BUFFERED_QUERY_LIMIT_DEFAULT, PHP_INI_ALL, OnUpdateLong, buffered_query_limit,
                        zend_hdb_globals, hdb_globals )
+    // the persistent connection pool is shared by the requests of a process, so its policies are read once in MINIT
+    PHP_INI_ENTRY( INI_PREFIX INI_POOL_MIN_IDLE, "0", PHP_INI_SYSTEM, NULL )
+    PHP_INI_ENTRY( INI_PREFIX INI_POOL_MAX_IDLE, "10", PHP_INI_SYSTEM, NULL )
+    PHP_INI_ENTRY( INI_PREFIX INI_POOL_MAX_LIFETIME, "0", PHP_INI_SYSTEM, NULL )
+    PHP_INI_ENTRY( INI_PREFIX INI_POOL_IDLE_TIMEOUT, "0", PHP_INI_SYSTEM, NULL )
+    PHP_INI_ENTRY( INI_PREFIX INI_POOL_VALIDATION, INI_POOL_VALIDATION_CONNECTION_DEAD, PHP_INI_SYSTEM, NULL )
 PHP_INI_END()
 
 //*********************************************************************************************************************************
@@ -374,7 +400,9 @@ enum SS_ERROR_CODES {
     SS_HDB_ERROR_INVALID_OUTPUT_PARAM_TYPE,
     SS_HDB_ERROR_PARAM_VAR_NOT_REF,
     SS_HDB_ERROR_INVALID_AUTHENTICATION_OPTION,
-    SS_HDB_ERROR_AE_QUERY_SQLTYPE_REQUIRED
+    SS_HDB_ERROR_AE_QUERY_SQLTYPE_REQUIRED,
+    SS_HDB_ERROR_INVALID_MAX_ROWS,
+    SS_HDB_ERROR_INVALID_STMT_CACHE_SIZE
 };
 
 extern ss_error SS_ERRORS[];
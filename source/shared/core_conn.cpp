@@ -66,13 +66,14 @@ void common_conn_str_append_func( _In_z_ const char* odbc_name, _In_reads_(val_l
 // err               - error callback to put into the connection's context
 // valid_conn_opts[] - array of valid driver supported connection options.
 // driver            - reference to caller
+// persistent        - take the connection from the persistent connection pool, and return it there when it is closed
 // Return
 // A hdb_conn structure. An exception is thrown if an error occurs
 
 hdb_conn* core_hdb_connect( _In_ hdb_context& henv_cp, _In_ hdb_context& henv_ncp, _In_ driver_conn_factory conn_factory,
                                   _Inout_z_ const char* server, _Inout_opt_z_ const char* uid, _Inout_opt_z_ const char* pwd,
                                   _Inout_opt_ HashTable* options_ht, _In_ error_callback err, _In_ const connection_option valid_conn_opts[],
-                                  _In_ void* driver, _In_z_ const char* driver_func )
+                                  _In_ void* driver, _In_z_ const char* driver_func, _In_ bool persistent )
 
 {
     SQLRETURN r;
@@ -91,13 +92,26 @@ hdb_conn* core_hdb_connect( _In_ hdb_context& henv_cp, _In_ hdb_context& henv_nc
 
         build_connection_string_and_set_conn_attr( conn, server, uid, pwd, options_ht, valid_conn_opts, driver, conn_str );
 
-        r = core_odbc_connect( conn, conn_str, is_pooled );
-        CHECK_SQL_ERROR( r, conn ) {
-            throw core::CoreException();
+        // persistent connections are pooled by the connection string they were opened with
+        SQLHANDLE pooled_conn_h = SQL_NULL_HANDLE;
+        if( persistent ) {
+            conn->pool_key = zend_string_init( conn_str.c_str(), conn_str.length(), 0 );
+            pooled_conn_h = core_hdb_pool_checkout( conn_str, conn->pool_created );
         }
 
-        CHECK_SQL_WARNING_AS_ERROR( r, conn ) {
-            throw core::CoreException();
+        if( pooled_conn_h != SQL_NULL_HANDLE ) {
+            conn->set_handle( pooled_conn_h );
+        }
+        else {
+            conn->pool_created = time( NULL );
+            r = core_odbc_connect( conn, conn_str, is_pooled );
+            CHECK_SQL_ERROR( r, conn ) {
+                throw core::CoreException();
+            }
+
+            CHECK_SQL_WARNING_AS_ERROR( r, conn ) {
+                throw core::CoreException();
+            }
         }
     }
     catch( std::bad_alloc& ) {
@@ -119,6 +133,13 @@ hdb_conn* core_hdb_connect( _In_ hdb_context& henv_cp, _In_ hdb_context& henv_nc
     }
     catch( core::CoreException&  ) {
         conn_str.clear();
+        if( conn ) {
+            core_hdb_free_stmt_cache( conn );
+            if( conn->pool_key != NULL ) {
+                zend_string_release( conn->pool_key );
+                conn->pool_key = NULL;
+            }
+        }
         conn->invalidate();
         throw;
     }
@@ -271,15 +292,34 @@ void core_hdb_close( _Inout_opt_ hdb_conn* conn )
     if( conn == NULL )
         return;
 
+    bool rolled_back = false;
+
     try {
 
         // rollback any transaction in progress (we don't care about the return result)
         core::SQLEndTran( SQL_HANDLE_DBC, conn, SQL_ROLLBACK );
+        rolled_back = true;
     }
     catch( core::CoreException& ) {
         LOG( SEV_ERROR, "Transaction rollback failed when closing the connection." );
     }
 
+    // free the prepared statements and statement handles kept for reuse while their connection is still open
+    core_hdb_free_stmt_cache( conn );
+    core_hdb_free_stmt_pool( conn );
+
+    // a persistent connection goes back to the pool, which disconnects it after the request if it can't be reused
+    if( conn->pool_key != NULL ) {
+
+        core_hdb_pool_release( conn->pool_key, conn->handle(), conn->pool_created, rolled_back );
+        zend_string_release( conn->pool_key );
+        conn->pool_key = NULL;
+
+        conn->detach_handle();
+        hdb_free( conn );
+        return;
+    }
+
     // disconnect from the server
     SQLRETURN r = SQLDisconnect( conn->handle() );
     if( !SQL_SUCCEEDED( r )) {
@@ -306,10 +346,10 @@ void core_hdb_prepare( _Inout_ hdb_stmt* stmt, _In_reads_bytes_(sql_len) const c
         // convert the string from its encoding to UTf-16
         // if the string is empty, we initialize the fields and skip since an empty string is a
         // failure case for utf16_string_from_mbcs_string
-        hdb_malloc_auto_ptr<SQLWCHAR> wsql_string;
+        SQLWCHAR* wsql_string = NULL;
         unsigned int wsql_len = 0;
         if( sql_len == 0 || ( sql[0] == '\0' && sql_len == 1 )) {
-            wsql_string = reinterpret_cast<SQLWCHAR*>( hdb_malloc( sizeof( SQLWCHAR )));
+            wsql_string = stmt->wsql_scratch( 1 );
             wsql_string[0] = L'\0';
             wsql_len = 0;
         }
@@ -320,14 +360,15 @@ void core_hdb_prepare( _Inout_ hdb_stmt* stmt, _In_reads_bytes_(sql_len) const c
              }
 
              HDB_ENCODING encoding = (( stmt->encoding() == HDB_ENCODING_DEFAULT ) ? stmt->conn->encoding() : stmt->encoding() );
-             wsql_string = utf16_string_from_mbcs_string( encoding, reinterpret_cast<const char*>( sql ), static_cast<int>( sql_len ), &wsql_len );
-             CHECK_CUSTOM_ERROR( wsql_string == 0, stmt, HDB_ERROR_QUERY_STRING_ENCODING_TRANSLATE, get_last_error_message() ) {
+             wsql_string = stmt->wsql_scratch( static_cast<size_t>( sql_len ) + 1 );
+             wsql_len = utf16_string_from_mbcs_string( encoding, reinterpret_cast<const char*>( sql ), static_cast<unsigned int>( sql_len ), wsql_string );
+             CHECK_CUSTOM_ERROR( wsql_len == 0, stmt, HDB_ERROR_QUERY_STRING_ENCODING_TRANSLATE, get_last_error_message() ) {
                  throw core::CoreException();
              }
         }
 
         // prepare our wide char query string
-        core::SQLPrepareW( stmt, reinterpret_cast<SQLWCHAR*>( wsql_string.get() ), wsql_len );
+        core::SQLPrepareW( stmt, wsql_string, wsql_len );
 
         stmt->param_descriptions.clear();
 
@@ -453,25 +494,25 @@ void build_connection_string_and_set_conn_attr( _Inout_ hdb_conn* conn, _Inout_z
             return;
         }
 
-        //zend_string *key = NULL;
-        //zend_ulong index = -1;
-        //zval* data = NULL;
+        zend_string *key = NULL;
+        zend_ulong index = -1;
+        zval* data = NULL;
 
-        //ZEND_HASH_FOREACH_KEY_VAL( options, index, key, data ) {
-        //    int type = HASH_KEY_NON_EXISTENT;
-        //    type = key ? HASH_KEY_IS_STRING : HASH_KEY_IS_LONG;
+        ZEND_HASH_FOREACH_KEY_VAL( options, index, key, data ) {
+            int type = HASH_KEY_NON_EXISTENT;
+            type = key ? HASH_KEY_IS_STRING : HASH_KEY_IS_LONG;
 
-        //    // The driver layer should ensure a valid key.
-        //    DEBUG_HDB_ASSERT(( type == HASH_KEY_IS_LONG ), "build_connection_string_and_set_conn_attr: invalid connection option key type." );
+            // The driver layer should ensure a valid key.
+            DEBUG_HDB_ASSERT(( type == HASH_KEY_IS_LONG ), "build_connection_string_and_set_conn_attr: invalid connection option key type." );
 
-        //    conn_opt = get_connection_option( conn, index, valid_conn_opts );
+            conn_opt = get_connection_option( conn, index, valid_conn_opts );
 
-        //    if( index == HDB_CONN_OPTION_MARS ) {
-        //        mars_mentioned = true;
-        //    }
+            if( index == HDB_CONN_OPTION_MARS ) {
+                mars_mentioned = true;
+            }
 
-        //    conn_opt->func( conn_opt, data, conn, connection_string );
-        //} ZEND_HASH_FOREACH_END();
+            conn_opt->func( conn_opt, data, conn, connection_string );
+        } ZEND_HASH_FOREACH_END();
 
 
     }
@@ -738,6 +738,63 @@ private:
     zval_auto_ptr( _In_ const zval_auto_ptr& src );
 };
 
+
+// hdb_arena
+// a bump allocator for buffers that all live until the same point, such as the temporaries of a fetch.  Memory
+// is carved out of blocks taken from hdb_malloc and isn't freed piece by piece, but all at once by reset, which
+// keeps one block for the next round so a steady workload doesn't allocate at all.  Requests larger than a block
+// get a block of their own, which reset frees.
+//
+// Each statement resets its arena on every fetch.  With HDB_FETCH_ARENA defined (the --enable-hdb-fetch-arena
+// configure option, on by default) the field values core_hdb_get_field returns, such as a number or a DateTime
+// zval, are taken from it too instead of each costing an emalloc and an efree.  Build without it to track those
+// allocations with HDB_MEM_DEBUG.
+
+class hdb_arena {
+
+public:
+
+    static const size_t BLOCK_SIZE = 8 * 1024;     // size of the blocks small allocations are carved from
+
+    hdb_arena( void ) :
+        head_( NULL ),
+        used_( 0 )
+    {
+    }
+
+    ~hdb_arena( void )
+    {
+        release();
+    }
+
+    // returns size bytes aligned for any type.  The memory stays valid until reset or release.
+    void* alloc( _In_ size_t size );
+
+    // make all the memory given out available again
+    void reset( void );
+
+    // free all the blocks
+    void release( void );
+
+private:
+
+    // header of a block, followed by the block's memory
+    struct block {
+        block* next;
+        size_t size;
+    };
+
+    static const size_t ALIGNMENT = sizeof( double ) > sizeof( void* ) ? sizeof( double ) : sizeof( void* );
+
+    block* new_block( _In_ size_t size );
+
+    block* head_;       // the block allocations are carved from, followed by the older blocks
+    size_t used_;       // bytes of head_ given out
+
+    hdb_arena( _In_ hdb_arena const& );
+    hdb_arena& operator=( _In_ hdb_arena const& );
+};
+
 #pragma pop_macro( "max" )
 
 
@@ -946,6 +1003,22 @@ class hdb_context {
         this->driver_ = driver;
     }
 
+    // frees the ODBC handle held and takes ownership of another one of the same type
+    void set_handle( _In_ SQLHANDLE h )
+    {
+        invalidate();
+        handle_ = h;
+    }
+
+    // gives up the ODBC handle without freeing it, so that it can be reused by another context
+    SQLHANDLE detach_handle( void )
+    {
+        SQLHANDLE h = handle_;
+        handle_ = SQL_NULL_HANDLE;
+        last_error_.reset();
+        return h;
+    }
+
     void invalidate( void )
     {
         if( handle_ != SQL_NULL_HANDLE ) {
@@ -1046,6 +1119,8 @@ enum DRIVER_VERSION {
 // forward decl
 struct hdb_stmt;
 struct stmt_option;
+struct hdb_stmt_cache;
+struct hdb_stmt_pool;
 
 // This holds the various details of column encryption. 
 struct col_encryption_option {
@@ -1069,6 +1144,11 @@ struct hdb_conn : public hdb_context {
 
     col_encryption_option ce_option;    // holds the details of what are required to enable column encryption
     DRIVER_VERSION driver_version;      // version of ODBC driver
+    hdb_stmt_cache* stmt_cache;         // prepared statements kept for reuse, NULL unless the cache is enabled
+    hdb_stmt_pool* stmt_pool;           // handles and hash tables of freed statements, NULL until a statement is freed
+    zend_string* pool_key;              // connection string of a persistent connection, NULL if not persistent
+    time_t pool_created;                // when the persistent connection was opened
+    bool char_as_utf8;                  // the ODBC driver returns UTF-8 for SQL_C_CHAR (CHAR_AS_UTF8 connection property)
 
     // initialize with default values
     hdb_conn( _In_ SQLHANDLE h, _In_ error_callback e, _In_opt_ void* drv, _In_ HDB_ENCODING encoding ) :
@@ -1076,6 +1156,11 @@ struct hdb_conn : public hdb_context {
     {
         server_version = SERVER_VERSION_UNKNOWN;
         driver_version = ODBC_DRIVER_UNKNOWN;
+        stmt_cache = NULL;
+        stmt_pool = NULL;
+        pool_key = NULL;
+        pool_created = 0;
+        char_as_utf8 = false;
     }
 
     // hdb_conn has no destructor since its allocated using placement new, which requires that the destructor be 
@@ -1090,6 +1175,8 @@ enum HDB_STMT_OPTIONS {
    HDB_STMT_OPTION_SEND_STREAMS_AT_EXEC,
    HDB_STMT_OPTION_SCROLLABLE,
    HDB_STMT_OPTION_CLIENT_BUFFER_MAX_SIZE,
+   HDB_STMT_OPTION_STREAM_CHUNK_SIZE,
+   HDB_STMT_OPTION_PREFETCH_ROWS,
 
    // Driver specific connection options
    HDB_STMT_OPTION_DRIVER_SPECIFIC = 1000,
@@ -1232,7 +1319,7 @@ typedef hdb_conn* (*driver_conn_factory)( _In_ SQLHANDLE h, _In_ error_callback
 hdb_conn* core_hdb_connect( _In_ hdb_context& henv_cp, _In_ hdb_context& henv_ncp, _In_ driver_conn_factory conn_factory,
                                   _Inout_z_ const char* server, _Inout_opt_z_ const char* uid, _Inout_opt_z_ const char* pwd, 
                                   _Inout_opt_ HashTable* options_ht, _In_ error_callback err, _In_ const connection_option valid_conn_opts[], 
-                                  _In_ void* driver, _In_z_ const char* driver_func );
+                                  _In_ void* driver, _In_z_ const char* driver_func, _In_ bool persistent = false );
 SQLRETURN core_odbc_connect( _Inout_ hdb_conn* conn, _Inout_ std::string& conn_str, _In_ bool is_pooled );
 void core_hdb_close( _Inout_opt_ hdb_conn* conn );
 void core_hdb_prepare( _Inout_ hdb_stmt* stmt, _In_reads_bytes_(sql_len) const char* sql, _In_ SQLLEN sql_len );
@@ -1248,6 +1335,30 @@ bool core_is_authentication_option_valid( _In_z_ const char* value, _In_ size_t
 bool core_search_odbc_driver_unix( _In_ DRIVER_VERSION driver_version );
 bool core_compare_error_state( _In_ hdb_conn* conn,  _In_ SQLRETURN r, _In_ const char* error_state );
 
+// *** persistent connection pool functions ***
+
+// how an idle connection is checked before it is taken out of the pool
+enum HDB_POOL_VALIDATION {
+    HDB_POOL_VALIDATE_NONE,             // not checked
+    HDB_POOL_VALIDATE_CONNECTION_DEAD,  // SQL_ATTR_CONNECTION_DEAD is queried, which doesn't reach the server
+    HDB_POOL_VALIDATE_QUERY,            // a query is run on the server
+};
+
+// policies of the persistent connection pool, set from the INI entries at module initialization
+struct hdb_pool_policy {
+    zend_long min_idle;                 // idle connections per connection string kept past the idle timeout
+    zend_long max_idle;                 // idle connections per connection string kept in the pool
+    zend_long max_lifetime;             // seconds a connection is reused for after it is opened, 0 for no limit
+    zend_long idle_timeout;             // seconds a connection may stay idle in the pool, 0 for no limit
+    HDB_POOL_VALIDATION validation;     // how connections are checked when taken out of the pool
+};
+
+void core_hdb_pool_configure( _In_ hdb_pool_policy const& policy );
+SQLHANDLE core_hdb_pool_checkout( _In_ const std::string& conn_str, _Out_ time_t& created );
+void core_hdb_pool_release( _In_ zend_string* conn_str, _In_ SQLHANDLE conn_h, _In_ time_t created, _In_ bool reusable );
+void core_hdb_pool_reap( void );
+void core_hdb_pool_shutdown( void );
+
 //*********************************************************************************************************************************
 // Statement
 //*********************************************************************************************************************************
@@ -1272,6 +1383,16 @@ struct stmt_option_buffered_query_limit : public stmt_option_functor {
     virtual void operator()( _Inout_ hdb_stmt* stmt, stmt_option const* opt, _In_ zval* value_z );
 };
 
+struct stmt_option_stream_chunk_size : public stmt_option_functor {
+
+    virtual void operator()( _Inout_ hdb_stmt* stmt, stmt_option const* opt, _In_ zval* value_z );
+};
+
+struct stmt_option_prefetch_rows : public stmt_option_functor {
+
+    virtual void operator()( _Inout_ hdb_stmt* stmt, stmt_option const* opt, _In_ zval* value_z );
+};
+
 // used to hold the table for statment options
 struct stmt_option {
 
@@ -1290,13 +1411,17 @@ struct hdb_stream {
     SQLUSMALLINT field_index;
     SQLSMALLINT sql_type;
     hdb_stmt* stmt;
+    size_t max_chunk_size;      // largest read from the field, which the stream's chunk size grows to
+    SQLWCHAR split_surrogate;   // first half of a surrogate pair the last UTF-16 read ended with, or 0
 
     hdb_stream( _In_opt_ zval* str_z, _In_ HDB_ENCODING enc ) :
-        stream_z( str_z ), encoding( enc ), field_index( 0 ), sql_type( SQL_UNKNOWN_TYPE ), stmt( NULL )
+        stream_z( str_z ), encoding( enc ), field_index( 0 ), sql_type( SQL_UNKNOWN_TYPE ), stmt( NULL ), max_chunk_size( 0 ),
+        split_surrogate( 0 )
     {
     }
 
-    hdb_stream() : stream_z( NULL ), encoding( HDB_ENCODING_INVALID ), field_index( 0 ), sql_type( SQL_UNKNOWN_TYPE ), stmt( NULL )
+    hdb_stream() : stream_z( NULL ), encoding( HDB_ENCODING_INVALID ), field_index( 0 ), sql_type( SQL_UNKNOWN_TYPE ), stmt( NULL ),
+        max_chunk_size( 0 ), split_surrogate( 0 )
     {
     }
 };
@@ -1310,6 +1435,25 @@ extern php_stream_wrapper g_hdb_stream_wrapper;
 #define HDB_STREAM_WRAPPER "hdb"
 #define HDB_STREAM         "hdb_stream"
 
+// stream context option (e.g., stream_context_set_default( array( "hdb" => array( "chunk_size" => 65536 )))) giving
+// the largest read from a field, in bytes.  Reads start at the stream's chunk size and double while the field has
+// more data.
+#define HDB_STREAM_CONTEXT_CHUNK_SIZE "chunk_size"
+const size_t HDB_STREAM_MAX_CHUNK_SIZE_DEFAULT = 1024 * 1024;
+const size_t HDB_STREAM_MIN_CHUNK_SIZE = 8192;
+
+// the largest read from a field given by a stream context, or the default if the context doesn't give one
+size_t core_hdb_stream_max_chunk_size( _In_opt_ php_stream_context* context );
+
+// limits of the StreamChunkSize statement option, the most bytes of a stream parameter sent with one SQLPutData call
+const size_t HDB_STREAM_PARAM_CHUNK_SIZE_DEFAULT = PHP_STREAM_BUFFER_SIZE;
+const int HDB_STREAM_PARAM_CHUNK_SIZE_MAX = 4 * 1024 * 1024;
+
+// limits of the PrefetchRows statement option, the most rows of a forward only result set fetched with one
+// SQLFetchScroll call.  1 fetches a row at a time.
+const SQLULEN HDB_PREFETCH_ROWS_DEFAULT = 64;
+const int HDB_PREFETCH_ROWS_MAX = 65536;
+
 // holds the output parameter information.  Strings also need the encoding and other information for
 // after processing.  Only integer, float, and strings are allowable output parameters.
 struct hdb_output_param {
@@ -1364,6 +1508,71 @@ struct param_meta_data
     SQLULEN get_column_size() { return column_size; }
 };
 
+// *** prepared statement cache ***
+// A connection opened with a statement cache keeps the handles of statements prepared with
+// core_hdb_create_prepared_stmt.  When such a statement is destroyed its handle is closed, its
+// parameters are reset and it is kept, so that preparing the same SQL text with the same options
+// again reuses it without another prepare on the server.  The least recently used handle is
+// freed when the cache is full.
+struct hdb_stmt_cache_entry {
+
+    zend_string* key;                       // SQL text followed by the statement options it was prepared with
+    SQLHANDLE handle;                       // prepared ODBC statement handle
+    param_meta_data* param_descriptions;    // parameter descriptions retrieved when the statement was prepared
+    size_t param_count;                     // number of entries in param_descriptions
+    zend_ulong last_used;                   // the cache's clock when the handle was returned
+};
+
+struct hdb_stmt_cache {
+
+    hdb_stmt_cache_entry* entries;
+    zend_long capacity;                     // maximum number of handles kept
+    zend_long count;                        // number of handles kept
+    zend_ulong clock;                       // incremented each time a handle is returned, to order the entries by use
+    zend_ulong hits;                        // prepares satisfied by a cached handle
+    zend_ulong misses;                      // prepares sent to the server
+};
+
+// *** statement pool ***
+// Statements that aren't kept by the statement cache give their handle and the hash tables behind their zval
+// members back to their connection when they are destroyed, so the next statements created on it take them
+// instead of allocating new ones.  The handles are closed, unbound, have their parameters reset and their cursor
+// type set back to forward only.  The tables are empty.
+struct hdb_stmt_pool {
+
+    static const int CAPACITY = 8;          // most handles, and sets of tables, kept
+
+    // the tables of a statement's zval members
+    struct tables {
+        zend_array* param_input_strings;
+        zend_array* output_params;
+        zend_array* param_streams;
+        zend_array* param_datetime_buffers;
+        zend_array* field_cache;
+    };
+
+    SQLHANDLE handles[ CAPACITY ];
+    int handle_count;
+    tables spare_tables[ CAPACITY ];
+    int tables_count;
+};
+
+// *** column descriptor struct ***
+// Describes a column of the current result set.  The descriptors are filled in once per result set by
+// hdb_stmt::describe_columns so that the fetch functions don't ask ODBC about each field of each row.
+struct hdb_column_desc {
+
+    SQLSMALLINT sql_type;                   // concise SQL type of the column
+    SQLULEN length;                         // column size
+    SQLSMALLINT decimal_digits;             // scale of exact numeric and datetime columns
+    SQLSMALLINT nullable;                   // SQL_NULLABLE, SQL_NO_NULLS or SQL_NULLABLE_UNKNOWN
+    SQLLEN display_size;                    // display size (octet length for wide character columns)
+    hdb_phptype php_type;                   // default PHP type of the column
+    hdb_phptype php_type_prefer_string;     // default PHP type when strings are preferred to streams
+    SQLSMALLINT c_type;                     // C type used to retrieve the column as php_type_prefer_string
+    SQLLEN len_hint;                        // longest value in bytes read from a large column so far, sizes the first read
+};
+
 // *** Statement resource structure *** 
 struct hdb_stmt : public hdb_context {
 
@@ -1396,9 +1605,20 @@ struct hdb_stmt : public hdb_context {
     hdb_stream current_stream;         // current stream sending data to the server as an input parameter
     unsigned int current_stream_read;     // # of bytes read so far. (if we read an empty PHP stream, we send an empty string 
                                           // to the server)
+    size_t stream_chunk_size;             // most bytes read from a stream parameter and sent with one SQLPutData call
+    SQLULEN prefetch_rows;                // most rows of a forward only result set fetched with one SQLFetchScroll call
+    hdb_malloc_auto_ptr<char> stream_buffer;        // holds the bytes read from a stream parameter, reused for each packet
+    hdb_malloc_auto_ptr<SQLWCHAR> stream_wbuffer;   // holds a packet of a UTF-8 stream parameter converted to UTF-16
+    hdb_malloc_auto_ptr<SQLWCHAR> wsql_buffer;      // SQL text converted to UTF-16, reused by later executions
+    size_t wsql_buffer_len;               // # of wide characters wsql_buffer holds
     zval field_cache;                     // cache for a single row of fields, to allow multiple and out of order retrievals
-    zval col_cache;                       // Used by get_field_as_string not to call SQLColAttribute()  after every fetch. 
+    hdb_arena fetch_arena;                // temporaries of the current row's field retrievals, reset by core_hdb_fetch
+    hdb_malloc_auto_ptr<hdb_column_desc> col_descs;  // descriptors of the columns in the current result set
+    SQLSMALLINT col_descs_count;          // number of entries in col_descs, -1 until the columns are described
     zval active_stream;                   // the currently active stream reading data from the database
+    zend_string* cache_key;               // key of the statement in the connection's statement cache, NULL if not cached
+    bool async_executing;                 // started by core_hdb_execute_async and not yet completed by core_hdb_poll
+    bool async_enabled;                   // SQL_ATTR_ASYNC_ENABLE is on for the handle
 
     std::vector<param_meta_data> param_descriptions;
 
@@ -1408,6 +1628,35 @@ struct hdb_stmt : public hdb_context {
     // driver specific conversion rules from a SQL Server/ODBC type to one of the HDB_PHPTYPE_* constants
     virtual hdb_phptype sql_type_to_php_type( _In_ SQLINTEGER sql_type, _In_ SQLUINTEGER size, _In_ bool prefer_string_to_stream ) = 0;
 
+    // fill in the column descriptors of the current result set
+    void describe_columns( void );
+
+    // buffer of at least len wide characters to convert SQL text into, kept for the statement's later executions
+    SQLWCHAR* wsql_scratch( _In_ size_t len );
+
+    // field values that are handed out of core_hdb_get_field, and only live until the caller has copied them, are
+    // allocated with these.  See HDB_FETCH_ARENA.
+    void* alloc_field_value( _In_ size_t size );
+    void free_field_value( _Inout_opt_ void* ptr );
+
+    // number of columns in the current result set, described on first use
+    SQLSMALLINT num_result_cols( void )
+    {
+        if( col_descs_count < 0 ) {
+            describe_columns();
+        }
+        return col_descs_count;
+    }
+
+    // descriptor of a column (0 based) in the current result set, described on first use
+    hdb_column_desc& col_desc( _In_ SQLUSMALLINT field_index )
+    {
+        if( col_descs_count < 0 ) {
+            describe_columns();
+        }
+        HDB_ASSERT( field_index < col_descs_count, "hdb_stmt::col_desc: Invalid field index" );
+        return col_descs[ field_index ];
+    }
 };
 
 // *** field metadata struct ***
@@ -1439,11 +1688,13 @@ const int HDB_DEFAULT_SIZE = -1;     // size given for an output parameter that
 // uninitialized query timeout value
 const unsigned int QUERY_TIMEOUT_INVALID = 0xffffffff;
 
-// special buffered query constant
+// special buffered query constants
 #ifndef _WIN32
 const size_t HDB_CURSOR_BUFFERED = 42; // arbitrary number that doesn't map to any other SQL_CURSOR_* constant
+const size_t HDB_CURSOR_BUFFERED_COLUMNAR = 43; // buffered, with the rows stored a column at a time
 #else
 const size_t HDB_CURSOR_BUFFERED = 0xfffffffeUL; // arbitrary number that doesn't map to any other SQL_CURSOR_* constant
+const size_t HDB_CURSOR_BUFFERED_COLUMNAR = 0xfffffffdUL; // buffered, with the rows stored a column at a time
 #endif // !_WIN32
 
 // factory to create a statement
@@ -1452,15 +1703,29 @@ typedef hdb_stmt* (*driver_stmt_factory)( hdb_conn* conn, SQLHANDLE h, error_cal
 // *** statement functions ***
 hdb_stmt* core_hdb_create_stmt( _Inout_ hdb_conn* conn, _In_ driver_stmt_factory stmt_factory, _In_opt_ HashTable* options_ht, 
                                       _In_opt_ const stmt_option valid_stmt_opts[], _In_ error_callback const err, _In_opt_ void* driver );
+hdb_stmt* core_hdb_create_prepared_stmt( _Inout_ hdb_conn* conn, _In_ driver_stmt_factory stmt_factory,
+                                         _In_reads_bytes_(sql_len) const char* sql, _In_ SQLLEN sql_len, _In_opt_ HashTable* options_ht,
+                                         _In_opt_ const stmt_option valid_stmt_opts[], _In_ error_callback const err, _In_opt_ void* driver );
+void core_hdb_enable_stmt_cache( _Inout_ hdb_conn* conn, _In_ zend_long capacity );
+void core_hdb_free_stmt_cache( _Inout_ hdb_conn* conn );
+void core_hdb_get_stmt_cache_stats( _Inout_ hdb_conn* conn, _Out_ zval* stats_z );
+void core_hdb_free_stmt_pool( _Inout_ hdb_conn* conn );
 void core_hdb_bind_param( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT param_num, _In_ SQLSMALLINT direction, _Inout_ zval* param_z,
                              _In_ HDB_PHPTYPE php_out_type, _Inout_ HDB_ENCODING encoding, _Inout_ SQLSMALLINT sql_type, _Inout_ SQLULEN column_size,
                              _Inout_ SQLSMALLINT decimal_digits );
 SQLRETURN core_hdb_execute( _Inout_ hdb_stmt* stmt, _In_reads_bytes_(sql_len) const char* sql = NULL, _In_ int sql_len = 0 );
+SQLRETURN core_hdb_execute_batch( _Inout_ hdb_stmt* stmt, _In_ HashTable* rows_ht, _Inout_ zval* statuses_z );
+bool core_hdb_execute_async( _Inout_ hdb_stmt* stmt );
+bool core_hdb_poll( _Inout_ hdb_stmt* stmt );
+bool core_hdb_wait( _Inout_ std::vector<hdb_stmt*>& stmts, _In_ double timeout );
 field_meta_data* core_hdb_field_metadata( _Inout_ hdb_stmt* stmt, _In_ SQLSMALLINT colno );
 bool core_hdb_fetch( _Inout_ hdb_stmt* stmt, _In_ SQLSMALLINT fetch_orientation, _In_ SQLULEN fetch_offset );
 void core_hdb_get_field( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index, _In_ hdb_phptype hdb_phptype, _In_ bool prefer_string,
 							_Outref_result_bytebuffer_maybenull_(*field_length) void*& field_value, _Inout_ SQLLEN* field_length, _In_ bool cache_field,
 							_Out_ HDB_PHPTYPE *hdb_php_type_out);
+size_t core_hdb_copy_field_to_stream( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index, _Inout_ php_stream* dest );
+bool core_hdb_get_scalar_field( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index, _In_ hdb_phptype hdb_php_type_in,
+                                _In_ bool prefer_string, _Out_ zval& field_z );
 bool core_hdb_has_any_result( _Inout_ hdb_stmt* stmt );
 void core_hdb_next_result( _Inout_ hdb_stmt* stmt, _In_ bool finalize_output_params = true, _In_ bool throw_on_errors = true );
 void core_hdb_post_param( _Inout_ hdb_stmt* stmt, _In_ zend_ulong paramno, zval* param_z );
@@ -1471,6 +1736,8 @@ void core_hdb_set_send_at_exec( _Inout_ hdb_stmt* stmt, _In_ zval* value_z );
 bool core_hdb_send_stream_packet( _Inout_ hdb_stmt* stmt );
 void core_hdb_set_buffered_query_limit( _Inout_ hdb_stmt* stmt, _In_ zval* value_z );
 void core_hdb_set_buffered_query_limit( _Inout_ hdb_stmt* stmt, _In_ SQLLEN limit );
+void core_hdb_set_stream_chunk_size( _Inout_ hdb_stmt* stmt, _In_ zval* value_z );
+void core_hdb_set_prefetch_rows( _Inout_ hdb_stmt* stmt, _In_ zval* value_z );
 
 
 //*********************************************************************************************************************************
@@ -1501,6 +1768,10 @@ struct hdb_result_set {
                                       _Inout_ SQLSMALLINT* out_buffer_length ) = 0;
     virtual hdb_error* get_diag_rec( _In_ SQLSMALLINT record_number ) = 0;
     virtual SQLLEN row_count( ) = 0;
+
+    // whether the result set has any rows.  Called before the first fetch, a result set that has to fetch to know
+    // keeps what it fetched and serves it to the first fetch, so the cursor is never moved back.
+    virtual bool has_rows( void ) = 0;
 };
 
 struct hdb_odbc_result_set : public hdb_result_set {
@@ -1518,12 +1789,21 @@ struct hdb_odbc_result_set : public hdb_result_set {
                                       _Inout_ SQLSMALLINT* out_buffer_length );
     virtual hdb_error* get_diag_rec( _In_ SQLSMALLINT record_number );
     virtual SQLLEN row_count( );
+    virtual bool has_rows( void );
 
  private:
     // prevent invalid instantiations and assignments
     hdb_odbc_result_set( void );
     hdb_odbc_result_set( hdb_odbc_result_set& );
     hdb_odbc_result_set& operator=( hdb_odbc_result_set& );
+
+    bool prefetched;                    // has_rows fetched the first row
+    bool on_prefetched_row;             // ... and the cursor is still on it, though the caller hasn't fetched yet
+    SQLRETURN prefetch_result;          // what fetching the first row returned
+    hdb_error_auto_ptr prefetch_warning;    // the warning fetching the first row returned, until that row is fetched
+    bool reporting_prefetch_warning;    // the diagnostics are read from prefetch_warning while it's reported
+
+    SQLRETURN prefetched_row( void );
 };
 
 struct hdb_buffered_result_set : public hdb_result_set {
@@ -1531,8 +1811,9 @@ struct hdb_buffered_result_set : public hdb_result_set {
     struct meta_data {
         SQLSMALLINT type;
         SQLSMALLINT c_type;     // convenience
-        SQLULEN offset;         // in bytes
+        SQLULEN offset;         // in bytes, from the start of the row (or of the block when columnar)
         SQLULEN length;         // in bytes
+        SQLULEN width;          // in bytes, of each entry in the column's vector when columnar
         SQLSMALLINT scale;
 
         static const SQLULEN SIZE_UNKNOWN = 0;
@@ -1543,7 +1824,13 @@ struct hdb_buffered_result_set : public hdb_result_set {
     static const zend_long BUFFERED_QUERY_LIMIT_DEFAULT = 10240;   // measured in KB
     static const zend_long BUFFERED_QUERY_LIMIT_INVALID = 0;
 
-    explicit hdb_buffered_result_set( _Inout_ hdb_stmt* odbc );
+    // size in bytes of the blocks the rows are stored in
+    static const SQLULEN ROW_CHUNK_SIZE = 64 * 1024;
+    // size in bytes of the blocks of the string heap used by the columnar layout
+    static const SQLULEN HEAP_BLOCK_SIZE = 64 * 1024;
+
+    // columnar stores each block of rows as one vector (and null bitmap) per column rather than row after row
+    explicit hdb_buffered_result_set( _Inout_ hdb_stmt* odbc, _In_ bool columnar = false );
     virtual ~hdb_buffered_result_set( void );
 
     virtual bool cached( int field_index ) { return true; }
@@ -1556,6 +1843,7 @@ struct hdb_buffered_result_set : public hdb_result_set {
                                       _Inout_ SQLSMALLINT* out_buffer_length );
     virtual hdb_error* get_diag_rec( _In_ SQLSMALLINT record_number );
     virtual SQLLEN row_count( );
+    virtual bool has_rows( void );
 
     // buffered result set specific 
     SQLSMALLINT column_count( void )
@@ -1574,7 +1862,19 @@ struct hdb_buffered_result_set : public hdb_result_set {
     hdb_buffered_result_set( hdb_buffered_result_set& );
     hdb_buffered_result_set& operator=( hdb_buffered_result_set& );
 
-    HashTable* cache;                   // rows of data kept in index based hash table
+    hdb_malloc_auto_ptr<unsigned char*> chunks;  // rows of data, stored back to back in blocks of rows_per_chunk rows
+    SQLULEN chunk_count;                // number of blocks allocated
+    SQLULEN chunk_capacity;             // number of block pointers chunks has room for
+    SQLULEN chunk_size;                 // size of a block in bytes
+    SQLULEN row_size;                   // size of a row in bytes (null bits, fields and pointers to LOB data)
+    SQLULEN rows_per_chunk;             // number of rows in a block
+    bool columnar;                      // blocks hold a null bitmap and a vector per column rather than whole rows
+    SQLULEN column_null_bytes;          // size in bytes of a column's null bitmap in a block when columnar
+    unsigned char* heap;                // most recent block of the string heap (columnar), each block points to the previous one
+    unsigned char* heap_next;           // next free byte in the most recent heap block
+    SQLULEN heap_left;                  // bytes left in the most recent heap block
+    SQLLEN rows;                        // number of rows in the cache, -1 when there is no result set
+    bool has_lobs;                      // whether any rows point to LOB data that must be freed with them
     SQLSMALLINT col_count;            // number of columns in the current result set
     hdb_malloc_auto_ptr<meta_data> meta;  // metadata for fields in the cache
     SQLLEN current;                     // 1 based, 0 means before first row
@@ -1635,7 +1935,85 @@ struct hdb_buffered_result_set : public hdb_result_set {
                                _Inout_ SQLLEN* out_buffer_length );
 
     // utility functions for conversions
-    unsigned char* get_row( void );
+    unsigned char* get_field( _In_ SQLSMALLINT field_index );
+
+    // row storage (rows are 0 based)
+    void add_row( void );
+    void free_rows( void );
+    unsigned char* field_cell( _In_ SQLULEN row, _In_ SQLSMALLINT field_index );
+    void set_null( _In_ SQLULEN row, _In_ SQLSMALLINT field_index );
+    bool is_null( _In_ SQLULEN row, _In_ SQLSMALLINT field_index );
+    bool in_heap( _In_ SQLSMALLINT field_index );
+    unsigned char* heap_alloc( _In_ SQLULEN size );
+};
+
+// Forward only result set that binds its columns with SQLBindCol and fetches them a block of rows at a time
+// (SQL_ATTR_ROW_ARRAY_SIZE) rather than calling SQLGetData for every field of every row.  Only used when every
+// column in the result set is of a fixed or bounded size (see is_bindable); LOBs and other unbounded columns
+// use hdb_odbc_result_set.  Fields are served from the bound buffers, converting to the requested C type.
+// The block holds the statement's PrefetchRows rows, or as many as fit in BOUND_BUFFER_MAX_SIZE if fewer.
+
+struct hdb_bound_result_set : public hdb_result_set {
+
+    struct meta_data {
+        SQLSMALLINT c_type;     // C type the column is bound as
+        SQLLEN length;          // size in bytes of one element of the column buffer
+        unsigned char* data;    // column buffer holding row_array_size elements
+        SQLLEN* ind;            // length/indicator for each row in the block
+    };
+
+    // most memory (in bytes) used for the bound column buffers of a result set
+    static const SQLLEN BOUND_BUFFER_MAX_SIZE = 256 * 1024;
+
+    // returns true if the current result set of the statement can be bound
+    static bool is_bindable( _Inout_ hdb_stmt* odbc );
+
+    explicit hdb_bound_result_set( _Inout_ hdb_stmt* odbc );
+    virtual ~hdb_bound_result_set( void );
+
+    virtual bool cached( int field_index ) { return true; }
+    virtual SQLRETURN fetch( _In_ SQLSMALLINT fetch_orientation, _In_ SQLLEN fetch_offset );
+    virtual SQLRETURN get_data( _In_ SQLUSMALLINT field_index, _In_ SQLSMALLINT target_type,
+                                _Out_writes_bytes_opt_(buffer_length) void* buffer, _In_ SQLLEN buffer_length, _Inout_ SQLLEN* out_buffer_length,
+                                bool handle_warning );
+    virtual SQLRETURN get_diag_field( _In_ SQLSMALLINT record_number, _In_ SQLSMALLINT diag_identifier, 
+                                      _Inout_updates_(buffer_length) SQLPOINTER diag_info_buffer, _In_ SQLSMALLINT buffer_length,
+                                      _Inout_ SQLSMALLINT* out_buffer_length );
+    virtual hdb_error* get_diag_rec( _In_ SQLSMALLINT record_number );
+    virtual SQLLEN row_count( );
+    virtual bool has_rows( void );
+
+ private:
+    // prevent invalid instantiations and assignments
+    hdb_bound_result_set( void );
+    hdb_bound_result_set( hdb_bound_result_set& );
+    hdb_bound_result_set& operator=( hdb_bound_result_set& );
+
+    SQLSMALLINT col_count;              // number of columns in the current result set
+    hdb_malloc_auto_ptr<meta_data> meta;  // bindings for each column
+    SQLULEN row_array_size;             // number of rows requested with each block fetch
+    SQLULEN rows_fetched;               // number of rows returned by the last block fetch (SQL_ATTR_ROWS_FETCHED_PTR)
+    SQLUSMALLINT* row_status;           // status of each row in the block (SQL_ATTR_ROW_STATUS_PTR)
+    hdb_error** row_errors;             // first diagnostic of each row in the block, reported when the row is reached
+    SQLULEN current;                    // 0 based row within the block of the current row
+    bool prefetched;                    // has_rows fetched the first block
+    bool block_pending;                 // ... and the first fetch hasn't moved to its first row yet
+    hdb_error_auto_ptr last_error;   // if an error occurred, it is kept here
+    SQLUSMALLINT last_field_index;      // the last field data retrieved from
+    SQLLEN read_so_far;                 // position within string to read from (for partial reads of strings)
+    hdb_malloc_auto_ptr<SQLCHAR> temp_string;   // temp buffer to hold a converted field while in use
+    SQLLEN temp_length;                 // number of bytes in the temp conversion buffer
+
+    void unbind( void );
+    void clear_row_errors( void );
+    SQLRETURN fetch_block( void );
+    SQLRETURN row_result( void );
+    SQLLEN bound_length( _In_ SQLSMALLINT field_index, _Out_ bool& truncated );
+    SQLRETURN copy_string( _In_reads_bytes_(data_length) const SQLCHAR* data, _In_ SQLLEN data_length, _In_ SQLSMALLINT extra,
+                           _Out_writes_bytes_to_opt_(buffer_length, *out_buffer_length) void* buffer, _In_ SQLLEN buffer_length,
+                           _Out_ SQLLEN* out_buffer_length );
+    SQLRETURN convert_string( _In_ SQLSMALLINT field_index, _In_ SQLSMALLINT target_type, _Out_writes_bytes_to_opt_(buffer_length, *out_buffer_length) void* buffer,
+                              _In_ SQLLEN buffer_length, _Out_ SQLLEN* out_buffer_length );
 };
 
 //*********************************************************************************************************************************
@@ -1654,7 +2032,10 @@ bool convert_string_from_utf16_inplace( _In_ HDB_ENCODING encoding, _Inout_updat
 bool convert_zval_string_from_utf16( _In_ HDB_ENCODING encoding, _Inout_ zval* value_z, _Inout_ SQLLEN& len);
 bool validate_string( _In_ char* string, _In_ SQLLEN& len);
 bool convert_string_from_utf16( _In_ HDB_ENCODING encoding, _In_reads_bytes_(cchInLen) const SQLWCHAR* inString, _In_ SQLINTEGER cchInLen, _Inout_updates_bytes_(cchOutLen) char** outString, _Out_ SQLLEN& cchOutLen );
+bool convert_zend_string_from_utf16( _In_ HDB_ENCODING encoding, _In_reads_(cchInLen) const SQLWCHAR* inString, _In_ SQLINTEGER cchInLen, _Out_ zend_string** outString );
+bool is_valid_utf8( _In_reads_bytes_(len) const char* str, _In_ SQLLEN len );
 SQLWCHAR* utf16_string_from_mbcs_string( _In_ HDB_ENCODING php_encoding, _In_reads_bytes_(mbcs_len) const char* mbcs_string, _In_ unsigned int mbcs_len, _Out_ unsigned int* utf16_len );
+unsigned int utf16_string_from_mbcs_string( _In_ HDB_ENCODING php_encoding, _In_reads_bytes_(mbcs_len) const char* mbcs_string, _In_ unsigned int mbcs_len, _Out_writes_(mbcs_len + 1) SQLWCHAR* utf16_string );
 
 //*********************************************************************************************************************************
 // Error handling routines and Predefined Errors
@@ -1712,6 +2093,13 @@ enum HDB_ERROR_CODES {
     HDB_ERROR_AKV_SECRET_MISSING,
     HDB_ERROR_KEYSTORE_INVALID_VALUE,
     HDB_ERROR_DOUBLE_CONVERSION_FAILED,
+    HDB_ERROR_BATCH_ROW_INVALID,
+    HDB_ERROR_BATCH_PARAM_INVALID_TYPE,
+    HDB_ERROR_ASYNC_STILL_EXECUTING,
+    HDB_ERROR_STREAM_WRITE,
+    HDB_ERROR_INVALID_STREAM_CHUNK_SIZE,
+    HDB_ERROR_INVALID_PREFETCH_ROWS,
+    HDB_ERROR_ASYNC_STREAM_PARAMS,
 
     // Driver specific error codes starts from here.
     HDB_ERROR_DRIVER_SPECIFIC = 1000,
@@ -1937,6 +2325,18 @@ namespace core {
         }
     }
 
+    inline void SQLBindCol( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT column_number, _In_ SQLSMALLINT target_type,
+                            _Inout_updates_bytes_opt_(buffer_length) SQLPOINTER target_value, _In_ SQLLEN buffer_length,
+                            _Inout_opt_ SQLLEN* str_len_or_ind )
+    {
+        SQLRETURN r;
+        r = ::SQLBindCol( stmt->handle(), column_number, target_type, target_value, buffer_length, str_len_or_ind );
+
+        CHECK_SQL_ERROR_OR_WARNING( r, stmt ) {
+            throw CoreException();
+        }
+    }
+
     inline void SQLBindParameter( _Inout_ hdb_stmt*          stmt, 
                                   _In_ SQLUSMALLINT             ParameterNumber,
                                   _In_ SQLSMALLINT              InputOutputType,
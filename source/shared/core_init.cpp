@@ -126,6 +126,9 @@ void core_hdb_minit( _Outptr_ hdb_context** henv_cp, _Inout_ hdb_context** henv_
 // henv_ncp - Non-pooled environment handle.
 void core_hdb_mshutdown( _Inout_ hdb_context& henv_cp, _Inout_ hdb_context& henv_ncp )
 {
+    // the pooled persistent connections belong to the environment handles
+    core_hdb_pool_shutdown();
+
     if( henv_ncp != SQL_NULL_HANDLE ) {
 
         henv_ncp.invalidate();
@@ -0,0 +1,344 @@
+//---------------------------------------------------------------------------------------------------------------------------------
+// File: core_pool.cpp
+//
+// Contents: Core routines for the pool of persistent connections shared by the requests of a process
+//
+//---------------------------------------------------------------------------------------------------------------------------------
+
+#include "core_hdb.h"
+
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// *** internal variables and constants ***
+
+namespace {
+
+// an idle connection in the pool
+struct pooled_conn {
+
+    SQLHANDLE handle;       // connected ODBC connection handle
+    time_t created;         // when the connection was opened
+    time_t released;        // when the connection was last put in the pool
+};
+
+// idle connections by the connection string they were opened with, the most recently released last.  The pool
+// outlives the requests, so it lives in the C heap rather than in PHP's heap.
+typedef std::map<std::string, std::vector<pooled_conn>> conn_pool_map;
+
+conn_pool_map g_conn_pool;
+
+// connections taken out of the pool to be disconnected by core_hdb_pool_reap, so that the request that noticed
+// they should go doesn't wait for the server
+std::vector<SQLHANDLE> g_conn_pool_reap;
+
+hdb_pool_policy g_conn_pool_policy = { 0, 10, 0, 0, HDB_POOL_VALIDATE_CONNECTION_DEAD };
+
+std::mutex g_conn_pool_mutex;
+
+// lists the session variables set on the connection, so they can be unset before it is reused
+const char SESSION_VARIABLES_QUERY[] = "SELECT KEY FROM M_SESSION_CONTEXT WHERE CONNECTION_ID = CURRENT_CONNECTION AND SECTION = 'USER'";
+
+// size of the buffer the name of a session variable is read into
+const SQLLEN SESSION_VARIABLE_KEY_LEN = 256;
+
+// the cheapest statement that makes a round trip to the server, used to validate connections
+const char VALIDATION_QUERY[] = "SELECT 1 FROM DUMMY";
+
+// *** internal function prototypes ***
+
+void disconnect( _In_ SQLHANDLE conn_h );
+bool is_conn_dead( _In_ SQLHANDLE conn_h );
+bool is_conn_expired( _In_ pooled_conn const& conn, _In_ time_t now );
+bool is_conn_idle_too_long( _In_ pooled_conn const& conn, _In_ time_t now );
+bool reset_session( _In_ SQLHANDLE conn_h );
+void reap( _In_ SQLHANDLE conn_h );
+bool validate_conn( _In_ SQLHANDLE conn_h );
+}
+
+// core_hdb_pool_configure
+// Sets the policies of the persistent connection pool.  Called at module initialization.
+// Parameters:
+// policy - the policies, read from the INI entries by the driver
+
+void core_hdb_pool_configure( _In_ hdb_pool_policy const& policy )
+{
+    std::lock_guard<std::mutex> lock( g_conn_pool_mutex );
+    g_conn_pool_policy = policy;
+}
+
+// core_hdb_pool_checkout
+// Takes an idle connection opened with the connection string given out of the pool.  Connections that are past
+// their lifetime, were idle too long or fail validation are left for core_hdb_pool_reap to disconnect, and the
+// next one is tried.
+// Parameters:
+// conn_str - connection string built by build_connection_string_and_set_conn_attr
+// created  - set to when the connection returned was opened
+// Return
+// A connected ODBC connection handle owned by the caller, or SQL_NULL_HANDLE if the pool has none.
+
+SQLHANDLE core_hdb_pool_checkout( _In_ const std::string& conn_str, _Out_ time_t& created )
+{
+    while( true ) {
+
+        pooled_conn conn;
+        HDB_POOL_VALIDATION validation;
+        {
+            std::lock_guard<std::mutex> lock( g_conn_pool_mutex );
+
+            conn_pool_map::iterator idle = g_conn_pool.find( conn_str );
+            if( idle == g_conn_pool.end() || idle->second.empty() ) {
+                return SQL_NULL_HANDLE;
+            }
+
+            // the most recently released connection is the least likely to have been dropped by the server
+            conn = idle->second.back();
+            idle->second.pop_back();
+            validation = g_conn_pool_policy.validation;
+
+            time_t now = time( NULL );
+            if( is_conn_expired( conn, now ) || is_conn_idle_too_long( conn, now )) {
+                reap( conn.handle );
+                continue;
+            }
+        }
+
+        if(( validation == HDB_POOL_VALIDATE_CONNECTION_DEAD && is_conn_dead( conn.handle )) ||
+           ( validation == HDB_POOL_VALIDATE_QUERY && !validate_conn( conn.handle ))) {
+
+            LOG( SEV_NOTICE, "core_hdb_pool_checkout: Discarding a dead pooled connection." );
+            std::lock_guard<std::mutex> lock( g_conn_pool_mutex );
+            reap( conn.handle );
+            continue;
+        }
+
+        created = conn.created;
+        return conn.handle;
+    }
+}
+
+// core_hdb_pool_release
+// Resets the session of a persistent connection and puts it in the pool.  The transaction is rolled back,
+// autocommit is turned back on and the session variables set on the connection are unset.  A connection that
+// can't be reset, is past its lifetime or would exceed the idle connections allowed for its connection string
+// is left for core_hdb_pool_reap to disconnect instead.
+// Parameters:
+// conn_str - connection string the connection was opened with
+// conn_h   - connected ODBC connection handle.  The pool takes ownership of it.
+// created  - when the connection was opened
+// reusable - false if the connection is known to be unusable (e.g., the rollback failed)
+
+void core_hdb_pool_release( _In_ zend_string* conn_str, _In_ SQLHANDLE conn_h, _In_ time_t created, _In_ bool reusable )
+{
+    pooled_conn conn = { conn_h, created, 0 };
+
+    if( reusable && !reset_session( conn_h )) {
+
+        LOG( SEV_NOTICE, "core_hdb_pool_release: The session could not be reset, so the connection is not pooled." );
+        reusable = false;
+    }
+
+    std::lock_guard<std::mutex> lock( g_conn_pool_mutex );
+
+    conn.released = time( NULL );
+    if( !reusable || is_conn_expired( conn, conn.released )) {
+        reap( conn_h );
+        return;
+    }
+
+    try {
+
+        std::vector<pooled_conn>& idle = g_conn_pool[ std::string( ZSTR_VAL( conn_str ), ZSTR_LEN( conn_str )) ];
+        if( static_cast<zend_long>( idle.size() ) >= g_conn_pool_policy.max_idle ) {
+            reap( conn_h );
+            return;
+        }
+
+        idle.push_back( conn );
+    }
+    catch( std::bad_alloc& ) {
+
+        LOG( SEV_ERROR, "core_hdb_pool_release: Failed memory allocation for the connection pool." );
+        reap( conn_h );
+    }
+}
+
+// core_hdb_pool_reap
+// Closes the idle connections that stayed in the pool past the idle timeout (keeping the minimum number of idle
+// connections for each connection string) or past their lifetime, then disconnects them along with the connections
+// set aside by core_hdb_pool_checkout and core_hdb_pool_release.  Called by the driver once a request is over, so
+// that no script waits for these disconnects.
+
+void core_hdb_pool_reap( void )
+{
+    std::vector<SQLHANDLE> reaped;
+    {
+        std::lock_guard<std::mutex> lock( g_conn_pool_mutex );
+
+        time_t now = time( NULL );
+        for( conn_pool_map::iterator idle = g_conn_pool.begin(); idle != g_conn_pool.end(); ++idle ) {
+
+            std::vector<pooled_conn>& conns = idle->second;
+            std::vector<pooled_conn> kept;
+            kept.reserve( conns.size() );
+
+            // the least recently released connections come first, so they're the ones that go past the minimum
+            zend_long removable = static_cast<zend_long>( conns.size() ) - g_conn_pool_policy.min_idle;
+            for( size_t i = 0; i < conns.size(); ++i ) {
+
+                if( is_conn_expired( conns[ i ], now ) || ( removable > 0 && is_conn_idle_too_long( conns[ i ], now ))) {
+                    reap( conns[ i ].handle );
+                    --removable;
+                }
+                else {
+                    kept.push_back( conns[ i ] );
+                }
+            }
+            conns.swap( kept );
+        }
+
+        reaped.swap( g_conn_pool_reap );
+    }
+
+    for( size_t i = 0; i < reaped.size(); ++i ) {
+        disconnect( reaped[ i ] );
+    }
+}
+
+// core_hdb_pool_shutdown
+// Disconnects and frees all the connections in the pool.  Called at module shutdown, before the environment
+// handles are freed.
+
+void core_hdb_pool_shutdown( void )
+{
+    std::lock_guard<std::mutex> lock( g_conn_pool_mutex );
+
+    for( conn_pool_map::iterator idle = g_conn_pool.begin(); idle != g_conn_pool.end(); ++idle ) {
+        for( size_t i = 0; i < idle->second.size(); ++i ) {
+            disconnect( idle->second[ i ].handle );
+        }
+    }
+    g_conn_pool.clear();
+
+    for( size_t i = 0; i < g_conn_pool_reap.size(); ++i ) {
+        disconnect( g_conn_pool_reap[ i ] );
+    }
+    g_conn_pool_reap.clear();
+}
+
+// *** internal pool functions ***
+
+namespace {
+
+// disconnect from the server and free the connection handle
+void disconnect( _In_ SQLHANDLE conn_h )
+{
+    ::SQLDisconnect( conn_h );
+    ::SQLFreeHandle( SQL_HANDLE_DBC, conn_h );
+}
+
+// ask the driver whether the connection was lost.  This doesn't go to the server, so a connection the driver
+// hasn't noticed is gone yet is reported as alive.
+bool is_conn_dead( _In_ SQLHANDLE conn_h )
+{
+    SQLUINTEGER dead = SQL_CD_FALSE;
+    SQLRETURN r = ::SQLGetConnectAttr( conn_h, SQL_ATTR_CONNECTION_DEAD, &dead, SQL_IS_UINTEGER, NULL );
+
+    return !SQL_SUCCEEDED( r ) || dead == SQL_CD_TRUE;
+}
+
+// whether a connection was opened longer ago than the maximum lifetime allows
+bool is_conn_expired( _In_ pooled_conn const& conn, _In_ time_t now )
+{
+    return g_conn_pool_policy.max_lifetime > 0 && now - conn.created >= g_conn_pool_policy.max_lifetime;
+}
+
+// whether a connection has been idle in the pool longer than the idle timeout allows
+bool is_conn_idle_too_long( _In_ pooled_conn const& conn, _In_ time_t now )
+{
+    return g_conn_pool_policy.idle_timeout > 0 && now - conn.released >= g_conn_pool_policy.idle_timeout;
+}
+
+// set a connection aside to be disconnected by core_hdb_pool_reap.  Called with the pool locked.
+void reap( _In_ SQLHANDLE conn_h )
+{
+    try {
+        g_conn_pool_reap.push_back( conn_h );
+    }
+    catch( std::bad_alloc& ) {
+        disconnect( conn_h );
+    }
+}
+
+// run the validation query on a connection, which fails if the server can't be reached
+bool validate_conn( _In_ SQLHANDLE conn_h )
+{
+    SQLHANDLE stmt_h = SQL_NULL_HANDLE;
+    if( !SQL_SUCCEEDED( ::SQLAllocHandle( SQL_HANDLE_STMT, conn_h, &stmt_h ))) {
+        return false;
+    }
+
+    bool valid = SQL_SUCCEEDED( ::SQLExecDirect( stmt_h, reinterpret_cast<SQLCHAR*>( const_cast<char*>( VALIDATION_QUERY )), SQL_NTS ));
+    ::SQLFreeHandle( SQL_HANDLE_STMT, stmt_h );
+
+    return valid;
+}
+
+// put the session back in the state a new connection starts in.  Errors aren't reported, since this is
+// done while the connection is being closed; the connection just isn't reused.
+bool reset_session( _In_ SQLHANDLE conn_h )
+{
+    if( !SQL_SUCCEEDED( ::SQLEndTran( SQL_HANDLE_DBC, conn_h, SQL_ROLLBACK )) ||
+        !SQL_SUCCEEDED( ::SQLSetConnectAttr( conn_h, SQL_ATTR_AUTOCOMMIT, reinterpret_cast<SQLPOINTER>( SQL_AUTOCOMMIT_ON ),
+                                             SQL_IS_UINTEGER ))) {
+        return false;
+    }
+
+    SQLHANDLE stmt_h = SQL_NULL_HANDLE;
+    if( !SQL_SUCCEEDED( ::SQLAllocHandle( SQL_HANDLE_STMT, conn_h, &stmt_h ))) {
+        return false;
+    }
+
+    std::vector<std::string> keys;
+    SQLCHAR key[ SESSION_VARIABLE_KEY_LEN ];
+    SQLLEN key_len = 0;
+    SQLRETURN r = ::SQLExecDirect( stmt_h, reinterpret_cast<SQLCHAR*>( const_cast<char*>( SESSION_VARIABLES_QUERY )), SQL_NTS );
+
+    if( SQL_SUCCEEDED( r )) {
+        r = ::SQLBindCol( stmt_h, 1, SQL_C_CHAR, key, SESSION_VARIABLE_KEY_LEN, &key_len );
+    }
+    while( SQL_SUCCEEDED( r ) && SQL_SUCCEEDED( r = ::SQLFetch( stmt_h ))) {
+        if( key_len > 0 && key_len < SESSION_VARIABLE_KEY_LEN ) {
+            keys.push_back( std::string( reinterpret_cast<char*>( key ), key_len ));
+        }
+    }
+
+    bool reset = ( r == SQL_NO_DATA );
+    ::SQLFreeStmt( stmt_h, SQL_CLOSE );
+    ::SQLFreeStmt( stmt_h, SQL_UNBIND );
+
+    for( size_t i = 0; reset && i < keys.size(); ++i ) {
+
+        // quotes in the name are doubled to make it a string literal
+        std::string unset( "UNSET '" );
+        for( size_t c = 0; c < keys[ i ].length(); ++c ) {
+            if( keys[ i ][ c ] == '\'' ) {
+                unset += '\'';
+            }
+            unset += keys[ i ][ c ];
+        }
+        unset += "'";
+
+        reset = SQL_SUCCEEDED( ::SQLExecDirect( stmt_h, reinterpret_cast<SQLCHAR*>( &unset[0] ), static_cast<SQLINTEGER>( unset.length() )));
+        ::SQLFreeStmt( stmt_h, SQL_CLOSE );
+    }
+
+    ::SQLFreeHandle( SQL_HANDLE_STMT, stmt_h );
+
+    return reset;
+}
+
+}   // namespace
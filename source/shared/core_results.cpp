@@ -73,8 +73,9 @@ bool get_bit( _In_ void* ptr, _In_ unsigned int bit )
 SQLPOINTER read_lob_field( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index, _In_ hdb_buffered_result_set::meta_data& meta,
                            _In_ zend_long mem_used );
 
-// dtor for each row in the cache
-void cache_row_dtor( _In_ zval* data );
+
+// determine the C type and buffer size of a column bound by hdb_bound_result_set
+bool bound_column_type( _In_ hdb_column_desc const& desc, _Out_ SQLSMALLINT& c_type, _Out_ SQLLEN& length );
 
 size_t get_float_precision( _In_ SQLLEN buffer_length, _In_ size_t unitsize)
 {
@@ -315,18 +316,6 @@ SQLRETURN string_to_number( _In_z_ Char* string_data, SQLLEN str_len, _Out_write
   
 }
 
-// "closure" for the hash table destructor
-struct row_dtor_closure {
-
-    hdb_buffered_result_set* results;
-    BYTE* row_data;
-
-    row_dtor_closure( _In_ hdb_buffered_result_set* st, _In_ BYTE* row ) :
-        results( st ), row_data( row )
-    {
-    }                      
-};
-
 hdb_error* odbc_get_diag_rec( _In_ hdb_stmt* odbc, _In_ SQLSMALLINT record_number )
 {
     SQLWCHAR wsql_state[ SQL_SQLSTATE_BUFSIZE ];
@@ -378,7 +367,11 @@ hdb_result_set::hdb_result_set( _In_ hdb_stmt* stmt ) :
 // This object simply wraps ODBC function calls
 
 hdb_odbc_result_set::hdb_odbc_result_set( _In_ hdb_stmt* stmt ) : 
-    hdb_result_set( stmt )
+    hdb_result_set( stmt ),
+    prefetched( false ),
+    on_prefetched_row( false ),
+    prefetch_result( SQL_NO_DATA ),
+    reporting_prefetch_warning( false )
 {
 }
 
@@ -389,9 +382,55 @@ hdb_odbc_result_set::~hdb_odbc_result_set( void )
 SQLRETURN hdb_odbc_result_set::fetch( _In_ SQLSMALLINT orientation, _In_ SQLLEN offset )
 {
     HDB_ASSERT( odbc != NULL, "Invalid statement handle" );
+
+    // has_rows left the cursor on the first row while the caller still sees it before the first row, so the first
+    // row is returned as it is and moves relative to the start become absolute ones
+    if( on_prefetched_row ) {
+
+        on_prefetched_row = false;
+
+        switch( orientation ) {
+            case SQL_FETCH_NEXT:
+            case SQL_FETCH_FIRST:
+                return prefetched_row();
+            case SQL_FETCH_ABSOLUTE:
+                if( offset == 1 ) {
+                    return prefetched_row();
+                }
+                break;
+            case SQL_FETCH_RELATIVE:
+                orientation = SQL_FETCH_ABSOLUTE;
+                offset = ( offset > 0 ) ? offset : 0;
+                break;
+            default:
+                break;
+        }
+
+        prefetch_warning.reset();
+    }
+
     return core::SQLFetchScroll( odbc, orientation, offset );
 }
 
+// return the row has_rows fetched, reporting the warning fetching it returned as the fetch of the row would have
+SQLRETURN hdb_odbc_result_set::prefetched_row( void )
+{
+    if( prefetch_warning ) {
+
+        // the error handler reads the warning back through get_diag_rec while it's reported
+        reporting_prefetch_warning = true;
+        CHECK_SQL_ERROR_OR_WARNING( prefetch_result, odbc ) {
+            reporting_prefetch_warning = false;
+            prefetch_warning.reset();
+            throw core::CoreException();
+        }
+        reporting_prefetch_warning = false;
+        prefetch_warning.reset();
+    }
+
+    return prefetch_result;
+}
+
 SQLRETURN hdb_odbc_result_set::get_data( _In_ SQLUSMALLINT field_index, _In_ SQLSMALLINT target_type,
                                             _Out_writes_opt_(buffer_length) SQLPOINTER buffer, _In_ SQLLEN buffer_length, _Inout_ SQLLEN* out_buffer_length,
                                             _In_ bool handle_warning )
@@ -412,6 +451,17 @@ SQLRETURN hdb_odbc_result_set::get_diag_field( _In_ SQLSMALLINT record_number, _
 hdb_error* hdb_odbc_result_set::get_diag_rec( _In_ SQLSMALLINT record_number )
 {
     HDB_ASSERT( odbc != NULL, "Invalid statement handle" );
+
+    // the warning of the prefetched row is reported after other calls may have cleared it from the handle
+    if( reporting_prefetch_warning ) {
+
+        if( record_number > 1 ) {
+            return NULL;
+        }
+        return new (hdb_malloc( sizeof( hdb_error )))
+            hdb_error( prefetch_warning->sqlstate, prefetch_warning->native_message, prefetch_warning->native_code );
+    }
+
     return odbc_get_diag_rec( odbc, record_number );
 }
 
@@ -421,20 +471,57 @@ SQLLEN hdb_odbc_result_set::row_count( )
     return core::SQLRowCount( odbc );
 }
 
+// fetches the first row and keeps the cursor on it for the first fetch
+bool hdb_odbc_result_set::has_rows( void )
+{
+    HDB_ASSERT( odbc != NULL, "Invalid statement handle" );
+
+    if( !prefetched ) {
+
+        prefetched = true;
+        prefetch_result = ::SQLFetchScroll( odbc->handle(), SQL_FETCH_NEXT, 0 );
+
+        CHECK_SQL_ERROR( prefetch_result, odbc ) {
+            throw core::CoreException();
+        }
+
+        // the warning is kept so the fetch that returns the row reports it as well
+        if( prefetch_result == SQL_SUCCESS_WITH_INFO ) {
+            prefetch_warning = odbc_get_diag_rec( odbc, 1 );
+            CHECK_SQL_WARNING( prefetch_result, odbc );
+        }
+
+        on_prefetched_row = true;
+    }
+
+    return prefetch_result != SQL_NO_DATA;
+}
+
 
 // Buffered result set
 // This class holds a result set in memory
 
-hdb_buffered_result_set::hdb_buffered_result_set( _Inout_ hdb_stmt* stmt ) :
+hdb_buffered_result_set::hdb_buffered_result_set( _Inout_ hdb_stmt* stmt, _In_ bool columnar_layout ) :
     hdb_result_set( stmt ),
-    cache(NULL),
+    chunk_count(0),
+    chunk_capacity(0),
+    chunk_size(0),
+    row_size(0),
+    rows_per_chunk(0),
+    columnar(columnar_layout),
+    column_null_bytes(0),
+    heap(NULL),
+    heap_next(NULL),
+    heap_left(0),
+    rows(-1),
+    has_lobs(false),
     col_count(0),
     current(0),
     last_field_index(-1),
     read_so_far(0),
     temp_length(0)
 {
-    col_count = core::SQLNumResultCols( stmt );
+    col_count = stmt->num_result_cols();
     // there is no result set to buffer
     if( col_count == 0 ) {
         return;
@@ -475,11 +562,18 @@ hdb_buffered_result_set::hdb_buffered_result_set( _Inout_ hdb_stmt* stmt ) :
     HDB_ENCODING encoding = (( stmt->encoding() == HDB_ENCODING_DEFAULT ) ? stmt->conn->encoding() :
         stmt->encoding());
 
+    // strings are buffered as the UTF-8 the ODBC driver returns when the connection asked for it (CHAR_AS_UTF8),
+    // so they are neither widened here nor converted back when they are fetched
+    bool utf8_as_char = ( encoding == HDB_ENCODING_UTF8 && stmt->conn->char_as_utf8 );
+
     // get the meta data and calculate the size of a row buffer
     SQLULEN offset = null_bytes;
     for( SQLSMALLINT i = 0; i < col_count; ++i ) {
 				
-        core::SQLDescribeColW( stmt, i + 1, NULL, 0, NULL, &meta[i].type, &meta[i].length, &meta[i].scale, NULL );
+        hdb_column_desc& desc = stmt->col_desc( i );
+        meta[i].type = desc.sql_type;
+        meta[i].length = desc.length;
+        meta[i].scale = desc.decimal_digits;
 
         offset = align_to<sizeof(SQLPOINTER)>( offset );
         meta[i].offset = offset;
@@ -491,9 +585,7 @@ hdb_buffered_result_set::hdb_buffered_result_set( _Inout_ hdb_stmt* stmt ) :
             case SQL_DECIMAL:
             case SQL_GUID:
             case SQL_NUMERIC:
-                core::SQLColAttributeW( stmt, i + 1, SQL_DESC_DISPLAY_SIZE, NULL, 0, NULL,
-                                       reinterpret_cast<SQLLEN*>( &meta[i].length ) );
-                meta[i].length += sizeof( char ) + sizeof( SQLULEN ); // null terminator space
+                meta[i].length = desc.display_size + sizeof( char ) + sizeof( SQLULEN ); // null terminator space
                 offset += meta[i].length;
                 break;
             case SQL_CHAR:
@@ -504,7 +596,12 @@ hdb_buffered_result_set::hdb_buffered_result_set( _Inout_ hdb_stmt* stmt ) :
                 else {
                     // If encoding is set to UTF-8, the following types are not necessarily column size.
                     // We need to call SQLGetData with c_type SQL_C_WCHAR and set the size accordingly. 
-                    if ( encoding == HDB_ENCODING_UTF8 ) {
+                    if ( utf8_as_char ) {
+                        meta[i].length *= 3;    // each character is up to 3 bytes of UTF-8
+                        meta[i].length += sizeof( SQLULEN ) + sizeof( char ); // length plus null terminator space
+                        offset += meta[i].length;
+                    }
+                    else if ( encoding == HDB_ENCODING_UTF8 ) {
                         meta[i].length *= sizeof( WCHAR );
                         meta[i].length += sizeof( SQLULEN ) + sizeof( WCHAR ); // length plus null terminator space
                         offset += meta[i].length;
@@ -535,6 +632,11 @@ hdb_buffered_result_set::hdb_buffered_result_set( _Inout_ hdb_stmt* stmt ) :
                 if( meta[i].length == hdb_buffered_result_set::meta_data::SIZE_UNKNOWN ) {
                     offset += sizeof( void* );
                 }
+                else if ( utf8_as_char ) {
+                    meta[i].length *= 3;    // each UTF-16 code unit is up to 3 bytes of UTF-8
+                    meta[i].length += sizeof( SQLULEN ) + sizeof( char ); // length plus null terminator space
+                    offset += meta[i].length;
+                }
                 else {
                     meta[i].length *= sizeof( WCHAR );
                     meta[i].length += sizeof( SQLULEN ) + sizeof( WCHAR ); // length plus null terminator space
@@ -557,9 +659,7 @@ hdb_buffered_result_set::hdb_buffered_result_set( _Inout_ hdb_stmt* stmt ) :
             //case SQL_SS_TIME2:
             //case SQL_SS_TIMESTAMPOFFSET:
             case SQL_TYPE_TIMESTAMP:
-                core::SQLColAttributeW( stmt, i + 1, SQL_DESC_DISPLAY_SIZE, NULL, 0, NULL, 
-                                       reinterpret_cast<SQLLEN*>( &meta[i].length ) );
-                meta[i].length += sizeof(char) + sizeof( SQLULEN );  // null terminator space
+                meta[i].length = desc.display_size + sizeof(char) + sizeof( SQLULEN );  // null terminator space
                 offset += meta[i].length;
                 break;
 
@@ -603,7 +703,7 @@ hdb_buffered_result_set::hdb_buffered_result_set( _Inout_ hdb_stmt* stmt ) :
             case SQL_LONGVARCHAR:
                 // If encoding is set to UTF-8, the following types are not necessarily column size.
                 // We need to call SQLGetData with c_type SQL_C_WCHAR and set the size accordingly. 
-                if ( encoding == HDB_ENCODING_UTF8 ) {
+                if ( encoding == HDB_ENCODING_UTF8 && !utf8_as_char ) {
                     meta[i].c_type = SQL_C_WCHAR;
                 }
                 else {
@@ -621,7 +721,7 @@ hdb_buffered_result_set::hdb_buffered_result_set( _Inout_ hdb_stmt* stmt ) :
             case SQL_WLONGVARCHAR:
             case SQL_WCHAR:
             case SQL_WVARCHAR:
-                meta[i].c_type = SQL_C_WCHAR;
+                meta[i].c_type = utf8_as_char ? SQL_C_CHAR : SQL_C_WCHAR;
                 break;
 
             case SQL_BIT:
@@ -643,22 +743,69 @@ hdb_buffered_result_set::hdb_buffered_result_set( _Inout_ hdb_stmt* stmt ) :
 
     }
 
+    // LOB fields are kept outside of the row and have to be freed with it
+    for( SQLSMALLINT i = 0; i < col_count; ++i ) {
+        if( meta[i].length == hdb_buffered_result_set::meta_data::SIZE_UNKNOWN ) {
+            has_lobs = true;
+        }
+    }
+
+    // the rows are all the same size, so they are stored in blocks and found by their index
+    hdb_malloc_auto_ptr<unsigned char> scratch;
+    if( columnar ) {
+
+        // each block starts with a null bitmap per column, followed by a vector per column.  Numbers are kept in
+        // the vectors while strings are copied to the string heap and their vector entry points to them, so that
+        // scanning a column touches only that column's memory.
+        SQLULEN scratch_size = 0;
+        row_size = 0;
+        for( SQLSMALLINT i = 0; i < col_count; ++i ) {
+
+            if( meta[i].c_type == SQL_C_LONG || meta[i].c_type == SQL_C_DOUBLE ) {
+                meta[i].width = align_to<sizeof(SQLPOINTER)>( meta[i].length );
+            }
+            else {
+                meta[i].width = sizeof( void* );
+            }
+            row_size += meta[i].width;
+
+            if( in_heap( i ) && meta[i].length > scratch_size ) {
+                scratch_size = meta[i].length;
+            }
+        }
+
+        rows_per_chunk = ( row_size < ROW_CHUNK_SIZE ) ? ROW_CHUNK_SIZE / row_size : 1;
+        column_null_bytes = align_to<sizeof(SQLPOINTER)>( ( rows_per_chunk / 8 ) + 1 );
+        chunk_size = col_count * column_null_bytes;
+        for( SQLSMALLINT i = 0; i < col_count; ++i ) {
+            meta[i].offset = chunk_size;
+            chunk_size += rows_per_chunk * meta[i].width;
+        }
+
+        // strings are read here before they are copied to the heap
+        if( scratch_size > 0 ) {
+            scratch = static_cast<unsigned char*>( hdb_malloc( scratch_size + sizeof( SQLULEN )));
+        }
+    }
+    else {
+
+        // (offset from the above loop has the size of the row buffer necessary)
+        // keep each row aligned the way a separately allocated row buffer would be
+        row_size = align_to<sizeof(SQLPOINTER)>( offset );
+        rows_per_chunk = ( row_size < ROW_CHUNK_SIZE ) ? ROW_CHUNK_SIZE / row_size : 1;
+        chunk_size = rows_per_chunk * row_size;
+    }
+
     // read the data into the cache
-    // (offset from the above loop has the size of the row buffer necessary)
     zend_long mem_used = 0;
-    size_t row_count = 0;
-    // 10 is an arbitrary number for now for the initial size of the cache
-    ALLOC_HASHTABLE( cache );
-    core::hdb_zend_hash_init( *stmt, cache, 10 /* # of buckets */, cache_row_dtor /*dtor*/, 0 /*persistent*/ );
+    rows = 0;
 
     try {
         while( core::SQLFetchScroll( stmt, SQL_FETCH_NEXT, 0 ) != SQL_NO_DATA ) {
             
-            // allocate the row buffer
-            hdb_malloc_auto_ptr<unsigned char> rowAuto;
-            rowAuto = static_cast<unsigned char*>( hdb_malloc( offset ));
-            unsigned char* row = rowAuto.get();
-            memset( row, 0, offset );
+            // the row comes zeroed from its block
+            add_row();
+            SQLULEN row = static_cast<SQLULEN>( rows - 1 );
 
             // read the fields into the row buffer
             for( SQLSMALLINT i = 0; i < col_count; ++i ) {
@@ -675,7 +822,7 @@ hdb_buffered_result_set::hdb_buffered_result_set( _Inout_ hdb_stmt* stmt ) :
                         if( meta[i].length == hdb_buffered_result_set::meta_data::SIZE_UNKNOWN ) {
 
                             out_buffer_length = &out_buffer_temp;
-                            SQLPOINTER* lob_addr = reinterpret_cast<SQLPOINTER*>( &row[ meta[i].offset ] );
+                            SQLPOINTER* lob_addr = reinterpret_cast<SQLPOINTER*>( field_cell( row, i ));
                             *lob_addr = read_lob_field( stmt, i, meta[i], mem_used );
                             // a NULL pointer means NULL field
                             if( *lob_addr == NULL ) {
@@ -695,10 +842,27 @@ hdb_buffered_result_set::hdb_buffered_result_set( _Inout_ hdb_stmt* stmt ) :
                                 throw core::CoreException();
                             }
 
-                            buffer = row + meta[i].offset + sizeof( SQLULEN );
-                            out_buffer_length = reinterpret_cast<SQLLEN*>( row + meta[i].offset );
+                            unsigned char* field = in_heap( i ) ? scratch.get() : field_cell( row, i );
+                            buffer = field + sizeof( SQLULEN );
+                            out_buffer_length = reinterpret_cast<SQLLEN*>( field );
                             core::SQLGetData( stmt, i + 1, meta[i].c_type, buffer, meta[i].length, out_buffer_length, 
                                               false );
+
+                            // keep only as much of the string as was read, with its length and terminator, in the heap
+                            if( in_heap( i ) && *out_buffer_length != SQL_NULL_DATA ) {
+
+                                SQLULEN terminator = ( meta[i].c_type == SQL_C_WCHAR ) ? sizeof( WCHAR ) : sizeof( char );
+                                SQLULEN data_len = static_cast<SQLULEN>( *out_buffer_length );
+                                if( data_len > meta[i].length - sizeof( SQLULEN ) - terminator ) {
+                                    data_len = meta[i].length - sizeof( SQLULEN ) - terminator;
+                                }
+
+                                unsigned char* entry = heap_alloc( sizeof( SQLULEN ) + data_len + terminator );
+                                *reinterpret_cast<SQLULEN*>( entry ) = data_len;
+                                memcpy_s( entry + sizeof( SQLULEN ), data_len + terminator, buffer, data_len );
+                                memset( entry + sizeof( SQLULEN ) + data_len, 0, terminator );
+                                *reinterpret_cast<unsigned char**>( field_cell( row, i )) = entry;
+                            }
                         }
                         break;
 
@@ -711,7 +875,7 @@ hdb_buffered_result_set::hdb_buffered_result_set( _Inout_ hdb_stmt* stmt ) :
 
                                 throw core::CoreException();
                             }
-                            buffer = row + meta[i].offset;
+                            buffer = field_cell( row, i );
                             out_buffer_length = &out_buffer_temp;
                             core::SQLGetData( stmt, i + 1, meta[i].c_type, buffer, meta[i].length, out_buffer_length, 
                                               false );
@@ -724,26 +888,16 @@ hdb_buffered_result_set::hdb_buffered_result_set( _Inout_ hdb_stmt* stmt ) :
                 }
 
                 if( *out_buffer_length == SQL_NULL_DATA ) {
-                    set_bit( row, i );
+                    set_null( row, i );
                 }
             }
 
-            row_count++;
-            HDB_ASSERT( row_count < INT_MAX, "Hard maximum of 2 billion rows exceeded in a buffered query" );
-
-            // add it to the cache
-            row_dtor_closure cl( this, row );
-            hdb_zend_hash_next_index_insert_mem( *stmt, cache, &cl, sizeof(row_dtor_closure) );
-            rowAuto.transferred();
+            HDB_ASSERT( rows < INT_MAX, "Hard maximum of 2 billion rows exceeded in a buffered query" );
         }   
     } 
     catch( core::CoreException& ) {
         // free the rows
-        if( cache ) {
-            zend_hash_destroy( cache );
-            FREE_HASHTABLE( cache );
-            cache = NULL;
-        }
+        free_rows();
         throw;
     }
 
@@ -752,11 +906,7 @@ hdb_buffered_result_set::hdb_buffered_result_set( _Inout_ hdb_stmt* stmt ) :
 hdb_buffered_result_set::~hdb_buffered_result_set( void )
 {
     // free the rows
-    if( cache ) {
-        zend_hash_destroy( cache );
-        FREE_HASHTABLE( cache );
-        cache = NULL;
-    }
+    free_rows();
 }
 
 SQLRETURN hdb_buffered_result_set::fetch( _Inout_ SQLSMALLINT orientation, _Inout_opt_ SQLLEN offset )
@@ -825,10 +975,8 @@ SQLRETURN hdb_buffered_result_set::get_data( _In_ SQLUSMALLINT field_index, _In_
         read_so_far = 0;
     }
 
-    unsigned char* row = get_row();
-
     // if the field is null, then return SQL_NULL_DATA
-    if( get_bit( row, field_index )) {
+    if( is_null( static_cast<SQLULEN>( current - 1 ), field_index )) {
         *out_buffer_length = SQL_NULL_DATA;
         return SQL_SUCCESS;
     }
@@ -870,12 +1018,144 @@ SQLRETURN hdb_buffered_result_set::get_diag_field( _In_ SQLSMALLINT record_numbe
     return SQL_SUCCESS;
 }
 
-unsigned char* hdb_buffered_result_set::get_row( void )
+// address of a field of the current row, in the format of a row layout field: numbers as they are, strings (and
+// binary) as their length followed by the data, and LOBs as a pointer to their length followed by the data
+unsigned char* hdb_buffered_result_set::get_field( _In_ SQLSMALLINT field_index )
+{
+    HDB_ASSERT( current > 0 && current <= rows, "Failed to find row %1!d! in the cache", current );
+    unsigned char* field = field_cell( static_cast<SQLULEN>( current - 1 ), field_index );
+
+    // the string heap entry has the same format as a string kept in a row
+    if( in_heap( field_index )) {
+        return *reinterpret_cast<unsigned char**>( field );
+    }
+    return field;
+}
+
+// where a field is stored in its block
+unsigned char* hdb_buffered_result_set::field_cell( _In_ SQLULEN row, _In_ SQLSMALLINT field_index )
+{
+    unsigned char* chunk = chunks.get()[ row / rows_per_chunk ];
+    SQLULEN slot = row % rows_per_chunk;
+
+    if( columnar ) {
+        return chunk + meta[ field_index ].offset + slot * meta[ field_index ].width;
+    }
+    return chunk + slot * row_size + meta[ field_index ].offset;
+}
+
+// the null flags are bits at the start of each row, or a bitmap per column at the start of each block when columnar
+void hdb_buffered_result_set::set_null( _In_ SQLULEN row, _In_ SQLSMALLINT field_index )
+{
+    unsigned char* chunk = chunks.get()[ row / rows_per_chunk ];
+    SQLULEN slot = row % rows_per_chunk;
+
+    if( columnar ) {
+        set_bit( chunk + field_index * column_null_bytes, static_cast<unsigned int>( slot ));
+    }
+    else {
+        set_bit( chunk + slot * row_size, field_index );
+    }
+}
+
+bool hdb_buffered_result_set::is_null( _In_ SQLULEN row, _In_ SQLSMALLINT field_index )
+{
+    unsigned char* chunk = chunks.get()[ row / rows_per_chunk ];
+    SQLULEN slot = row % rows_per_chunk;
+
+    if( columnar ) {
+        return get_bit( chunk + field_index * column_null_bytes, static_cast<unsigned int>( slot ));
+    }
+    return get_bit( chunk + slot * row_size, field_index );
+}
+
+// strings and binary fields of a known size are kept in the string heap when columnar
+bool hdb_buffered_result_set::in_heap( _In_ SQLSMALLINT field_index )
+{
+    return columnar && meta[ field_index ].length != hdb_buffered_result_set::meta_data::SIZE_UNKNOWN &&
+        meta[ field_index ].c_type != SQL_C_LONG && meta[ field_index ].c_type != SQL_C_DOUBLE;
+}
+
+// carve an entry out of the string heap.  Entries bigger than a heap block get a block of their own.
+unsigned char* hdb_buffered_result_set::heap_alloc( _In_ SQLULEN size )
+{
+    size = align_to<sizeof(SQLPOINTER)>( size );
+
+    if( size > heap_left ) {
+
+        SQLULEN block_size = ( size + sizeof( void* ) > HEAP_BLOCK_SIZE ) ? size + sizeof( void* ) : HEAP_BLOCK_SIZE;
+        unsigned char* block = static_cast<unsigned char*>( hdb_malloc( block_size ));
+        *reinterpret_cast<unsigned char**>( block ) = heap;
+        heap = block;
+        heap_next = block + sizeof( void* );
+        heap_left = block_size - sizeof( void* );
+    }
+
+    unsigned char* entry = heap_next;
+    heap_next += size;
+    heap_left -= size;
+    return entry;
+}
+
+// add a zeroed row to the end of the cache, starting a new block when the last one is full
+void hdb_buffered_result_set::add_row( void )
 {
-    row_dtor_closure* cl_ptr;
-	cl_ptr = reinterpret_cast<row_dtor_closure*>(zend_hash_index_find_ptr(cache, static_cast<zend_ulong>(current - 1)));
-	HDB_ASSERT(cl_ptr != NULL, "Failed to find row %1!d! in the cache", current);
-    return cl_ptr->row_data;
+    SQLULEN slot = static_cast<SQLULEN>( rows ) % rows_per_chunk;
+
+    if( slot == 0 ) {
+
+        if( chunk_count == chunk_capacity ) {
+            chunk_capacity = ( chunk_capacity == 0 ) ? 16 : chunk_capacity * 2;
+            chunks.resize( chunk_capacity * sizeof( unsigned char* ));
+        }
+
+        unsigned char* chunk = static_cast<unsigned char*>( hdb_malloc( chunk_size ));
+        memset( chunk, 0, chunk_size );
+        chunks.get()[ chunk_count ] = chunk;
+        ++chunk_count;
+    }
+
+    ++rows;
+}
+
+// free the LOB data the rows point to, the string heap and then the blocks of rows
+void hdb_buffered_result_set::free_rows( void )
+{
+    if( has_lobs ) {
+
+        for( SQLLEN r = 0; r < rows; ++r ) {
+
+            for( SQLSMALLINT i = 0; i < col_count; ++i ) {
+
+                if( meta[i].length == hdb_buffered_result_set::meta_data::SIZE_UNKNOWN ) {
+
+                    void* out_of_row_data = *reinterpret_cast<void**>( field_cell( static_cast<SQLULEN>( r ), i ));
+                    if( out_of_row_data ) {
+                        hdb_free( out_of_row_data );
+                    }
+                }
+            }
+        }
+    }
+
+    while( heap ) {
+        unsigned char* previous = *reinterpret_cast<unsigned char**>( heap );
+        hdb_free( heap );
+        heap = previous;
+    }
+    heap_next = NULL;
+    heap_left = 0;
+
+    for( SQLULEN c = 0; c < chunk_count; ++c ) {
+        hdb_free( chunks.get()[ c ] );
+    }
+
+    chunks.reset();
+    chunk_count = 0;
+    chunk_capacity = 0;
+    if( rows > 0 ) {
+        rows = 0;
+    }
 }
 
 hdb_error* hdb_buffered_result_set::get_diag_rec( _In_ SQLSMALLINT record_number )
@@ -896,13 +1176,14 @@ SQLLEN hdb_buffered_result_set::row_count( )
 {
     last_error = NULL;
 
-	if ( cache ) {
-		return zend_hash_num_elements( cache );
-	}
-	else {
-		// returning -1 to represent getting the rowcount of an empty result set
-		return -1;
-	}
+	// rows is -1 to represent getting the rowcount of an empty result set
+	return rows;
+}
+
+// all the rows were read when the result set was created
+bool hdb_buffered_result_set::has_rows( void )
+{
+    return rows > 0;
 }
 
 // private functions
@@ -971,16 +1252,16 @@ SQLRETURN binary_to_string( _Inout_ SQLCHAR* field_data, _Inout_ SQLLEN& read_so
 SQLRETURN hdb_buffered_result_set::binary_to_system_string( _In_ SQLSMALLINT field_index, _Out_writes_z_(*out_buffer_length) void* buffer, _In_ SQLLEN buffer_length,
                                                                _Inout_ SQLLEN* out_buffer_length )
 {
-    SQLCHAR* row = get_row();
+    unsigned char* field = get_field( field_index );
     SQLCHAR* field_data = NULL;
 
     if( meta[ field_index ].length == hdb_buffered_result_set::meta_data::SIZE_UNKNOWN ) {
 
-        field_data = *reinterpret_cast<SQLCHAR**>( &row[ meta[ field_index ].offset ] ) + sizeof( SQLULEN );
+        field_data = *reinterpret_cast<SQLCHAR**>( field ) + sizeof( SQLULEN );
     }
     else {
 
-        field_data = &row[ meta[ field_index ].offset ] + sizeof( SQLULEN );
+        field_data = field + sizeof( SQLULEN );
     }
 
     return binary_to_string<char>( field_data, read_so_far, buffer, buffer_length, out_buffer_length, last_error );
@@ -989,16 +1270,16 @@ SQLRETURN hdb_buffered_result_set::binary_to_system_string( _In_ SQLSMALLINT fie
 SQLRETURN hdb_buffered_result_set::binary_to_wide_string( _In_ SQLSMALLINT field_index, _Out_writes_z_(*out_buffer_length) void* buffer, _In_ SQLLEN buffer_length,
                                                              _Inout_ SQLLEN* out_buffer_length )
 {
-    SQLCHAR* row = get_row();
+    unsigned char* field = get_field( field_index );
     SQLCHAR* field_data = NULL;
 
     if( meta[ field_index ].length == hdb_buffered_result_set::meta_data::SIZE_UNKNOWN ) {
 
-        field_data = *reinterpret_cast<SQLCHAR**>( &row[ meta[ field_index ].offset ] ) + sizeof( SQLULEN );
+        field_data = *reinterpret_cast<SQLCHAR**>( field ) + sizeof( SQLULEN );
     }
     else {
 
-        field_data = &row[ meta[ field_index ].offset ] + sizeof( SQLULEN );
+        field_data = field + sizeof( SQLULEN );
     }
 
     return binary_to_string<WCHAR>( field_data, read_so_far, buffer, buffer_length, out_buffer_length, last_error );
@@ -1012,8 +1293,8 @@ SQLRETURN hdb_buffered_result_set::double_to_long( _In_ SQLSMALLINT field_index,
     HDB_ASSERT( buffer_length >= sizeof(SQLLEN), "Buffer length must be able to find a long in "
                    "hdb_buffered_result_set::double_to_long" );
 
-    unsigned char* row = get_row();
-    double* double_data = reinterpret_cast<double*>( &row[ meta[ field_index ].offset ] );
+    unsigned char* field = get_field( field_index );
+    double* double_data = reinterpret_cast<double*>( field );
     LONG* long_data = reinterpret_cast<LONG*>( buffer );
 
     if( *double_data < double( LONG_MIN ) || *double_data > double( LONG_MAX )) {
@@ -1040,8 +1321,8 @@ SQLRETURN hdb_buffered_result_set::double_to_system_string( _In_ SQLSMALLINT fie
     HDB_ASSERT( meta[ field_index ].c_type == SQL_C_DOUBLE, "Invalid conversion to system string" );
     HDB_ASSERT( buffer_length > 0, "Buffer length must be > 0 in hdb_buffered_result_set::double_to_system_string" );
 
-    unsigned char* row = get_row();
-    double* double_data = reinterpret_cast<double*>( &row[ meta[ field_index ].offset ] );
+    unsigned char* field = get_field( field_index );
+    double* double_data = reinterpret_cast<double*>( field );
     SQLRETURN r = SQL_SUCCESS;
 #ifdef _WIN32
     r = number_to_string<char>( double_data, buffer, buffer_length, out_buffer_length, last_error );
@@ -1057,8 +1338,8 @@ SQLRETURN hdb_buffered_result_set::double_to_wide_string( _In_ SQLSMALLINT field
     HDB_ASSERT( meta[ field_index ].c_type == SQL_C_DOUBLE, "Invalid conversion to wide string" );
     HDB_ASSERT( buffer_length > 0, "Buffer length must be > 0 in hdb_buffered_result_set::double_to_wide_string" );
 
-    unsigned char* row = get_row();
-    double* double_data = reinterpret_cast<double*>( &row[ meta[ field_index ].offset ] );
+    unsigned char* field = get_field( field_index );
+    double* double_data = reinterpret_cast<double*>( field );
     SQLRETURN r = SQL_SUCCESS;
 #ifdef _WIN32
     r = number_to_string<WCHAR>( double_data, buffer, buffer_length, out_buffer_length, last_error );
@@ -1074,9 +1355,9 @@ SQLRETURN hdb_buffered_result_set::long_to_double( _In_ SQLSMALLINT field_index,
     HDB_ASSERT( meta[ field_index ].c_type == SQL_C_LONG, "Invalid conversion to long" );
     HDB_ASSERT( buffer_length >= sizeof(double), "Buffer length must be able to find a long in hdb_buffered_result_set::double_to_long" );
 
-    unsigned char* row = get_row();
+    unsigned char* field = get_field( field_index );
     double* double_data = reinterpret_cast<double*>( buffer );
-    LONG* long_data = reinterpret_cast<LONG*>( &row[ meta[ field_index ].offset ] );
+    LONG* long_data = reinterpret_cast<LONG*>( field );
 
     *double_data = static_cast<LONG>( *long_data );
     *out_buffer_length = sizeof( double );
@@ -1089,8 +1370,8 @@ SQLRETURN hdb_buffered_result_set::long_to_system_string( _In_ SQLSMALLINT field
     HDB_ASSERT( meta[ field_index ].c_type == SQL_C_LONG, "Invalid conversion to system string" );
     HDB_ASSERT( buffer_length > 0, "Buffer length must be > 0 in hdb_buffered_result_set::long_to_system_string" );
 
-    unsigned char* row = get_row();
-    LONG* long_data = reinterpret_cast<LONG*>( &row[ meta[ field_index ].offset ] );
+    unsigned char* field = get_field( field_index );
+    LONG* long_data = reinterpret_cast<LONG*>( field );
     SQLRETURN r = SQL_SUCCESS;
 #ifdef _WIN32
     r = number_to_string<char>( long_data, buffer, buffer_length, out_buffer_length, last_error );
@@ -1106,8 +1387,8 @@ SQLRETURN hdb_buffered_result_set::long_to_wide_string( _In_ SQLSMALLINT field_i
     HDB_ASSERT( meta[ field_index ].c_type == SQL_C_LONG, "Invalid conversion to wide string" );
     HDB_ASSERT( buffer_length > 0, "Buffer length must be > 0 in hdb_buffered_result_set::long_to_wide_string" );
 
-    unsigned char* row = get_row();
-    LONG* long_data = reinterpret_cast<LONG*>( &row[ meta[ field_index ].offset ] );
+    unsigned char* field = get_field( field_index );
+    LONG* long_data = reinterpret_cast<LONG*>( field );
     SQLRETURN r = SQL_SUCCESS;
 #ifdef _WIN32
     r = number_to_string<WCHAR>( long_data, buffer, buffer_length, out_buffer_length, last_error );
@@ -1123,8 +1404,8 @@ SQLRETURN hdb_buffered_result_set::string_to_double( _In_ SQLSMALLINT field_inde
     HDB_ASSERT( meta[ field_index ].c_type == SQL_C_CHAR, "Invalid conversion from string to double" );
     HDB_ASSERT( buffer_length >= sizeof( double ), "Buffer needs to be big enough to hold a double" );
 
-    unsigned char* row = get_row();
-    char* string_data = reinterpret_cast<char*>( &row[ meta[ field_index ].offset ] ) + sizeof( SQLULEN );
+    unsigned char* field = get_field( field_index );
+    char* string_data = reinterpret_cast<char*>( field ) + sizeof( SQLULEN );
 
     return string_to_number<double>( string_data, meta[ field_index ].length, buffer, buffer_length, out_buffer_length, last_error );
 }
@@ -1135,8 +1416,8 @@ SQLRETURN hdb_buffered_result_set::wstring_to_double( _In_ SQLSMALLINT field_ind
     HDB_ASSERT( meta[ field_index ].c_type == SQL_C_WCHAR, "Invalid conversion from wide string to double" );
     HDB_ASSERT( buffer_length >= sizeof( double ), "Buffer needs to be big enough to hold a double" );
 
-    unsigned char* row = get_row();
-    SQLWCHAR* string_data = reinterpret_cast<SQLWCHAR*>( &row[ meta[ field_index ].offset ] ) + sizeof( SQLULEN ) / sizeof( SQLWCHAR );
+    unsigned char* field = get_field( field_index );
+    SQLWCHAR* string_data = reinterpret_cast<SQLWCHAR*>( field ) + sizeof( SQLULEN ) / sizeof( SQLWCHAR );
 
     return string_to_number<double>( string_data, meta[ field_index ].length, buffer, buffer_length, out_buffer_length, last_error );
 }
@@ -1147,8 +1428,8 @@ SQLRETURN hdb_buffered_result_set::string_to_long( _In_ SQLSMALLINT field_index,
     HDB_ASSERT( meta[ field_index ].c_type == SQL_C_CHAR, "Invalid conversion from string to long" );
     HDB_ASSERT( buffer_length >= sizeof( LONG ), "Buffer needs to be big enough to hold a long" );
 
-    unsigned char* row = get_row();
-    char* string_data = reinterpret_cast<char*>( &row[ meta[ field_index ].offset ] ) + sizeof( SQLULEN );
+    unsigned char* field = get_field( field_index );
+    char* string_data = reinterpret_cast<char*>( field ) + sizeof( SQLULEN );
 
     return string_to_number<LONG>( string_data, meta[ field_index ].length, buffer, buffer_length, out_buffer_length, last_error );
 }
@@ -1159,8 +1440,8 @@ SQLRETURN hdb_buffered_result_set::wstring_to_long( _In_ SQLSMALLINT field_index
     HDB_ASSERT( meta[ field_index ].c_type == SQL_C_WCHAR, "Invalid conversion from wide string to long" );
     HDB_ASSERT( buffer_length >= sizeof( LONG ), "Buffer needs to be big enough to hold a long" );
 
-    unsigned char* row = get_row();
-    SQLWCHAR* string_data = reinterpret_cast<SQLWCHAR*>( &row[ meta[ field_index ].offset ] ) + sizeof( SQLULEN ) / sizeof( SQLWCHAR );
+    unsigned char* field = get_field( field_index );
+    SQLWCHAR* string_data = reinterpret_cast<SQLWCHAR*>( field ) + sizeof( SQLULEN ) / sizeof( SQLWCHAR );
 
     return string_to_number<LONG>( string_data, meta[ field_index ].length, buffer, buffer_length, out_buffer_length, last_error );
 }
@@ -1172,20 +1453,20 @@ SQLRETURN hdb_buffered_result_set::system_to_wide_string( _In_ SQLSMALLINT field
     HDB_ASSERT( buffer_length % 2 == 0, "Odd buffer length passed to hdb_buffered_result_set::system_to_wide_string" );
 
     SQLRETURN r = SQL_ERROR;
-    unsigned char* row = get_row();
+    unsigned char* field = get_field( field_index );
 
     SQLCHAR* field_data = NULL;
     SQLULEN field_len = 0;
 
     if( meta[ field_index ].length == hdb_buffered_result_set::meta_data::SIZE_UNKNOWN ) {
 
-        field_len = **reinterpret_cast<SQLLEN**>( &row[ meta[ field_index ].offset ] );
-        field_data = *reinterpret_cast<SQLCHAR**>( &row[ meta[ field_index ].offset ] ) + sizeof( SQLULEN ) + read_so_far;
+        field_len = **reinterpret_cast<SQLLEN**>( field );
+        field_data = *reinterpret_cast<SQLCHAR**>( field ) + sizeof( SQLULEN ) + read_so_far;
     }
     else {
 
-        field_len = *reinterpret_cast<SQLLEN*>( &row[ meta[ field_index ].offset ] );
-        field_data = &row[ meta[ field_index ].offset ] + sizeof( SQLULEN ) + read_so_far;
+        field_len = *reinterpret_cast<SQLLEN*>( field );
+        field_data = field + sizeof( SQLULEN ) + read_so_far;
     }
 
     // all fields will be treated as ODBC returns varchar(max) fields:
@@ -1271,7 +1552,7 @@ SQLRETURN hdb_buffered_result_set::to_same_string( _In_ SQLSMALLINT field_index,
     HDB_ASSERT( last_error == 0, "Pending error for hdb_buffered_results_set::to_same_string" );
 
     SQLRETURN r = SQL_ERROR;
-    unsigned char* row = get_row();
+    unsigned char* field = get_field( field_index );
 
     // Set the amount of space necessary for null characters at the end of the data.
     SQLSMALLINT extra = 0;
@@ -1295,11 +1576,11 @@ SQLRETURN hdb_buffered_result_set::to_same_string( _In_ SQLSMALLINT field_index,
 
     if( meta[ field_index ].length == hdb_buffered_result_set::meta_data::SIZE_UNKNOWN ) {
 
-        field_data = *reinterpret_cast<SQLCHAR**>( &row[ meta[ field_index ].offset ] ) + sizeof( SQLULEN );
+        field_data = *reinterpret_cast<SQLCHAR**>( field ) + sizeof( SQLULEN );
     }
     else {
 
-        field_data = &row[ meta[ field_index ].offset ] + sizeof( SQLULEN );
+        field_data = field + sizeof( SQLULEN );
     }
 
     // all fields will be treated as ODBC returns varchar(max) fields:
@@ -1341,7 +1622,7 @@ SQLRETURN hdb_buffered_result_set::wide_to_system_string( _In_ SQLSMALLINT field
     HDB_ASSERT( last_error == 0, "Pending error for hdb_buffered_results_set::wide_to_system_string" );
 
     SQLRETURN r = SQL_ERROR;
-    unsigned char* row = get_row();
+    unsigned char* field = get_field( field_index );
 
     SQLCHAR* field_data = NULL;
     SQLLEN field_len = 0;
@@ -1356,13 +1637,13 @@ SQLRETURN hdb_buffered_result_set::wide_to_system_string( _In_ SQLSMALLINT field
 
         if( meta[ field_index ].length == hdb_buffered_result_set::meta_data::SIZE_UNKNOWN ) {
 
-            field_len = **reinterpret_cast<SQLLEN**>( &row[ meta[ field_index ].offset ] );
-            field_data = *reinterpret_cast<SQLCHAR**>( &row[ meta[ field_index ].offset ] ) + sizeof( SQLULEN ) + read_so_far;
+            field_len = **reinterpret_cast<SQLLEN**>( field );
+            field_data = *reinterpret_cast<SQLCHAR**>( field ) + sizeof( SQLULEN ) + read_so_far;
         }
         else {
 
-            field_len = *reinterpret_cast<SQLLEN*>( &row[ meta[ field_index ].offset ] );
-            field_data = &row[ meta[ field_index ].offset ] + sizeof( SQLULEN ) + read_so_far;
+            field_len = *reinterpret_cast<SQLLEN*>( field );
+            field_data = field + sizeof( SQLULEN ) + read_so_far;
         }
 
         if ( field_len == 0 ) { // empty string, no need for conversion
@@ -1441,8 +1722,8 @@ SQLRETURN hdb_buffered_result_set::to_long( _In_ SQLSMALLINT field_index, _Out_w
     HDB_ASSERT( meta[ field_index ].c_type == SQL_C_LONG, "Invalid conversion to long" );
     HDB_ASSERT( buffer_length >= sizeof( LONG ), "Buffer too small for SQL_C_LONG" );    // technically should ignore this
 
-    unsigned char* row = get_row();
-    LONG* long_data = reinterpret_cast<LONG*>( &row[ meta[ field_index ].offset ] );
+    unsigned char* field = get_field( field_index );
+    LONG* long_data = reinterpret_cast<LONG*>( field );
     memcpy_s( buffer, buffer_length, long_data, sizeof( LONG ));
     *out_buffer_length = sizeof( LONG );
 
@@ -1455,37 +1736,597 @@ SQLRETURN hdb_buffered_result_set::to_double( _In_ SQLSMALLINT field_index, _Out
     HDB_ASSERT( meta[ field_index ].c_type == SQL_C_DOUBLE, "Invalid conversion to double" );
     HDB_ASSERT( buffer_length >= sizeof( double ), "Buffer too small for SQL_C_DOUBLE" );  // technically should ignore this
 
-    unsigned char* row = get_row();
-    double* double_data = reinterpret_cast<double*>( &row[ meta[ field_index ].offset ] );
+    unsigned char* field = get_field( field_index );
+    double* double_data = reinterpret_cast<double*>( field );
     memcpy_s( buffer, buffer_length, double_data, sizeof( double ));
     *out_buffer_length = sizeof( double );
 
     return SQL_SUCCESS;
 }
 
-namespace {
 
-// called for each row in the cache when the cache is destroyed in the destructor
-void cache_row_dtor( _In_ zval* data )
+// Bound result set
+// This class binds the columns of a forward only result set and fetches them a block of rows at a time
+
+bool hdb_bound_result_set::is_bindable( _Inout_ hdb_stmt* stmt )
+{
+    // PrefetchRows of 1 asks for a row at a time
+    if( stmt->prefetch_rows < 2 ) {
+        return false;
+    }
+
+    SQLSMALLINT cols = stmt->num_result_cols();
+    if( cols == 0 ) {
+        return false;
+    }
+
+    SQLLEN row_size = 0;
+    for( SQLSMALLINT i = 0; i < cols; ++i ) {
+
+        SQLSMALLINT c_type = SQL_C_DEFAULT;
+        SQLLEN length = 0;
+        if( !bound_column_type( stmt->col_desc( i ), c_type, length )) {
+            return false;
+        }
+        row_size += length + sizeof( SQLLEN );
+    }
+
+    // it's only worth binding if more than one row fits in the buffers
+    return ( row_size * 2 <= BOUND_BUFFER_MAX_SIZE );
+}
+
+hdb_bound_result_set::hdb_bound_result_set( _Inout_ hdb_stmt* stmt ) :
+    hdb_result_set( stmt ),
+    col_count( 0 ),
+    row_array_size( 0 ),
+    rows_fetched( 0 ),
+    row_status( NULL ),
+    row_errors( NULL ),
+    current( 0 ),
+    prefetched( false ),
+    block_pending( false ),
+    last_field_index( -1 ),
+    read_so_far( 0 ),
+    temp_length( 0 )
+{
+    col_count = stmt->num_result_cols();
+    HDB_ASSERT( col_count > 0, "hdb_bound_result_set created for a statement without a result set" );
+
+    meta = static_cast<hdb_bound_result_set::meta_data*>( hdb_malloc( col_count, sizeof( hdb_bound_result_set::meta_data ), 0 ));
+    memset( meta.get(), 0, col_count * sizeof( hdb_bound_result_set::meta_data ));
+
+    try {
+
+        SQLLEN row_size = 0;
+        for( SQLSMALLINT i = 0; i < col_count; ++i ) {
+
+            bool bindable = bound_column_type( stmt->col_desc( i ), meta[i].c_type, meta[i].length );
+            HDB_ASSERT( bindable, "Column should have been verified as bindable by hdb_bound_result_set::is_bindable" );
+            row_size += meta[i].length + sizeof( SQLLEN );
+        }
+
+        // fetch PrefetchRows rows at a time, or as many as fit in the buffers
+        row_array_size = BOUND_BUFFER_MAX_SIZE / row_size;
+        if( row_array_size > stmt->prefetch_rows ) {
+            row_array_size = stmt->prefetch_rows;
+        }
+
+        for( SQLSMALLINT i = 0; i < col_count; ++i ) {
+
+            meta[i].data = static_cast<unsigned char*>( hdb_malloc( row_array_size, meta[i].length, 0 ));
+            meta[i].ind = static_cast<SQLLEN*>( hdb_malloc( row_array_size, sizeof( SQLLEN ), 0 ));
+            core::SQLBindCol( stmt, i + 1, meta[i].c_type, meta[i].data, meta[i].length, meta[i].ind );
+        }
+
+        row_status = static_cast<SQLUSMALLINT*>( hdb_malloc( row_array_size, sizeof( SQLUSMALLINT ), 0 ));
+        row_errors = static_cast<hdb_error**>( hdb_malloc( row_array_size, sizeof( hdb_error* ), 0 ));
+        memset( row_errors, 0, row_array_size * sizeof( hdb_error* ));
+
+        core::SQLSetStmtAttr( stmt, SQL_ATTR_ROW_BIND_TYPE, reinterpret_cast<SQLPOINTER>( SQL_BIND_BY_COLUMN ), SQL_IS_UINTEGER );
+        core::SQLSetStmtAttr( stmt, SQL_ATTR_ROWS_FETCHED_PTR, &rows_fetched, 0 );
+        core::SQLSetStmtAttr( stmt, SQL_ATTR_ROW_STATUS_PTR, row_status, 0 );
+        core::SQLSetStmtAttr( stmt, SQL_ATTR_ROW_ARRAY_SIZE, reinterpret_cast<SQLPOINTER>( row_array_size ), SQL_IS_UINTEGER );
+    }
+    catch( core::CoreException& ) {
+
+        unbind();
+        throw;
+    }
+}
+
+hdb_bound_result_set::~hdb_bound_result_set( void )
+{
+    unbind();
+}
+
+// release the column bindings and return the statement to single row fetches before the buffers are freed.
+// Errors are ignored since this is called from the destructor.
+void hdb_bound_result_set::unbind( void )
+{
+    ::SQLFreeStmt( odbc->handle(), SQL_UNBIND );
+    ::SQLSetStmtAttr( odbc->handle(), SQL_ATTR_ROW_ARRAY_SIZE, reinterpret_cast<SQLPOINTER>( 1 ), SQL_IS_UINTEGER );
+    ::SQLSetStmtAttr( odbc->handle(), SQL_ATTR_ROWS_FETCHED_PTR, NULL, 0 );
+    ::SQLSetStmtAttr( odbc->handle(), SQL_ATTR_ROW_STATUS_PTR, NULL, 0 );
+
+    for( SQLSMALLINT i = 0; i < col_count; ++i ) {
+
+        if( meta[i].data ) {
+            hdb_free( meta[i].data );
+            meta[i].data = NULL;
+        }
+        if( meta[i].ind ) {
+            hdb_free( meta[i].ind );
+            meta[i].ind = NULL;
+        }
+    }
+
+    if( row_errors ) {
+        clear_row_errors();
+        hdb_free( row_errors );
+        row_errors = NULL;
+    }
+    if( row_status ) {
+        hdb_free( row_status );
+        row_status = NULL;
+    }
+}
+
+// free the diagnostics kept for the rows of the last block
+void hdb_bound_result_set::clear_row_errors( void )
+{
+    for( SQLULEN i = 0; i < row_array_size; ++i ) {
+
+        if( row_errors[i] ) {
+            row_errors[i]->~hdb_error();
+            hdb_free( row_errors[i] );
+            row_errors[i] = NULL;
+        }
+    }
+}
+
+// fetch the next block of rows.  An error for the whole fetch is reported and thrown here, while the warnings
+// and errors of individual rows are kept with their row and reported when the fetch reaches that row.
+SQLRETURN hdb_bound_result_set::fetch_block( void )
+{
+    last_error = NULL;
+    current = 0;
+    rows_fetched = 0;
+    clear_row_errors();
+
+    SQLRETURN r = ::SQLFetchScroll( odbc->handle(), SQL_FETCH_NEXT, 0 );
+    if( r == SQL_NO_DATA ) {
+        return SQL_NO_DATA;
+    }
+
+    CHECK_SQL_ERROR( r, odbc ) {
+        throw core::CoreException();
+    }
+
+    // keep the first diagnostic of each row.  Those not tied to a row are reported with the first row of the block.
+    if( r == SQL_SUCCESS_WITH_INFO ) {
+
+        for( SQLSMALLINT record = 1; ; ++record ) {
+
+            hdb_error* error = odbc_get_diag_rec( odbc, record );
+            if( error == NULL ) {
+                break;
+            }
+
+            SQLLEN row_number = SQL_NO_ROW_NUMBER;
+            ::SQLGetDiagField( SQL_HANDLE_STMT, odbc->handle(), record, SQL_DIAG_ROW_NUMBER, &row_number, SQL_IS_INTEGER, NULL );
+
+            SQLULEN row = 0;
+            if( row_number > 0 && static_cast<SQLULEN>( row_number ) <= rows_fetched ) {
+                row = row_number - 1;
+            }
+
+            if( row_errors[ row ] == NULL ) {
+                row_errors[ row ] = error;
+            }
+            else {
+                error->~hdb_error();
+                hdb_free( error );
+            }
+        }
+    }
+
+    return ( rows_fetched > 0 ) ? SQL_SUCCESS : SQL_NO_DATA;
+}
+
+// return the status of the current row of the block, reporting its warning or error as the fetch of a single row would
+SQLRETURN hdb_bound_result_set::row_result( void )
+{
+    SQLRETURN r = SQL_SUCCESS;
+
+    switch( row_status[ current ] ) {
+        case SQL_ROW_SUCCESS_WITH_INFO:
+            r = SQL_SUCCESS_WITH_INFO;
+            break;
+        case SQL_ROW_ERROR:
+            r = SQL_ERROR;
+            break;
+    }
+
+    if( row_errors[ current ] ) {
+        last_error = row_errors[ current ];
+        row_errors[ current ] = NULL;
+        if( r == SQL_SUCCESS ) {
+            r = SQL_SUCCESS_WITH_INFO;
+        }
+    }
+    else if( r == SQL_SUCCESS_WITH_INFO ) {
+        last_error = new (hdb_malloc( sizeof( hdb_error ))) hdb_error( (SQLCHAR*) "01000", (SQLCHAR*) "General warning", 0 );
+    }
+    else if( r == SQL_ERROR ) {
+        last_error = new (hdb_malloc( sizeof( hdb_error ))) hdb_error( (SQLCHAR*) "HY000", (SQLCHAR*) "General error", 0 );
+    }
+
+    if( r != SQL_SUCCESS ) {
+        CHECK_SQL_ERROR_OR_WARNING( r, odbc ) {
+            throw core::CoreException();
+        }
+    }
+
+    return r;
+}
+
+SQLRETURN hdb_bound_result_set::fetch( _In_ SQLSMALLINT orientation, _In_ SQLLEN offset )
+{
+    last_error = NULL;
+    last_field_index = -1;
+    read_so_far = 0;
+
+    // the cursor is forward only, so let ODBC report the error for any other orientation
+    if( orientation != SQL_FETCH_NEXT ) {
+        return core::SQLFetchScroll( odbc, orientation, offset );
+    }
+
+    // the first block was fetched by has_rows
+    if( block_pending ) {
+        block_pending = false;
+        current = 0;
+        return ( rows_fetched > 0 ) ? row_result() : SQL_NO_DATA;
+    }
+
+    // move within the current block until it's exhausted, then fetch the next one
+    if( ++current < rows_fetched ) {
+        return row_result();
+    }
+
+    if( fetch_block() == SQL_NO_DATA ) {
+        return SQL_NO_DATA;
+    }
+
+    return row_result();
+}
+
+SQLRETURN hdb_bound_result_set::get_data( _In_ SQLUSMALLINT field_index, _In_ SQLSMALLINT target_type,
+                                             _Out_writes_bytes_opt_(buffer_length) SQLPOINTER buffer, _In_ SQLLEN buffer_length, _Inout_ SQLLEN* out_buffer_length,
+                                             bool handle_warning )
+{
+    last_error = NULL;
+    field_index--;      // convert from 1 based to 0 based
+    HDB_ASSERT( field_index < col_count, "Invalid field index requested" );
+    HDB_ASSERT( current < rows_fetched, "No current row in the bound result set" );
+
+    if( field_index != last_field_index ) {
+        last_field_index = field_index;
+        read_so_far = 0;
+    }
+
+    meta_data& col = meta[ field_index ];
+    SQLLEN field_len = col.ind[ current ];
+
+    // if the field is null, then return SQL_NULL_DATA
+    if( field_len == SQL_NULL_DATA ) {
+        *out_buffer_length = SQL_NULL_DATA;
+        return SQL_SUCCESS;
+    }
+
+    unsigned char* field_data = col.data + current * col.length;
+
+    switch( col.c_type ) {
+
+        case SQL_C_LONG:
+        {
+            LONG* long_data = reinterpret_cast<LONG*>( field_data );
+
+            switch( target_type ) {
+                case SQL_C_LONG:
+                    memcpy_s( buffer, buffer_length, long_data, sizeof( LONG ));
+                    *out_buffer_length = sizeof( LONG );
+                    return SQL_SUCCESS;
+                case SQL_C_DOUBLE:
+                    *reinterpret_cast<double*>( buffer ) = static_cast<double>( *long_data );
+                    *out_buffer_length = sizeof( double );
+                    return SQL_SUCCESS;
+                case SQL_C_CHAR:
+                    return number_to_string<char, LONG>( long_data, buffer, buffer_length, out_buffer_length, last_error );
+                case SQL_C_WCHAR:
+#ifdef _WIN32
+                    return number_to_string<WCHAR, LONG>( long_data, buffer, buffer_length, out_buffer_length, last_error );
+#else
+                    return number_to_string<char16_t, LONG>( long_data, buffer, buffer_length, out_buffer_length, last_error );
+#endif // _WIN32
+            }
+            break;
+        }
+
+        case SQL_C_DOUBLE:
+        {
+            double* double_data = reinterpret_cast<double*>( field_data );
+
+            switch( target_type ) {
+                case SQL_C_DOUBLE:
+                    memcpy_s( buffer, buffer_length, double_data, sizeof( double ));
+                    *out_buffer_length = sizeof( double );
+                    return SQL_SUCCESS;
+                case SQL_C_LONG:
+                    if( *double_data < double( LONG_MIN ) || *double_data > double( LONG_MAX )) {
+                        last_error = new (hdb_malloc( sizeof( hdb_error ))) hdb_error( (SQLCHAR*) "22003",
+                                                                                        (SQLCHAR*) "Numeric value out of range", 0 );
+                        return SQL_ERROR;
+                    }
+                    if( *double_data != floor( *double_data )) {
+                        last_error = new (hdb_malloc( sizeof( hdb_error ))) hdb_error( (SQLCHAR*) "01S07",
+                                                                                        (SQLCHAR*) "Fractional truncation", 0 );
+                        return SQL_SUCCESS_WITH_INFO;
+                    }
+                    *reinterpret_cast<LONG*>( buffer ) = static_cast<LONG>( *double_data );
+                    *out_buffer_length = sizeof( LONG );
+                    return SQL_SUCCESS;
+                case SQL_C_CHAR:
+                    return number_to_string<char, double>( double_data, buffer, buffer_length, out_buffer_length, last_error );
+                case SQL_C_WCHAR:
+#ifdef _WIN32
+                    return number_to_string<WCHAR, double>( double_data, buffer, buffer_length, out_buffer_length, last_error );
+#else
+                    return number_to_string<char16_t, double>( double_data, buffer, buffer_length, out_buffer_length, last_error );
+#endif // _WIN32
+            }
+            break;
+        }
+
+        case SQL_C_CHAR:
+        case SQL_C_WCHAR:
+        {
+            bool truncated = false;
+            field_len = bound_length( field_index, truncated );
+
+            SQLRETURN r = SQL_SUCCESS;
+            if( target_type == col.c_type ) {
+                r = copy_string( field_data, field_len, ( col.c_type == SQL_C_WCHAR ) ? sizeof( SQLWCHAR ) : sizeof( SQLCHAR ),
+                                 buffer, buffer_length, out_buffer_length );
+            }
+            else if( target_type == SQL_C_BINARY ) {
+                r = copy_string( field_data, field_len, 0, buffer, buffer_length, out_buffer_length );
+            }
+            else {
+                r = convert_string( field_index, target_type, buffer, buffer_length, out_buffer_length );
+            }
+
+            // the value didn't fit in the column buffer, so only its start was fetched
+            if( truncated && r == SQL_SUCCESS ) {
+                last_error = new (hdb_malloc( sizeof( hdb_error ))) hdb_error( (SQLCHAR*) "01004",
+                                                                                (SQLCHAR*) "String data, right truncated", 0 );
+                r = SQL_SUCCESS_WITH_INFO;
+            }
+            return r;
+        }
+
+        default:
+            HDB_ASSERT( false, "Invalid C type bound in hdb_bound_result_set" );
+            break;
+    }
+
+    last_error = new (hdb_malloc( sizeof( hdb_error ))) 
+        hdb_error( (SQLCHAR*) "07006", (SQLCHAR*) "Restricted data type attribute violation", 0 );
+    return SQL_ERROR;
+}
+
+SQLRETURN hdb_bound_result_set::get_diag_field( _In_ SQLSMALLINT record_number, _In_ SQLSMALLINT diag_identifier, 
+                                                   _Inout_updates_(buffer_length) SQLPOINTER diag_info_buffer, _In_ SQLSMALLINT buffer_length,
+                                                   _Inout_ SQLSMALLINT* out_buffer_length )
+{
+    // errors from the conversions are kept here, otherwise they came from ODBC
+    if( last_error == 0 ) {
+        return core::SQLGetDiagField( odbc, record_number, diag_identifier, diag_info_buffer, buffer_length,
+                                      out_buffer_length );
+    }
+
+    HDB_ASSERT( record_number == 1, "Only record number 1 can be fetched by hdb_bound_result_set::get_diag_field" );
+    HDB_ASSERT( diag_identifier == SQL_DIAG_SQLSTATE, 
+                   "Only SQL_DIAG_SQLSTATE can be fetched by hdb_bound_result_set::get_diag_field" );
+    HDB_ASSERT( buffer_length >= SQL_SQLSTATE_BUFSIZE, 
+                   "Buffer not big enough to return SQLSTATE in hdb_bound_result_set::get_diag_field" );
+
+    SQLSMALLINT bufsize = ( buffer_length < SQL_SQLSTATE_BUFSIZE ) ? buffer_length : SQL_SQLSTATE_BUFSIZE;
+
+    memcpy_s( diag_info_buffer, buffer_length, last_error->sqlstate, bufsize );
+
+    return SQL_SUCCESS;
+}
+
+hdb_error* hdb_bound_result_set::get_diag_rec( _In_ SQLSMALLINT record_number )
 {
-    row_dtor_closure* cl = reinterpret_cast<row_dtor_closure*>( Z_PTR_P( data ) );
-    BYTE* row = cl->row_data;
-    // don't release this here, since this is called from the destructor of the result_set
-    hdb_buffered_result_set* result_set = cl->results;
+    // we only hold a single error if there is one, otherwise return the ODBC error(s)
+    if( last_error == 0 ) {
+        return odbc_get_diag_rec( odbc, record_number );
+    }
+    if( record_number > 1 ) {
+        return NULL;
+    }
 
-    for( SQLSMALLINT i = 0; i < result_set->column_count(); ++i ) {
+    return new (hdb_malloc( sizeof( hdb_error ))) 
+        hdb_error( last_error->sqlstate, last_error->native_message, last_error->native_code );
+}
 
-        if( result_set->col_meta_data(i).length == hdb_buffered_result_set::meta_data::SIZE_UNKNOWN ) {
+SQLLEN hdb_bound_result_set::row_count( )
+{
+    return core::SQLRowCount( odbc );
+}
+
+// fetches the first block of rows, which the first fetch then starts from
+bool hdb_bound_result_set::has_rows( void )
+{
+    if( !prefetched ) {
+        fetch_block();
+        prefetched = true;
+        block_pending = true;
+    }
+
+    return rows_fetched > 0;
+}
+
+// the length of a string field in the current row.  When the value was longer than the column buffer the driver
+// truncated it and returned the length of the whole value (or SQL_NO_TOTAL), so only the part in the buffer is used.
+SQLLEN hdb_bound_result_set::bound_length( _In_ SQLSMALLINT field_index, _Out_ bool& truncated )
+{
+    meta_data& col = meta[ field_index ];
+    SQLLEN field_len = col.ind[ current ];
+    SQLLEN max_len = col.length - (( col.c_type == SQL_C_WCHAR ) ? sizeof( SQLWCHAR ) : sizeof( SQLCHAR ));
+
+    truncated = ( field_len == SQL_NO_TOTAL || field_len > max_len );
+    return truncated ? max_len : field_len;
+}
 
-            void* out_of_row_data = *reinterpret_cast<void**>( &row[ result_set->col_meta_data(i).offset ] );
-            hdb_free( out_of_row_data );
+// copy string data into the caller's buffer the way SQLGetData does: the length remaining is returned in
+// out_buffer_length and if the data doesn't fit it is truncated (01004), to be continued on the next call.
+// extra is the size of the null terminator, 0 for binary data.
+SQLRETURN hdb_bound_result_set::copy_string( _In_reads_bytes_(data_length) const SQLCHAR* data, _In_ SQLLEN data_length, _In_ SQLSMALLINT extra,
+                                                _Out_writes_bytes_to_opt_(buffer_length, *out_buffer_length) void* buffer, _In_ SQLLEN buffer_length,
+                                                _Out_ SQLLEN* out_buffer_length )
+{
+    SQLRETURN r = SQL_SUCCESS;
+
+    *out_buffer_length = data_length - read_so_far;
+
+    SQLLEN to_copy = *out_buffer_length;
+    if( buffer_length < *out_buffer_length + extra ) {
+
+        // only copy whole characters
+        to_copy = buffer_length - extra;
+        if( extra > 1 ) {
+            to_copy -= to_copy % extra;
         }
+        last_error = new ( hdb_malloc( sizeof( hdb_error ))) 
+            hdb_error( (SQLCHAR*) "01004", (SQLCHAR*) "String data, right truncated", -1 );
+        r = SQL_SUCCESS_WITH_INFO;
+    }
+
+    HDB_ASSERT( to_copy >= 0, "Negative field length calculated in bound result set" );
+
+    if( to_copy > 0 ) {
+        memcpy_s( buffer, buffer_length, data + read_so_far, to_copy );
+        read_so_far += to_copy;
+    }
+    if( extra ) {
+        memset( reinterpret_cast<SQLCHAR*>( buffer ) + to_copy, 0, extra );
     }
 
-    hdb_free( row );
-	hdb_free( cl );
+    return r;
 }
 
+// convert a bound string field to a number or to the other string type.  String conversions are done for
+// the whole field on the first read into temp_string, and partial reads continue from there.
+SQLRETURN hdb_bound_result_set::convert_string( _In_ SQLSMALLINT field_index, _In_ SQLSMALLINT target_type,
+                                                   _Out_writes_bytes_to_opt_(buffer_length, *out_buffer_length) void* buffer,
+                                                   _In_ SQLLEN buffer_length, _Out_ SQLLEN* out_buffer_length )
+{
+    meta_data& col = meta[ field_index ];
+    unsigned char* field_data = col.data + current * col.length;
+    bool truncated = false;
+    SQLLEN field_len = bound_length( field_index, truncated );
+
+    switch( target_type ) {
+
+        case SQL_C_LONG:
+            if( col.c_type == SQL_C_CHAR ) {
+                return string_to_number<LONG>( reinterpret_cast<char*>( field_data ), field_len, buffer, buffer_length,
+                                               out_buffer_length, last_error );
+            }
+            return string_to_number<LONG>( reinterpret_cast<SQLWCHAR*>( field_data ), field_len, buffer, buffer_length,
+                                           out_buffer_length, last_error );
+
+        case SQL_C_DOUBLE:
+            if( col.c_type == SQL_C_CHAR ) {
+                return string_to_number<double>( reinterpret_cast<char*>( field_data ), field_len, buffer, buffer_length,
+                                                 out_buffer_length, last_error );
+            }
+            return string_to_number<double>( reinterpret_cast<SQLWCHAR*>( field_data ), field_len, buffer, buffer_length,
+                                             out_buffer_length, last_error );
+
+        case SQL_C_WCHAR:
+        {
+            HDB_ASSERT( col.c_type == SQL_C_CHAR, "Invalid conversion to wide string" );
+
+            if( read_so_far == 0 ) {
+
+                temp_string = reinterpret_cast<SQLCHAR*>( hdb_malloc( field_len + 1, sizeof( SQLWCHAR ), 0 ));
+                temp_length = 0;
+
+                if( field_len > 0 ) {
+#ifndef _WIN32
+                    int ch_space = SystemLocale::ToUtf16( CP_ACP, reinterpret_cast<LPCSTR>( field_data ), static_cast<int>( field_len ),
+                                                          reinterpret_cast<LPWSTR>( temp_string.get() ), static_cast<int>( field_len ));
+#else
+                    int ch_space = MultiByteToWideChar( CP_ACP, MB_ERR_INVALID_CHARS, reinterpret_cast<LPCSTR>( field_data ), static_cast<int>( field_len ),
+                                                        reinterpret_cast<LPWSTR>( temp_string.get() ), static_cast<int>( field_len ));
+#endif // !_WIN32
+                    if( ch_space == 0 ) {
+                        last_error = new ( hdb_malloc( sizeof( hdb_error )))
+                            hdb_error( (SQLCHAR*) "IMSSP", (SQLCHAR*) "Invalid Unicode translation", -1 );
+                        return SQL_ERROR;
+                    }
+                    temp_length = ch_space * sizeof( SQLWCHAR );
+                }
+            }
+
+            return copy_string( temp_string.get(), temp_length, sizeof( SQLWCHAR ), buffer, buffer_length, out_buffer_length );
+        }
+
+        case SQL_C_CHAR:
+        {
+            HDB_ASSERT( col.c_type == SQL_C_WCHAR, "Invalid conversion to system string" );
+
+            if( read_so_far == 0 ) {
+
+                // allocate enough for each UTF-16 character to become a multibyte character
+                SQLLEN wide_len = field_len / sizeof( SQLWCHAR );
+                temp_string = reinterpret_cast<SQLCHAR*>( hdb_malloc( wide_len, 4, sizeof( char )));
+                temp_length = 0;
+
+                if( wide_len > 0 ) {
+#ifndef _WIN32
+                    temp_length = SystemLocale::FromUtf16( CP_ACP, reinterpret_cast<LPCWSTR>( field_data ), static_cast<int>( wide_len ),
+                                                           reinterpret_cast<LPSTR>( temp_string.get() ), static_cast<int>( wide_len * 4 ));
+#else
+                    BOOL default_char_used = FALSE;
+                    char default_char = '?';
+
+                    temp_length = WideCharToMultiByte( CP_ACP, 0, reinterpret_cast<LPCWSTR>( field_data ), static_cast<int>( wide_len ),
+                                                       reinterpret_cast<LPSTR>( temp_string.get() ), static_cast<int>( wide_len * 4 ),
+                                                       &default_char, &default_char_used );
+#endif // !_WIN32
+                    if( temp_length == 0 ) {
+                        last_error = new ( hdb_malloc( sizeof( hdb_error )))
+                            hdb_error( (SQLCHAR*) "IMSSP", (SQLCHAR*) "Invalid Unicode translation", -1 );
+                        return SQL_ERROR;
+                    }
+                }
+            }
+
+            return copy_string( temp_string.get(), temp_length, sizeof( SQLCHAR ), buffer, buffer_length, out_buffer_length );
+        }
+    }
+
+    last_error = new (hdb_malloc( sizeof( hdb_error ))) 
+        hdb_error( (SQLCHAR*) "07006", (SQLCHAR*) "Restricted data type attribute violation", 0 );
+    return SQL_ERROR;
+}
+
+namespace {
+
 SQLPOINTER read_lob_field( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index, _In_ hdb_buffered_result_set::meta_data& meta, 
                            _In_ zend_long mem_used )
 {
@@ -1595,4 +2436,73 @@ SQLPOINTER read_lob_field( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index
     return return_buffer;
 }
 
+bool bound_column_type( _In_ hdb_column_desc const& desc, _Out_ SQLSMALLINT& c_type, _Out_ SQLLEN& length )
+{
+    c_type = SQL_C_DEFAULT;
+    length = 0;
+
+    switch( desc.sql_type ) {
+
+        case SQL_BIT:
+        case SQL_TINYINT:
+        case SQL_SMALLINT:
+        case SQL_INTEGER:
+            c_type = SQL_C_LONG;
+            length = sizeof( LONG );
+            return true;
+
+        case SQL_REAL:
+        case SQL_FLOAT:
+        case SQL_DOUBLE:
+            c_type = SQL_C_DOUBLE;
+            length = sizeof( double );
+            return true;
+
+        // these are returned as strings, which only contain ASCII characters
+        case SQL_BIGINT:
+        case SQL_DECIMAL:
+        case SQL_NUMERIC:
+        case SQL_TYPE_DATE:
+        case SQL_TYPE_TIME:
+        case SQL_TYPE_TIMESTAMP:
+            if( desc.display_size <= 0 || desc.display_size > SQL_SERVER_MAX_FIELD_SIZE ) {
+                return false;
+            }
+            c_type = SQL_C_CHAR;
+            length = desc.display_size + sizeof( SQLCHAR );
+            return true;
+
+        // character types are only bound when their size is known, otherwise they are treated as LOBs.  They
+        // are bound as the C type they are retrieved as by default, so the fetches don't need to convert them.
+        case SQL_CHAR:
+        case SQL_VARCHAR:
+        case SQL_WCHAR:
+        case SQL_WVARCHAR:
+        {
+            SQLLEN chars = static_cast<SQLLEN>( desc.length );
+            if( chars <= 0 || chars > SQL_SERVER_MAX_FIELD_SIZE ) {
+                return false;
+            }
+
+            switch( desc.c_type ) {
+                case SQL_C_WCHAR:
+                    // leave room for every character to be a surrogate pair
+                    c_type = SQL_C_WCHAR;
+                    length = ( chars * 2 + 1 ) * sizeof( SQLWCHAR );
+                    return true;
+                case SQL_C_CHAR:
+                    // leave room for every character to be a multibyte character
+                    c_type = SQL_C_CHAR;
+                    length = chars * 4 + sizeof( SQLCHAR );
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        default:
+            return false;
+    }
+}
+
 }
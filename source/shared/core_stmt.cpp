@@ -7,7 +7,9 @@
 
 #include "core_hdb.h"
 
+#include <chrono>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 namespace {
@@ -39,19 +41,35 @@ struct field_cache {
     // rely on the hash table destructor to free the memory
 };
 
-// Used to cache display size and SQL type of a column in get_field_as_string()
-struct col_cache {
-    SQLLEN sql_type;
-    SQLLEN display_size;
-
-    col_cache( _In_ SQLLEN col_sql_type, _In_ SQLLEN col_display_size )
-    {
-        sql_type = col_sql_type;
-        display_size = col_display_size;
-    }
-};
-
 const int INITIAL_FIELD_STRING_LEN = 2048;          // base allocation size when retrieving a string field
+const SQLLEN UTF16_FIELD_CHUNK_LEN = 32 * 1024;     // UTF-16 code units read at a time when a large field is converted to UTF-8
+const SQLLEN FIELD_LEN_HINT_MAX = 64 * 1024;        // largest first read of a large field sized from the column's earlier values
+
+// longest string an integer or float becomes when it is sent in a parameter of strings by core_hdb_execute_batch
+const SQLLEN BATCH_NUMBER_STRING_LEN = 32;
+
+// a parameter bound by core_hdb_execute_batch as an array of values, one per row
+struct batch_param {
+
+    // the kinds of values in a parameter, from the least to the most general.  A parameter is sent as the most
+    // general kind of value found in any of its rows.
+    enum kind_t {
+        KIND_NULL,
+        KIND_LONG,
+        KIND_DOUBLE,
+        KIND_STRING
+    };
+
+    kind_t kind;
+    bool big;                   // an integer value doesn't fit in SQL_INTEGER
+    SQLLEN max_len;             // longest value in bytes (before any conversion to UTF-16)
+    SQLSMALLINT c_type;
+    SQLSMALLINT sql_type;
+    SQLULEN column_size;
+    SQLLEN width;               // size in bytes of each value in values
+    unsigned char* values;      // width bytes for each row
+    SQLLEN* lengths;            // length or SQL_NULL_DATA for each row
+};
 
 // UTF-8 tags for byte length of characters, used by streams to make sure we don't clip a character in between reads
 const unsigned int UTF8_MIDBYTE_MASK = 0xc0;
@@ -79,9 +97,10 @@ const size_t DATE_FORMAT_LEN = sizeof( DATE_FORMAT );
 
 // *** internal functions ***
 // Only declarations are put here.  Functions contain the documentation they need at their definition sites.
-void calc_string_size( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index, _In_ SQLLEN sql_type, _Inout_ SQLLEN& size );
 size_t calc_utf8_missing( _Inout_ hdb_stmt* stmt, _In_reads_(buffer_end) const char* buffer, _In_ size_t buffer_end );
 bool check_for_next_stream_parameter( _Inout_ hdb_stmt* stmt );
+// returns the ODBC C type used to retrieve a column as the PHP type given
+SQLSMALLINT column_c_type( _In_ hdb_phptype php_type, _In_ HDB_ENCODING encoding, _In_ bool char_as_utf8 );
 bool convert_input_param_to_utf16( _In_ zval* input_param_z, _Inout_ zval* convert_param_z );
 void core_get_field_common(_Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index, _Inout_ hdb_phptype
 						   hdb_php_type, _Inout_updates_bytes_(*field_len) void*& field_value, _Inout_ SQLLEN* field_len );
@@ -92,13 +111,14 @@ void default_sql_size_and_scale( _Inout_ hdb_stmt* stmt, _In_opt_ unsigned int p
 // given a zval and encoding, determine the appropriate sql type, column size, and decimal scale (if appropriate)
 void default_sql_type( _Inout_ hdb_stmt* stmt, _In_opt_ SQLULEN paramno, _In_ zval* param_z, _In_ HDB_ENCODING encoding,
                        _Out_ SQLSMALLINT& sql_type );
-void col_cache_dtor( _Inout_ zval* data_z );
 void field_cache_dtor( _Inout_ zval* data_z );
 void finalize_output_parameters( _Inout_ hdb_stmt* stmt );
 void get_field_as_string( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index, _Inout_ hdb_phptype hdb_php_type,
 						  _Inout_updates_bytes_(*field_len) void*& field_value, _Inout_ SQLLEN* field_len );
+zend_string* get_large_field_as_utf8( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index );
 stmt_option const* get_stmt_option( hdb_conn const* conn, _In_ zend_ulong key, _In_ const stmt_option stmt_opts[] );
 bool is_valid_hdb_phptype( _In_ hdb_phptype type );
+void set_stmt_options( _Inout_ hdb_stmt* stmt, _In_opt_ HashTable* options_ht, _In_opt_ const stmt_option valid_stmt_opts[] );
 // assure there is enough space for the output parameter string
 void resize_output_buffer_if_necessary( _Inout_ hdb_stmt* stmt, _Inout_ zval* param_z, _In_ SQLULEN paramno, HDB_ENCODING encoding,
                                         _In_ SQLSMALLINT c_type, _In_ SQLSMALLINT sql_type, _In_ SQLULEN column_size, _In_ SQLSMALLINT decimal_digits,
@@ -112,6 +132,18 @@ void hdb_output_param_dtor( _Inout_ zval* data );
 // called when a bound stream parameter is to be destroyed.
 void hdb_stream_dtor( _Inout_ zval* data );
 bool is_streamable_type( _In_ SQLINTEGER sql_type );
+void reset_batch_params( _Inout_ hdb_stmt* stmt );
+SQLRETURN complete_execute( _Inout_ hdb_stmt* stmt, _In_ SQLRETURN r );
+void abandon_execute( _Inout_ hdb_stmt* stmt );
+void end_async_execute( _Inout_ hdb_stmt* stmt );
+hdb_stmt_cache_entry* find_stmt_cache_entry( _In_ hdb_stmt_cache* cache, _In_ zend_string* key );
+void free_stmt_cache_entry( _Inout_ hdb_stmt_cache_entry* entry );
+void return_stmt_to_cache( _Inout_ hdb_stmt* stmt );
+hdb_stmt_pool* stmt_pool( _Inout_ hdb_conn* conn );
+void return_stmt_to_pool( _Inout_ hdb_stmt* stmt );
+bool take_pooled_tables( _Inout_ hdb_stmt* stmt );
+bool return_tables_to_pool( _Inout_ hdb_stmt* stmt );
+zend_string* stmt_cache_key( _In_reads_bytes_(sql_len) const char* sql, _In_ SQLLEN sql_len, _In_opt_ HashTable* options_ht );
 
 }
 
@@ -132,30 +164,38 @@ hdb_stmt::hdb_stmt( _In_ hdb_conn* c, _In_ SQLHANDLE handle, _In_ error_callback
     param_ind_ptrs( 10 ),    // initially hold 10 elements, which should cover 90% of the cases and only take < 100 byte
     send_streams_at_exec( true ),
     current_stream( NULL, HDB_ENCODING_DEFAULT ),
-    current_stream_read( 0 )
+    current_stream_read( 0 ),
+    stream_chunk_size( HDB_STREAM_PARAM_CHUNK_SIZE_DEFAULT ),
+    prefetch_rows( HDB_PREFETCH_ROWS_DEFAULT ),
+    wsql_buffer_len( 0 ),
+    col_descs_count( -1 ),
+    cache_key( NULL ),
+    async_executing( false ),
+    async_enabled( false )
 {
 	ZVAL_UNDEF( &active_stream );
-    // initialize the input string parameters array (which holds zvals)
-    core::hdb_array_init( *conn, &param_input_strings );
 
-    // initialize the (input only) stream parameters (which holds hdb_stream structures)
-    array_init( &param_streams );
-    core::hdb_zend_hash_init(*conn, Z_ARRVAL( param_streams ), 5 /* # of buckets */, hdb_stream_dtor, 0 /*persistent*/ );
+    // the tables of a statement freed earlier on the connection are reused if there are any
+    if( !take_pooled_tables( this )) {
+
+        // initialize the input string parameters array (which holds zvals)
+        core::hdb_array_init( *conn, &param_input_strings );
 
-    // initialize the (input only) datetime parameters of converted date time objects to strings
-    array_init( &param_datetime_buffers );
+        // initialize the (input only) stream parameters (which holds hdb_stream structures)
+        array_init( &param_streams );
+        core::hdb_zend_hash_init(*conn, Z_ARRVAL( param_streams ), 5 /* # of buckets */, hdb_stream_dtor, 0 /*persistent*/ );
 
-    // initialize the output string parameters (which holds hdb_output_param structures)
-    array_init( &output_params );
-    core::hdb_zend_hash_init(*conn, Z_ARRVAL( output_params ), 5 /* # of buckets */, hdb_output_param_dtor, 0 /*persistent*/ );
+        // initialize the (input only) datetime parameters of converted date time objects to strings
+        array_init( &param_datetime_buffers );
 
-    // initialize the col cache
-    array_init( &col_cache );
-    core::hdb_zend_hash_init( *conn, Z_ARRVAL(col_cache), 5 /* # of buckets */, col_cache_dtor, 0 /*persistent*/ );
+        // initialize the output string parameters (which holds hdb_output_param structures)
+        array_init( &output_params );
+        core::hdb_zend_hash_init(*conn, Z_ARRVAL( output_params ), 5 /* # of buckets */, hdb_output_param_dtor, 0 /*persistent*/ );
 
-    // initialize the field cache
-    array_init( &field_cache );
-    core::hdb_zend_hash_init(*conn, Z_ARRVAL(field_cache), 5 /* # of buckets */, field_cache_dtor, 0 /*persistent*/ );
+        // initialize the field cache
+        array_init( &field_cache );
+        core::hdb_zend_hash_init(*conn, Z_ARRVAL(field_cache), 5 /* # of buckets */, field_cache_dtor, 0 /*persistent*/ );
+    }
 }
 
 // desctructor for hdb statement.
@@ -173,13 +213,37 @@ hdb_stmt::~hdb_stmt( void )
         current_results = NULL;
     }
 
+    // an execution still in progress is cancelled, and the statement isn't reused since its state is unknown.  Nor
+    // is one whose asynchronous execution couldn't be turned back off.
+    bool reusable = !async_enabled;
+    if( async_executing && valid() ) {
+        ::SQLCancel( handle() );
+        async_executing = false;
+        reusable = false;
+    }
+
+    // a prepared statement from the cache goes back to it rather than being freed
+    if( cache_key != NULL ) {
+        if( reusable && conn != NULL && conn->stmt_cache != NULL && valid() ) {
+            return_stmt_to_cache( this );
+        }
+        zend_string_release( cache_key );
+        cache_key = NULL;
+    }
+    // any other statement leaves its handle to the next statement created on the connection
+    else if( reusable && conn != NULL && valid() ) {
+        return_stmt_to_pool( this );
+    }
+
     invalidate();
-    zval_ptr_dtor( &param_input_strings );
-    zval_ptr_dtor( &output_params );
-    zval_ptr_dtor( &param_streams );
-    zval_ptr_dtor( &param_datetime_buffers );
-    zval_ptr_dtor( &col_cache );
-    zval_ptr_dtor( &field_cache );
+
+    if( conn == NULL || !return_tables_to_pool( this )) {
+        zval_ptr_dtor( &param_input_strings );
+        zval_ptr_dtor( &output_params );
+        zval_ptr_dtor( &param_streams );
+        zval_ptr_dtor( &param_datetime_buffers );
+        zval_ptr_dtor( &field_cache );
+    }
 }
 
 
@@ -194,7 +258,6 @@ void hdb_stmt::free_param_data( )
     zend_hash_clean( Z_ARRVAL( output_params ));
     zend_hash_clean( Z_ARRVAL( param_streams ));
     zend_hash_clean( Z_ARRVAL( param_datetime_buffers ));
-    zend_hash_clean( Z_ARRVAL( col_cache ));
     zend_hash_clean( Z_ARRVAL( field_cache ));
 }
 
@@ -217,11 +280,30 @@ void hdb_stmt::new_result_set( )
         current_results = NULL;
     }
 
+    // the statement has no results yet while stream parameters are still waiting to be sent
+    bool streams_pending = !send_streams_at_exec && zend_hash_num_elements( Z_ARRVAL( param_streams )) > 0;
+
+    // describe the columns once for all the fetches of this result set.  If the results aren't available
+    // yet, they are described on first use instead.
+    col_descs.reset();
+    col_descs_count = -1;
+    if( !streams_pending ) {
+        describe_columns();
+    }
+
     // create a new result set
-    if( cursor_type == HDB_CURSOR_BUFFERED ) {
+    if( cursor_type == HDB_CURSOR_BUFFERED || cursor_type == HDB_CURSOR_BUFFERED_COLUMNAR ) {
          hdb_malloc_auto_ptr<hdb_buffered_result_set> result;
         result = reinterpret_cast<hdb_buffered_result_set*> ( hdb_malloc( sizeof( hdb_buffered_result_set ) ) );
-        new ( result.get() ) hdb_buffered_result_set( this );
+        new ( result.get() ) hdb_buffered_result_set( this, cursor_type == HDB_CURSOR_BUFFERED_COLUMNAR );
+        current_results = result.get();
+        result.transferred();
+    }
+    // forward only results are fetched in blocks when all the columns can be bound
+    else if( cursor_type == SQL_CURSOR_FORWARD_ONLY && !streams_pending && hdb_bound_result_set::is_bindable( this )) {
+        hdb_malloc_auto_ptr<hdb_bound_result_set> result;
+        result = reinterpret_cast<hdb_bound_result_set*> ( hdb_malloc( sizeof( hdb_bound_result_set ) ) );
+        new ( result.get() ) hdb_bound_result_set( this );
         current_results = result.get();
         result.transferred();
     }
@@ -230,6 +312,79 @@ void hdb_stmt::new_result_set( )
     }
 }
 
+// describe the columns of the current result set.  The SQL type and sizes come from ODBC, the PHP type
+// and the C type used to retrieve it are resolved here so that the fetch functions only have to look them up.
+
+void hdb_stmt::describe_columns( void )
+{
+    SQLSMALLINT num_cols = core::SQLNumResultCols( this );
+
+    col_descs.reset();
+    if( num_cols > 0 ) {
+
+        col_descs = static_cast<hdb_column_desc*>( hdb_malloc( num_cols, sizeof( hdb_column_desc ), 0 ));
+
+        HDB_ENCODING enc = (( encoding() == HDB_ENCODING_DEFAULT ) ? conn->encoding() : encoding() );
+
+        for( SQLSMALLINT i = 0; i < num_cols; ++i ) {
+
+            hdb_column_desc& desc = col_descs[ i ];
+
+            core::SQLDescribeColW( this, i + 1, NULL, 0, NULL, &desc.sql_type, &desc.length, &desc.decimal_digits,
+                                   &desc.nullable );
+
+            // wide character columns are sized in bytes, all others by their display size
+            SQLUSMALLINT size_field = ( desc.sql_type == SQL_WCHAR || desc.sql_type == SQL_WVARCHAR ) ?
+                SQL_DESC_OCTET_LENGTH : SQL_DESC_DISPLAY_SIZE;
+            core::SQLColAttributeW( this, i + 1, size_field, NULL, 0, NULL, &desc.display_size );
+
+            desc.php_type = sql_type_to_php_type( desc.sql_type, static_cast<SQLUINTEGER>( desc.length ), false );
+            desc.php_type_prefer_string = sql_type_to_php_type( desc.sql_type, static_cast<SQLUINTEGER>( desc.length ), true );
+            desc.c_type = column_c_type( desc.php_type_prefer_string, enc, conn->char_as_utf8 );
+            desc.len_hint = 0;
+        }
+    }
+
+    col_descs_count = num_cols;
+}
+
+// returns a buffer of at least len wide characters for SQL text converted to UTF-16.  The buffer only grows, so a
+// statement executed again with the same text (or shorter) doesn't allocate.
+
+SQLWCHAR* hdb_stmt::wsql_scratch( _In_ size_t len )
+{
+    if( len > wsql_buffer_len ) {
+        wsql_buffer.reset();
+        wsql_buffer = static_cast<SQLWCHAR*>( hdb_malloc( len, sizeof( SQLWCHAR ), 0 ));
+        wsql_buffer_len = len;
+    }
+    return wsql_buffer;
+}
+
+// field values returned by core_hdb_get_field that aren't strings are consumed before the next fetch, so they can
+// come from the fetch arena and are then released all together when it is reset.
+
+void* hdb_stmt::alloc_field_value( _In_ size_t size )
+{
+#ifdef HDB_FETCH_ARENA
+    return fetch_arena.alloc( size );
+#else
+    return hdb_malloc( size );
+#endif
+}
+
+void hdb_stmt::free_field_value( _Inout_opt_ void* ptr )
+{
+#ifdef HDB_FETCH_ARENA
+    // released when the arena is reset
+    (void) ptr;
+#else
+    if( ptr != NULL ) {
+        hdb_free( ptr );
+    }
+#endif
+}
+
 // core_hdb_create_stmt
 // Common code to allocate a statement from either driver.  Returns a valid driver statement object or
 // throws an exception if an error occurs.
@@ -252,7 +407,14 @@ hdb_stmt* core_hdb_create_stmt( _Inout_ hdb_conn* conn, _In_ driver_stmt_factory
 
     try {
 
-        core::SQLAllocHandle( SQL_HANDLE_STMT, *conn, &stmt_h );
+        // a handle left by a statement freed earlier is reused rather than allocating another
+        hdb_stmt_pool* pool = conn->stmt_pool;
+        if( pool != NULL && pool->handle_count > 0 ) {
+            stmt_h = pool->handles[ --pool->handle_count ];
+        }
+        else {
+            core::SQLAllocHandle( SQL_HANDLE_STMT, *conn, &stmt_h );
+        }
 
         stmt = stmt_factory( conn, stmt_h, err, driver );
 
@@ -263,28 +425,7 @@ hdb_stmt* core_hdb_create_stmt( _Inout_ hdb_conn* conn, _In_ driver_stmt_factory
         stmt_h = SQL_NULL_HANDLE;
 
         // process the options array given to core_hdb_prepare.
-        if( options_ht && zend_hash_num_elements( options_ht ) > 0 && valid_stmt_opts ) {
-			zend_ulong index = -1;
-			zend_string *key = NULL;
-			zval* value_z = NULL;
-
-			ZEND_HASH_FOREACH_KEY_VAL( options_ht, index, key, value_z ) {
-
-				int type = key ? HASH_KEY_IS_STRING : HASH_KEY_IS_LONG;
-
-				// The driver layer should ensure a valid key.
-				DEBUG_HDB_ASSERT(( type == HASH_KEY_IS_LONG ), "allocate_stmt: Invalid statment option key provided." );
-
-				const stmt_option* stmt_opt = get_stmt_option( stmt->conn, index, valid_stmt_opts );
-
-				// if the key didn't match, then return the error to the script.
-				// The driver layer should ensure that the key is valid.
-				DEBUG_HDB_ASSERT( stmt_opt != NULL, "allocate_stmt: unexpected null value for statement option." );
-
-				// perform the actions the statement option needs done.
-				(*stmt_opt->func)( stmt, stmt_opt, value_z );
-			} ZEND_HASH_FOREACH_END();
-        }
+        set_stmt_options( stmt, options_ht, valid_stmt_opts );
 
         return_stmt = stmt;
         stmt.transferred();
@@ -312,6 +453,198 @@ hdb_stmt* core_hdb_create_stmt( _Inout_ hdb_conn* conn, _In_ driver_stmt_factory
     return return_stmt;
 }
 
+// core_hdb_create_prepared_stmt
+// Creates a statement and prepares the SQL given.  When the connection has a statement cache, a handle already
+// prepared with the same SQL text and options is taken from it instead, and the statement returns its handle to
+// the cache when it is destroyed.
+// Parameters:
+// conn            - connection the statement is created on
+// stmt_factory    - factory method to create a statement
+// sql             - SQL text to prepare
+// sql_len         - length of sql in bytes
+// options_ht      - statement options
+// valid_stmt_opts - valid statement options
+// err             - default error handler
+// driver          - driver for the statement
+// Returns:
+// The prepared statement.  An exception is thrown if an error occurs.
+
+hdb_stmt* core_hdb_create_prepared_stmt( _Inout_ hdb_conn* conn, _In_ driver_stmt_factory stmt_factory,
+                                         _In_reads_bytes_(sql_len) const char* sql, _In_ SQLLEN sql_len, _In_opt_ HashTable* options_ht,
+                                         _In_opt_ const stmt_option valid_stmt_opts[], _In_ error_callback const err, _In_opt_ void* driver )
+{
+    hdb_malloc_auto_ptr<hdb_stmt> stmt;
+    SQLHANDLE stmt_h = SQL_NULL_HANDLE;
+    zend_string* key = NULL;
+    hdb_stmt* return_stmt = NULL;
+
+    try {
+
+        hdb_stmt_cache* cache = conn->stmt_cache;
+
+        if( cache != NULL ) {
+
+            key = stmt_cache_key( sql, sql_len, options_ht );
+            hdb_stmt_cache_entry* entry = find_stmt_cache_entry( cache, key );
+
+            if( entry != NULL ) {
+
+                ++cache->hits;
+
+                // take the entry out of the cache before creating the statement, so the handle belongs to
+                // the statement (or is freed below) whatever happens
+                hdb_stmt_cache_entry cached = *entry;
+                *entry = cache->entries[ cache->count - 1 ];
+                --cache->count;
+                stmt_h = cached.handle;
+
+                stmt = stmt_factory( conn, stmt_h, err, driver );
+                stmt->conn = conn;
+                stmt_h = SQL_NULL_HANDLE;
+
+                // the new statement starts from the defaults, so the options are applied the same way as for a
+                // fresh prepare.  The handle was prepared with the same options, which are part of the key.
+                set_stmt_options( stmt, options_ht, valid_stmt_opts );
+                stmt->param_descriptions.assign( cached.param_descriptions, cached.param_descriptions + cached.param_count );
+
+                cached.handle = SQL_NULL_HANDLE;
+                free_stmt_cache_entry( &cached );
+            }
+            else {
+                ++cache->misses;
+            }
+        }
+
+        if( !stmt ) {
+
+            stmt = core_hdb_create_stmt( conn, stmt_factory, options_ht, valid_stmt_opts, err, driver );
+            core_hdb_prepare( stmt, sql, sql_len );
+        }
+
+        stmt->cache_key = key;
+        key = NULL;
+
+        return_stmt = stmt;
+        stmt.transferred();
+    }
+    catch( core::CoreException& ) {
+
+        if( key != NULL ) {
+            zend_string_release( key );
+        }
+
+        if( stmt ) {
+
+            conn->set_last_error( stmt->last_error() );
+            stmt->~hdb_stmt();
+        }
+
+        if( stmt_h != SQL_NULL_HANDLE ) {
+            ::SQLFreeHandle( SQL_HANDLE_STMT, stmt_h );
+        }
+
+        throw;
+    }
+
+    return return_stmt;
+}
+
+// core_hdb_enable_stmt_cache
+// Gives a connection a cache of prepared statements used by core_hdb_create_prepared_stmt.
+// Parameters:
+// conn     - connection to cache the statements of
+// capacity - number of prepared statement handles the cache keeps at most
+
+void core_hdb_enable_stmt_cache( _Inout_ hdb_conn* conn, _In_ zend_long capacity )
+{
+    HDB_ASSERT( capacity > 0, "core_hdb_enable_stmt_cache: Invalid capacity." );
+
+    core_hdb_free_stmt_cache( conn );
+
+    hdb_malloc_auto_ptr<hdb_stmt_cache> cache;
+    cache = reinterpret_cast<hdb_stmt_cache*>( hdb_malloc( sizeof( hdb_stmt_cache )));
+    cache->entries = reinterpret_cast<hdb_stmt_cache_entry*>( hdb_malloc( capacity, sizeof( hdb_stmt_cache_entry ), 0 ));
+    cache->capacity = capacity;
+    cache->count = 0;
+    cache->clock = 0;
+    cache->hits = 0;
+    cache->misses = 0;
+
+    conn->stmt_cache = cache;
+    cache.transferred();
+}
+
+// core_hdb_free_stmt_cache
+// Frees the statement handles kept by a connection's statement cache and the cache itself.  Must be called
+// before the connection is disconnected.
+// Parameters:
+// conn - connection to free the cache of
+
+void core_hdb_free_stmt_cache( _Inout_ hdb_conn* conn )
+{
+    hdb_stmt_cache* cache = conn->stmt_cache;
+
+    if( cache == NULL ) {
+        return;
+    }
+
+    for( zend_long i = 0; i < cache->count; ++i ) {
+        free_stmt_cache_entry( &cache->entries[ i ] );
+    }
+
+    hdb_free( cache->entries );
+    hdb_free( cache );
+    conn->stmt_cache = NULL;
+}
+
+// core_hdb_get_stmt_cache_stats
+// Returns an array describing a connection's statement cache.
+// Parameters:
+// conn    - connection the cache belongs to
+// stats_z - array filled with the keys Size, Entries, Hits and Misses
+
+void core_hdb_get_stmt_cache_stats( _Inout_ hdb_conn* conn, _Out_ zval* stats_z )
+{
+    hdb_stmt_cache* cache = conn->stmt_cache;
+
+    core::hdb_array_init( *conn, stats_z );
+    core::hdb_add_assoc_long( *conn, stats_z, "Size", cache ? cache->capacity : 0 );
+    core::hdb_add_assoc_long( *conn, stats_z, "Entries", cache ? cache->count : 0 );
+    core::hdb_add_assoc_long( *conn, stats_z, "Hits", cache ? static_cast<zend_long>( cache->hits ) : 0 );
+    core::hdb_add_assoc_long( *conn, stats_z, "Misses", cache ? static_cast<zend_long>( cache->misses ) : 0 );
+}
+
+// core_hdb_free_stmt_pool
+// Frees the statement handles and hash tables kept by a connection's statement pool and the pool itself.  Must be
+// called before the connection is disconnected.
+// Parameters:
+// conn - connection to free the pool of
+
+void core_hdb_free_stmt_pool( _Inout_ hdb_conn* conn )
+{
+    hdb_stmt_pool* pool = conn->stmt_pool;
+
+    if( pool == NULL ) {
+        return;
+    }
+
+    for( int i = 0; i < pool->handle_count; ++i ) {
+        ::SQLFreeHandle( SQL_HANDLE_STMT, pool->handles[ i ] );
+    }
+
+    for( int i = 0; i < pool->tables_count; ++i ) {
+        hdb_stmt_pool::tables& t = pool->spare_tables[ i ];
+        zend_array_destroy( t.param_input_strings );
+        zend_array_destroy( t.output_params );
+        zend_array_destroy( t.param_streams );
+        zend_array_destroy( t.param_datetime_buffers );
+        zend_array_destroy( t.field_cache );
+    }
+
+    hdb_free( pool );
+    conn->stmt_pool = NULL;
+}
+
 
 // core_hdb_bind_param
 // Binds a parameter using SQLBindParameter.  It allocates memory and handles other details
@@ -706,6 +1039,15 @@ SQLRETURN core_hdb_execute( _Inout_ hdb_stmt* stmt , _In_reads_bytes_(sql_len) c
 {
     SQLRETURN r = SQL_ERROR;
 
+    CHECK_CUSTOM_ERROR( stmt->async_executing, stmt, HDB_ERROR_ASYNC_STILL_EXECUTING ) {
+        throw core::CoreException();
+    }
+
+    // asynchronous execution that couldn't be turned off after the last execution is turned off now
+    if( stmt->async_enabled ) {
+        end_async_execute( stmt );
+    }
+
     try {
 
     // close the stream to release the resource
@@ -713,18 +1055,15 @@ SQLRETURN core_hdb_execute( _Inout_ hdb_stmt* stmt , _In_reads_bytes_(sql_len) c
 
     if( sql ) {
 
-        hdb_malloc_auto_ptr<SQLWCHAR> wsql_string;
-        unsigned int wsql_len = 0;
+        SQLWCHAR* wsql_string = stmt->wsql_scratch( static_cast<size_t>( sql_len ) + 1 );
         if( sql_len == 0 || ( sql[0] == '\0' && sql_len == 1 )) {
-            wsql_string = reinterpret_cast<SQLWCHAR*>( hdb_malloc( sizeof( SQLWCHAR )));
             wsql_string[0] = L'\0';
-            wsql_len = 0;
         }
         else {
             HDB_ENCODING encoding = (( stmt->encoding() == HDB_ENCODING_DEFAULT ) ? stmt->conn->encoding() : stmt->encoding() );
-            wsql_string = utf16_string_from_mbcs_string( encoding, reinterpret_cast<const char*>( sql ),
-                                                         sql_len, &wsql_len );
-            CHECK_CUSTOM_ERROR( wsql_string == 0, stmt, HDB_ERROR_QUERY_STRING_ENCODING_TRANSLATE,
+            unsigned int wsql_len = utf16_string_from_mbcs_string( encoding, reinterpret_cast<const char*>( sql ),
+                                                                   sql_len, wsql_string );
+            CHECK_CUSTOM_ERROR( wsql_len == 0, stmt, HDB_ERROR_QUERY_STRING_ENCODING_TRANSLATE,
                                 get_last_error_message() ) {
                 throw core::CoreException();
             }
@@ -735,41 +1074,453 @@ SQLRETURN core_hdb_execute( _Inout_ hdb_stmt* stmt , _In_reads_bytes_(sql_len) c
         r = core::SQLExecute( stmt );
     }
 
-    // if data is needed (streams were bound) and they should be sent at execute time, then do so now
-    if( r == SQL_NEED_DATA && stmt->send_streams_at_exec ) {
+    return complete_execute( stmt, r );
+    }
+    catch( core::CoreException& e ) {
 
-        send_param_streams( stmt );
+        abandon_execute( stmt );
+        throw e;
     }
+}
 
-    stmt->new_result_set( );
-    stmt->executed = true;
 
-    // if all the data has been sent and no data was returned then finalize the output parameters
-    if( stmt->send_streams_at_exec && ( r == SQL_NO_DATA || !core_hdb_has_any_result( stmt ))) {
+// core_hdb_execute_async
+// Starts executing the statement previously prepared without waiting for the server to finish, using ODBC's
+// asynchronous execution (SQL_ATTR_ASYNC_ENABLE).  Until core_hdb_poll reports that the execution completed,
+// the statement may not be used for anything else.  Stream parameters aren't allowed, since they are sent with
+// SQLParamData and SQLPutData while the execution waits for them, which asynchronous execution doesn't allow.
+// Parameters:
+// stmt - the core hdb_stmt structure that contains the ODBC handle
+// Return:
+// true if the execution already completed, false if it's still in progress
 
-        finalize_output_parameters( stmt );
+bool core_hdb_execute_async( _Inout_ hdb_stmt* stmt )
+{
+    CHECK_CUSTOM_ERROR( stmt->async_executing, stmt, HDB_ERROR_ASYNC_STILL_EXECUTING ) {
+        throw core::CoreException();
     }
-    // stream parameters are sent, clean the Hashtable
-    if ( stmt->send_streams_at_exec ) {
-         zend_hash_clean( Z_ARRVAL( stmt->param_streams ));
+
+    CHECK_CUSTOM_ERROR( zend_hash_num_elements( Z_ARRVAL( stmt->param_streams )) > 0, stmt, HDB_ERROR_ASYNC_STREAM_PARAMS ) {
+        stmt->free_param_data();
+        ::SQLFreeStmt( stmt->handle(), SQL_RESET_PARAMS );
+        throw core::CoreException();
     }
-    return r;
+
+    // close the stream to release the resource
+    close_active_stream( stmt );
+
+    core::SQLSetStmtAttr( stmt, SQL_ATTR_ASYNC_ENABLE, reinterpret_cast<SQLPOINTER>( SQL_ASYNC_ENABLE_ON ), SQL_IS_UINTEGER );
+    stmt->async_enabled = true;
+    stmt->async_executing = true;
+
+    // the results of an earlier execution are gone once this one starts
+    stmt->executed = false;
+    stmt->fetch_called = false;
+
+    // the first call to SQLExecute starts the execution
+    return core_hdb_poll( stmt );
+}
+
+
+// core_hdb_poll
+// Checks whether an execution started by core_hdb_execute_async completed, and if it did, finishes it as
+// core_hdb_execute does (e.g., the stream parameters are sent) and turns asynchronous execution back off.
+// Parameters:
+// stmt - the core hdb_stmt structure that contains the ODBC handle
+// Return:
+// true if the execution completed (or no execution was in progress), false if it's still in progress.  An
+// exception is thrown if the execution failed.
+
+bool core_hdb_poll( _Inout_ hdb_stmt* stmt )
+{
+    if( !stmt->async_executing ) {
+        return true;
+    }
+
+    // an asynchronous function is polled by calling it again with the same arguments
+    SQLRETURN r = ::SQLExecute( stmt->handle() );
+    if( r == SQL_STILL_EXECUTING ) {
+        return false;
+    }
+
+    try {
+
+        // the diagnostics are read before changing the statement attribute clears them
+        CHECK_SQL_ERROR_OR_WARNING( r, stmt ) {
+            throw core::CoreException();
+        }
+
+        // core_hdb_execute_async doesn't allow stream parameters, so the execution never waits for data
+        HDB_ASSERT( r != SQL_NEED_DATA, "core_hdb_poll: An asynchronous execution asked for stream parameters." );
+
+        // the results are read synchronously
+        end_async_execute( stmt );
+        complete_execute( stmt, r );
+    }
+    catch( core::CoreException& ) {
+
+        // a failed execution leaves asynchronous execution on.  If it can't be turned off either, that error is
+        // reported along with the first, and the statement isn't reused when it's freed.
+        if( stmt->async_executing ) {
+            try {
+                end_async_execute( stmt );
+            }
+            catch( core::CoreException& ) {
+                // the error is already in the statement's errors, after the one that ended the execution
+            }
+        }
+        abandon_execute( stmt );
+        throw;
+    }
+
+    return true;
+}
+
+
+// core_hdb_wait
+// Waits for the executions started by core_hdb_execute_async on several statements to complete, so that the server
+// works on all of them at once.  The statements are polled with a growing delay between rounds.
+// Parameters:
+// stmts   - statements to wait for.  Those whose execution completes are removed.
+// timeout - seconds to wait at most, or a negative number to wait until all the executions complete
+// Return:
+// true if all the executions completed, false if the timeout expired first.  An exception is thrown as soon as an
+// execution fails, and the statements after it in stmts are not polled.
+
+bool core_hdb_wait( _Inout_ std::vector<hdb_stmt*>& stmts, _In_ double timeout )
+{
+    const std::chrono::milliseconds MAX_POLL_INTERVAL( 32 );
+
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( timeout < 0 ? 0 : timeout ));
+    std::chrono::milliseconds interval( 1 );
+
+    while( true ) {
+
+        for( size_t i = 0; i < stmts.size(); ) {
+
+            if( core_hdb_poll( stmts[ i ] )) {
+                stmts.erase( stmts.begin() + i );
+            }
+            else {
+                ++i;
+            }
+        }
+
+        if( stmts.empty() ) {
+            return true;
+        }
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if( timeout >= 0 && now >= deadline ) {
+            return false;
+        }
+
+        std::chrono::steady_clock::duration delay = interval;
+        if( timeout >= 0 && deadline - now < delay ) {
+            delay = deadline - now;
+        }
+        std::this_thread::sleep_for( delay );
+
+        interval = std::min( interval * 2, MAX_POLL_INTERVAL );
+    }
+}
+
+
+// core_hdb_execute_batch
+// Executes the statement previously prepared once for each row of parameters, in a single call to the server.
+// Each parameter is bound as an array holding its value for every row (column-wise binding with
+// SQL_ATTR_PARAMSET_SIZE), so only input parameters of null, boolean, integer, float and string values are allowed.
+// The parameters bound for hdb_execute are released, and bound again by the next hdb_execute.
+// Parameters:
+// stmt       - the core hdb_stmt structure that contains the ODBC handle
+// rows_ht    - the rows of parameter values, each an array of the values of the parameters in order
+// statuses_z - array the SQL_PARAM_* status of each row is added to, in the order of the rows
+// Return:
+// The result of SQLExecute.  If the server executed some of the rows but not others, the errors are reported
+// as warnings and the statuses tell which rows failed.
+
+SQLRETURN core_hdb_execute_batch( _Inout_ hdb_stmt* stmt, _In_ HashTable* rows_ht, _Inout_ zval* statuses_z )
+{
+    SQLRETURN r = SQL_ERROR;
+
+    // the parameters of an execution still in progress can't be freed
+    CHECK_CUSTOM_ERROR( stmt->async_executing, stmt, HDB_ERROR_ASYNC_STILL_EXECUTING ) {
+        throw core::CoreException();
+    }
+
+    // asynchronous execution that couldn't be turned off after the last execution is turned off now
+    if( stmt->async_enabled ) {
+        end_async_execute( stmt );
+    }
+
+    // close the stream to release the resource
+    close_active_stream( stmt );
+
+    stmt->free_param_data();
+    stmt->executed = false;
+    ::SQLFreeStmt( stmt->handle(), SQL_RESET_PARAMS );
+
+    SQLULEN row_count = zend_hash_num_elements( rows_ht );
+    HDB_ASSERT( row_count > 0, "core_hdb_execute_batch: There are no rows to execute." );
+    SQLSMALLINT param_count = 0;
+    core::SQLNumParams( stmt, &param_count );
+
+    HDB_ENCODING encoding = (( stmt->encoding() == HDB_ENCODING_DEFAULT ) ? stmt->conn->encoding() : stmt->encoding() );
+
+    hdb_malloc_auto_ptr<batch_param> params;
+    if( param_count > 0 ) {
+        params = static_cast<batch_param*>( hdb_malloc( param_count, sizeof( batch_param ), 0 ));
+        memset( params.get(), 0, param_count * sizeof( batch_param ));
+    }
+
+    // find the kind and size of each parameter from all its values
+    SQLULEN row_num = 0;
+    zval* row_z = NULL;
+    ZEND_HASH_FOREACH_VAL( rows_ht, row_z ) {
+
+        ZVAL_DEREF( row_z );
+        ++row_num;
+        CHECK_CUSTOM_ERROR( Z_TYPE_P( row_z ) != IS_ARRAY, stmt, HDB_ERROR_BATCH_ROW_INVALID, static_cast<int>( row_num ), param_count ) {
+            throw core::CoreException();
+        }
+
+        for( SQLSMALLINT i = 0; i < param_count; ++i ) {
+
+            zval* value_z = zend_hash_index_find( Z_ARRVAL_P( row_z ), i );
+            CHECK_CUSTOM_ERROR( value_z == NULL, stmt, HDB_ERROR_BATCH_ROW_INVALID, static_cast<int>( row_num ), param_count ) {
+                throw core::CoreException();
+            }
+            ZVAL_DEREF( value_z );
+
+            batch_param& param = params[i];
+            batch_param::kind_t kind = batch_param::KIND_NULL;
+            SQLLEN len = 0;
+
+            switch( Z_TYPE_P( value_z )) {
+                case IS_NULL:
+                    break;
+                case IS_TRUE:
+                case IS_FALSE:
+                    kind = batch_param::KIND_LONG;
+                    len = BATCH_NUMBER_STRING_LEN;
+                    break;
+                case IS_LONG:
+                    kind = batch_param::KIND_LONG;
+                    len = BATCH_NUMBER_STRING_LEN;
+                    if( Z_LVAL_P( value_z ) < INT_MIN || Z_LVAL_P( value_z ) > INT_MAX ) {
+                        param.big = true;
+                    }
+                    break;
+                case IS_DOUBLE:
+                    kind = batch_param::KIND_DOUBLE;
+                    len = BATCH_NUMBER_STRING_LEN;
+                    break;
+                case IS_STRING:
+                    kind = batch_param::KIND_STRING;
+                    len = Z_STRLEN_P( value_z );
+                    break;
+                default:
+                    THROW_CORE_ERROR( stmt, HDB_ERROR_BATCH_PARAM_INVALID_TYPE, i + 1, static_cast<int>( row_num ));
+                    break;
+            }
+
+            if( kind > param.kind ) {
+                param.kind = kind;
+            }
+            if( len > param.max_len ) {
+                param.max_len = len;
+            }
+        }
+    } ZEND_HASH_FOREACH_END();
+
+    // choose the types of each parameter and lay out all their arrays in a single buffer
+    SQLULEN buffer_size = 0;
+    for( SQLSMALLINT i = 0; i < param_count; ++i ) {
+
+        batch_param& param = params[i];
+        switch( param.kind ) {
+
+            case batch_param::KIND_NULL:
+                // see default_sql_type for why a binary encoding sends binary NULLs
+                param.c_type = ( encoding == HDB_ENCODING_BINARY ) ? SQL_C_BINARY : SQL_C_CHAR;
+                param.sql_type = ( encoding == HDB_ENCODING_BINARY ) ? SQL_BINARY : SQL_CHAR;
+                param.column_size = 1;
+                param.width = 1;
+                break;
+            case batch_param::KIND_LONG:
+                // the column size of an exact numeric type is its precision in digits
+                param.c_type = SQL_C_SBIGINT;
+                param.sql_type = param.big ? SQL_BIGINT : SQL_INTEGER;
+                param.column_size = param.big ? 19 : 10;
+                param.width = sizeof( SQLBIGINT );
+                break;
+            case batch_param::KIND_DOUBLE:
+                // and of SQL_FLOAT, its precision in bits
+                param.c_type = SQL_C_DOUBLE;
+                param.sql_type = SQL_FLOAT;
+                param.column_size = 53;
+                param.width = sizeof( double );
+                break;
+            case batch_param::KIND_STRING:
+            {
+                switch( encoding ) {
+                    case HDB_ENCODING_CHAR:
+                        param.c_type = SQL_C_CHAR;
+                        param.sql_type = SQL_VARCHAR;
+                        break;
+                    case HDB_ENCODING_BINARY:
+                        param.c_type = SQL_C_BINARY;
+                        param.sql_type = SQL_VARBINARY;
+                        break;
+                    case CP_UTF8:
+                        param.c_type = SQL_C_WCHAR;
+                        param.sql_type = SQL_WVARCHAR;
+                        break;
+                    default:
+                        THROW_CORE_ERROR( stmt, HDB_ERROR_INVALID_PARAMETER_ENCODING, i + 1 );
+                        break;
+                }
+
+                // a UTF-8 string never has more UTF-16 characters than it has bytes
+                SQLLEN char_size = ( param.c_type == SQL_C_WCHAR ) ? sizeof( SQLWCHAR ) : sizeof( char );
+                param.width = (( param.max_len > 0 ) ? param.max_len : 1 ) * char_size;
+                if( param.max_len * char_size > SQL_SERVER_MAX_FIELD_SIZE ) {
+                    param.column_size = SQL_SERVER_MAX_TYPE_SIZE;
+                }
+                else {
+                    param.column_size = SQL_SERVER_MAX_FIELD_SIZE / char_size;
+                }
+                break;
+            }
+        }
+
+        param.width = align_to<sizeof( SQLLEN )>( param.width );
+        buffer_size += row_count * ( param.width + sizeof( SQLLEN ));
+    }
+
+    hdb_malloc_auto_ptr<unsigned char> buffer;
+    if( buffer_size > 0 ) {
+        buffer = static_cast<unsigned char*>( hdb_malloc( buffer_size ));
+    }
+    unsigned char* next = buffer.get();
+    for( SQLSMALLINT i = 0; i < param_count; ++i ) {
+        params[i].lengths = reinterpret_cast<SQLLEN*>( next );
+        next += row_count * sizeof( SQLLEN );
+        params[i].values = next;
+        next += row_count * params[i].width;
+    }
+
+    // copy the values of every row into the arrays
+    SQLULEN row = 0;
+    ZEND_HASH_FOREACH_VAL( rows_ht, row_z ) {
+
+        ZVAL_DEREF( row_z );
+        for( SQLSMALLINT i = 0; i < param_count; ++i ) {
+
+            zval* value_z = zend_hash_index_find( Z_ARRVAL_P( row_z ), i );
+            ZVAL_DEREF( value_z );
+
+            batch_param& param = params[i];
+            unsigned char* value = param.values + row * param.width;
+            SQLLEN& length = param.lengths[ row ];
+
+            if( Z_TYPE_P( value_z ) == IS_NULL ) {
+                length = SQL_NULL_DATA;
+                continue;
+            }
+
+            switch( param.kind ) {
+
+                case batch_param::KIND_LONG:
+                    *reinterpret_cast<SQLBIGINT*>( value ) = zval_get_long( value_z );
+                    length = sizeof( SQLBIGINT );
+                    break;
+                case batch_param::KIND_DOUBLE:
+                    *reinterpret_cast<double*>( value ) = zval_get_double( value_z );
+                    length = sizeof( double );
+                    break;
+                case batch_param::KIND_STRING:
+                {
+                    zend_string* str = zval_get_string( value_z );
+                    if( param.c_type == SQL_C_WCHAR && ZSTR_LEN( str ) > 0 ) {
+#ifndef _WIN32
+                        int wchar_len = SystemLocale::ToUtf16Strict( CP_UTF8, ZSTR_VAL( str ), static_cast<int>( ZSTR_LEN( str )),
+                                                                     reinterpret_cast<LPWSTR>( value ),
+                                                                     static_cast<int>( param.width / sizeof( SQLWCHAR )));
+#else
+                        int wchar_len = MultiByteToWideChar( CP_UTF8, MB_ERR_INVALID_CHARS, ZSTR_VAL( str ), static_cast<int>( ZSTR_LEN( str )),
+                                                             reinterpret_cast<LPWSTR>( value ),
+                                                             static_cast<int>( param.width / sizeof( SQLWCHAR )));
+#endif // !_WIN32
+                        zend_string_release( str );
+                        CHECK_CUSTOM_ERROR( wchar_len == 0, stmt, HDB_ERROR_INPUT_PARAM_ENCODING_TRANSLATE, i + 1,
+                                            get_last_error_message() ) {
+                            throw core::CoreException();
+                        }
+                        length = wchar_len * sizeof( SQLWCHAR );
+                    }
+                    else {
+                        memcpy_s( value, param.width, ZSTR_VAL( str ), ZSTR_LEN( str ));
+                        length = ZSTR_LEN( str );
+                        zend_string_release( str );
+                    }
+                    break;
+                }
+                default:
+                    HDB_ASSERT( false, "core_hdb_execute_batch: a value was found in a parameter of NULLs." );
+                    break;
+            }
+        }
+        ++row;
+    } ZEND_HASH_FOREACH_END();
+
+    // bind the arrays and send all the rows at once
+    hdb_malloc_auto_ptr<SQLUSMALLINT> statuses;
+    statuses = static_cast<SQLUSMALLINT*>( hdb_malloc( row_count, sizeof( SQLUSMALLINT ), 0 ));
+    SQLULEN processed = 0;
+
+    try {
+
+        core::SQLSetStmtAttr( stmt, SQL_ATTR_PARAM_BIND_TYPE, reinterpret_cast<SQLPOINTER>( SQL_PARAM_BIND_BY_COLUMN ), SQL_IS_UINTEGER );
+        core::SQLSetStmtAttr( stmt, SQL_ATTR_PARAMSET_SIZE, reinterpret_cast<SQLPOINTER>( row_count ), SQL_IS_UINTEGER );
+        core::SQLSetStmtAttr( stmt, SQL_ATTR_PARAM_STATUS_PTR, statuses.get(), SQL_IS_POINTER );
+        core::SQLSetStmtAttr( stmt, SQL_ATTR_PARAMS_PROCESSED_PTR, &processed, SQL_IS_POINTER );
+
+        for( SQLSMALLINT i = 0; i < param_count; ++i ) {
+            core::SQLBindParameter( stmt, i + 1, SQL_PARAM_INPUT, params[i].c_type, params[i].sql_type, params[i].column_size, 0,
+                                    params[i].values, params[i].width, params[i].lengths );
+        }
+
+        r = ::SQLExecute( stmt->handle() );
+
+        if( r == SQL_ERROR && processed > 0 ) {
+            // some of the rows were executed, so their statuses are returned and the errors are only warnings
+            (void)call_error_handler( stmt, HDB_ERROR_ODBC, true /*warning*/ );
+        }
+        else {
+            CHECK_SQL_ERROR_OR_WARNING( r, stmt ) {
+                throw core::CoreException();
+            }
+        }
+    }
+    catch( core::CoreException& ) {
+
+        reset_batch_params( stmt );
+        throw;
     }
-    catch( core::CoreException& e ) {
 
-        // if the statement executed but failed in a subsequent operation before returning,
-        // we need to cancel the statement and deref the output and stream parameters
-        if ( stmt->send_streams_at_exec ) {
-            finalize_output_parameters( stmt );
-            zend_hash_clean( Z_ARRVAL( stmt->param_streams ));
-        }
-        if( stmt->executed ) {
-            SQLCancel( stmt->handle() );
-            // stmt->executed = false; should this be reset if something fails?
-        }
+    // the arrays are released when this returns, so unbind them
+    reset_batch_params( stmt );
 
-        throw e;
+    for( SQLULEN i = 0; i < row_count; ++i ) {
+        add_next_index_long( statuses_z, ( i < processed ) ? statuses.get()[i] : SQL_PARAM_UNUSED );
     }
+
+    stmt->new_result_set( );
+    stmt->executed = true;
+
+    return r;
 }
 
 
@@ -791,8 +1542,13 @@ bool core_hdb_fetch( _Inout_ hdb_stmt* stmt, _In_ SQLSMALLINT fetch_orientation,
 
     try {
 
-        // clear the field cache of the previous fetch
+        // clear the field cache and the temporaries of the previous fetch
         zend_hash_clean( Z_ARRVAL( stmt->field_cache ));
+        stmt->fetch_arena.reset();
+
+        CHECK_CUSTOM_ERROR( stmt->async_executing, stmt, HDB_ERROR_ASYNC_STILL_EXECUTING ) {
+            throw core::CoreException();
+        }
 
         CHECK_CUSTOM_ERROR( !stmt->executed, stmt, HDB_ERROR_STATEMENT_NOT_EXECUTED ) {
             throw core::CoreException();
@@ -803,7 +1559,7 @@ bool core_hdb_fetch( _Inout_ hdb_stmt* stmt, _In_ SQLSMALLINT fetch_orientation,
         }
         // First time only
         if ( !stmt->fetch_called ) {
-            SQLSMALLINT has_fields = core::SQLNumResultCols( stmt );
+            SQLSMALLINT has_fields = stmt->num_result_cols();
             CHECK_CUSTOM_ERROR( has_fields == 0, stmt, HDB_ERROR_NO_FIELDS ) {
                 throw core::CoreException();
             }
@@ -812,13 +1568,6 @@ bool core_hdb_fetch( _Inout_ hdb_stmt* stmt, _In_ SQLSMALLINT fetch_orientation,
         // close the stream to release the resource
         close_active_stream( stmt );
 
-        // if the statement has rows and is not scrollable but doesn't yet have
-        // fetch_called, this must be the first time we've called hdb_fetch.
-        if( stmt->cursor_type == SQL_CURSOR_FORWARD_ONLY && stmt->has_rows && !stmt->fetch_called ) {
-            stmt->fetch_called = true;
-            return true;
-        }
-
         // move to the record requested.  For absolute records, we use a 0 based offset, so +1 since
         // SQLFetchScroll uses a 1 based offset, otherwise for relative, just use the fetch_offset provided.
         SQLRETURN r = stmt->current_results->fetch( fetch_orientation, ( fetch_orientation == SQL_FETCH_RELATIVE ) ? fetch_offset : fetch_offset + 1 );
@@ -859,6 +1608,10 @@ field_meta_data* core_hdb_field_metadata( _Inout_ hdb_stmt* stmt, _In_ SQLSMALLI
     // pre-condition check
     HDB_ASSERT( colno >= 0, "core_hdb_field_metadata: Invalid column number provided." );
 
+    CHECK_CUSTOM_ERROR( stmt->async_executing, stmt, HDB_ERROR_ASYNC_STILL_EXECUTING ) {
+        throw core::CoreException();
+    }
+
     hdb_malloc_auto_ptr<field_meta_data> meta_data;
     hdb_malloc_auto_ptr<SQLWCHAR> field_name_temp;
     SQLSMALLINT field_len_temp = 0;
@@ -934,6 +1687,10 @@ void core_hdb_get_field( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
 {
 	try {
 
+		CHECK_CUSTOM_ERROR( stmt->async_executing, stmt, HDB_ERROR_ASYNC_STILL_EXECUTING ) {
+			throw core::CoreException();
+		}
+
 		// close the stream to release the resource
 		close_active_stream(stmt );
 
@@ -946,14 +1703,17 @@ void core_hdb_get_field( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
 				*field_len = 0;
 				if( hdb_php_type_out ) { *hdb_php_type_out = HDB_PHPTYPE_NULL; }
 			}
+			else if( cached->type.typeinfo.type == HDB_PHPTYPE_STRING ) {
+
+				// strings are returned as a zend_string
+				field_value = zend_string_init( static_cast<const char*>( cached->value ), cached->len, 0 );
+				*field_len = cached->len;
+				if( hdb_php_type_out) { *hdb_php_type_out = HDB_PHPTYPE_STRING; }
+			}
 			else {
 
-				field_value = hdb_malloc( cached->len, sizeof( char ), 1 );
+				field_value = stmt->alloc_field_value( cached->len + 1 );
 				memcpy_s( field_value, ( cached->len * sizeof( char )), cached->value, cached->len );
-				if( cached->type.typeinfo.type == HDB_PHPTYPE_STRING) {
-					// prevent the 'string not null terminated' warning
-					reinterpret_cast<char*>( field_value )[ cached->len ] = '\0';
-				}
 				*field_len = cached->len;
 				if( hdb_php_type_out) { *hdb_php_type_out = static_cast<HDB_PHPTYPE>(cached->type.typeinfo.type); }
 			}
@@ -962,9 +1722,6 @@ void core_hdb_get_field( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
 
 		hdb_phptype hdb_php_type = hdb_php_type_in;
 
-		SQLLEN sql_field_type = 0;
-		SQLLEN sql_field_len = 0;
-
 		// Make sure that the statement was executed and not just prepared.
 		CHECK_CUSTOM_ERROR( !stmt->executed, stmt, HDB_ERROR_STATEMENT_NOT_EXECUTED ) {
 			throw core::CoreException();
@@ -975,12 +1732,18 @@ void core_hdb_get_field( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
 		if( cache_field && (field_index - stmt->last_field_index ) >= 2 ) {
                    hdb_phptype invalid;
                    invalid.typeinfo.type = HDB_PHPTYPE_INVALID;
+                   HDB_PHPTYPE cached_type = HDB_PHPTYPE_INVALID;
                    for( int i = stmt->last_field_index + 1; i < field_index; ++i ) {
                        HDB_ASSERT( reinterpret_cast<field_cache*>( zend_hash_index_find_ptr( Z_ARRVAL( stmt->field_cache ), i )) == NULL, "Field already cached." );
-                       core_hdb_get_field( stmt, i, invalid, prefer_string, field_value, field_len, cache_field, hdb_php_type_out );
+                       core_hdb_get_field( stmt, i, invalid, prefer_string, field_value, field_len, cache_field, &cached_type );
                        // delete the value returned since we only want it cached, not the actual value
-                       if( field_value ) {
-                           efree( field_value );
+                       if( field_value && cached_type == HDB_PHPTYPE_STRING ) {
+                           zend_string_release( static_cast<zend_string*>( field_value ));
+                           field_value = NULL;
+                           *field_len = 0;
+                       }
+                       else if( field_value ) {
+                           stmt->free_field_value( field_value );
                            field_value = NULL;
                            *field_len = 0;
 		       }
@@ -990,14 +1753,9 @@ void core_hdb_get_field( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
 		// If the php type was not specified set the php type to be the default type.
 		if( hdb_php_type.typeinfo.type == HDB_PHPTYPE_INVALID ) {
 
-			// Get the SQL type of the field.
-			core::SQLColAttributeW( stmt, field_index + 1, SQL_DESC_CONCISE_TYPE, NULL, 0, NULL, &sql_field_type );
-
-			// Get the length of the field.
-			core::SQLColAttributeW( stmt, field_index + 1, SQL_DESC_LENGTH, NULL, 0, NULL, &sql_field_len );
-
-			// Get the corresponding php type from the sql type.
-			hdb_php_type = stmt->sql_type_to_php_type( static_cast<SQLINTEGER>( sql_field_type ), static_cast<SQLUINTEGER>( sql_field_len ), prefer_string );
+			// Get the corresponding php type from the column descriptor.
+			hdb_column_desc& desc = stmt->col_desc( field_index );
+			hdb_php_type = prefer_string ? desc.php_type_prefer_string : desc.php_type;
 		}
 
 		// Verify that we have an acceptable type to convert.
@@ -1013,7 +1771,11 @@ void core_hdb_get_field( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
 
 		// if the user wants us to cache the field, we'll do it
 		if( cache_field ) {
-			field_cache cache( field_value, *field_len, hdb_php_type );
+			void* cache_value = field_value;
+			if( field_value && hdb_php_type.typeinfo.type == HDB_PHPTYPE_STRING ) {
+				cache_value = ZSTR_VAL( static_cast<zend_string*>( field_value ));
+			}
+			field_cache cache( cache_value, *field_len, hdb_php_type );
 			core::hdb_zend_hash_index_update_mem( *stmt, Z_ARRVAL( stmt->field_cache ), field_index, &cache, sizeof(field_cache) );
 		}
 	}
@@ -1023,6 +1785,254 @@ void core_hdb_get_field( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
 	}
 }
 
+// core_hdb_copy_field_to_stream
+// Copy a character or binary field of the current row into a PHP stream, such as php://output or a file, without
+// building a PHP string or hdb stream for it.  The field is read with SQLGetData into one buffer, sized by the
+// hdb chunk_size option of the default stream context, and each chunk is written straight to the stream.
+// Character fields are written in the statement's encoding; UTF-8 is converted within the same buffer.
+// Parameters:
+// stmt        - the hdb_stmt from which to retrieve the column
+// field_index - 0 based index for the column to retrieve
+// dest        - stream the field is written to
+// Returns:
+// The number of bytes written to the stream, 0 for a NULL field.  Exception thrown if an error occurs
+
+size_t core_hdb_copy_field_to_stream( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index, _Inout_ php_stream* dest )
+{
+    CHECK_CUSTOM_ERROR( stmt->async_executing, stmt, HDB_ERROR_ASYNC_STILL_EXECUTING ) {
+        throw core::CoreException();
+    }
+
+    close_active_stream( stmt );
+
+    // make sure that fetch is called before trying to retrieve.
+    CHECK_CUSTOM_ERROR( !stmt->fetch_called, stmt, HDB_ERROR_FETCH_NOT_CALLED ) {
+        throw core::CoreException();
+    }
+
+    // make sure that fields are not retrieved incorrectly.
+    CHECK_CUSTOM_ERROR( stmt->last_field_index > field_index, stmt, HDB_ERROR_FIELD_INDEX_ERROR, field_index,
+                        stmt->last_field_index ) {
+        throw core::CoreException();
+    }
+
+    SQLSMALLINT sql_type = stmt->col_desc( field_index ).sql_type;
+    CHECK_CUSTOM_ERROR( !is_streamable_type( sql_type ), stmt, HDB_ERROR_STREAMABLE_TYPES_ONLY ) {
+        throw core::CoreException();
+    }
+
+    HDB_ENCODING encoding = (( stmt->encoding() == HDB_ENCODING_DEFAULT ) ? stmt->conn->encoding() : stmt->encoding() );
+    SQLSMALLINT c_type = SQL_C_CHAR;
+    SQLLEN terminator_len = 1;
+    if( sql_type == SQL_BINARY || sql_type == SQL_VARBINARY || sql_type == SQL_LONGVARBINARY || encoding == HDB_ENCODING_BINARY ) {
+        c_type = SQL_C_BINARY;
+        terminator_len = 0;
+    }
+    else if( encoding == HDB_ENCODING_UTF8 ) {
+        c_type = SQL_C_WCHAR;
+        terminator_len = sizeof( SQLWCHAR );
+    }
+
+    size_t buffer_size = std::max( core_hdb_stream_max_chunk_size( php_stream_context_from_zval( NULL, 0 )), HDB_STREAM_MIN_CHUNK_SIZE );
+    hdb_malloc_auto_ptr<char> buffer;
+    buffer = static_cast<char*>( hdb_malloc( buffer_size ));
+
+    // UTF-16 is read into the end of the buffer and converted to UTF-8 at its start.  Each UTF-16 character becomes
+    // at most 3 bytes, so reading no more than a third of the buffer's size in characters keeps the UTF-8 written
+    // behind the UTF-16 still to be converted.
+    size_t data_offset = 0;
+    SQLLEN data_len = static_cast<SQLLEN>( buffer_size );
+    if( c_type == SQL_C_WCHAR ) {
+        size_t wide_count = ( buffer_size - 1 ) / 3;
+        data_offset = buffer_size - wide_count * sizeof( SQLWCHAR );
+        data_offset -= data_offset % sizeof( SQLWCHAR );
+        data_len = static_cast<SQLLEN>( wide_count * sizeof( SQLWCHAR ));
+    }
+
+    size_t copied = 0;
+    bool split_surrogate = false;   // the last read ended with the first half of a surrogate pair
+
+    while( true ) {
+
+        // the first half of a surrogate pair is kept at the start of the UTF-16 to be converted with its second half
+        SQLLEN kept_len = split_surrogate ? sizeof( SQLWCHAR ) : 0;
+        char* get_data_buffer = buffer + data_offset + kept_len;
+        SQLLEN get_data_len = data_len - kept_len;
+        SQLLEN read = 0;
+
+        // read through the result set, since the field may have been fetched as part of a block of bound rows
+        SQLRETURN r = stmt->current_results->get_data( field_index + 1, c_type, get_data_buffer, get_data_len, &read,
+                                                       false /*handle_warning*/ );
+        CHECK_SQL_ERROR( r, stmt ) {
+            throw core::CoreException();
+        }
+
+        if( r == SQL_NO_DATA || read == SQL_NULL_DATA ) {
+            break;
+        }
+
+        // when the field doesn't fit, the buffer is filled but for the null terminator of character data
+        bool more = ( read == SQL_NO_TOTAL || read > get_data_len - terminator_len );
+        if( r == SQL_SUCCESS_WITH_INFO && !more ) {
+            CHECK_SQL_WARNING( r, stmt );
+        }
+
+        size_t len = static_cast<size_t>( more ? get_data_len - terminator_len : read );
+        char* data = get_data_buffer;
+
+        if( c_type == SQL_C_WCHAR ) {
+
+            SQLWCHAR* wide = reinterpret_cast<SQLWCHAR*>( buffer + data_offset );
+            size_t wide_len = ( len + kept_len ) / sizeof( SQLWCHAR );
+
+            SQLWCHAR high_surrogate = 0;
+            split_surrogate = more && wide_len > 0 && ( wide[ wide_len - 1 ] & 0xFC00 ) == 0xD800;
+            if( split_surrogate ) {
+                high_surrogate = wide[ --wide_len ];
+            }
+
+            len = 0;
+            if( wide_len > 0 ) {
+
+                if( wide_len > INT_MAX || buffer_size > INT_MAX ) {
+                    LOG( SEV_ERROR, "UTF-16 (wide character) string mapping: buffer length exceeded." );
+                    throw core::CoreException();
+                }
+            #ifndef _WIN32
+                int enc_len = SystemLocale::FromUtf16( encoding, reinterpret_cast<LPCWSTR>( wide ), static_cast<int>( wide_len ), buffer,
+                                                       static_cast<int>( buffer_size ), NULL, NULL );
+            #else
+                int enc_len = WideCharToMultiByte( encoding, isVistaOrGreater ? WC_ERR_INVALID_CHARS : 0, reinterpret_cast<LPCWSTR>( wide ),
+                                                   static_cast<int>( wide_len ), buffer, static_cast<int>( buffer_size ), NULL, NULL );
+            #endif // !_WIN32
+                CHECK_CUSTOM_ERROR( enc_len == 0, stmt, HDB_ERROR_FIELD_ENCODING_TRANSLATE, get_last_error_message() ) {
+                    throw core::CoreException();
+                }
+                len = enc_len;
+            }
+
+            if( split_surrogate ) {
+                wide[ 0 ] = high_surrogate;
+            }
+            data = buffer;
+        }
+
+        if( len > 0 ) {
+
+            size_t written = php_stream_write( dest, data, len );
+            CHECK_CUSTOM_ERROR( written != len, stmt, HDB_ERROR_STREAM_WRITE ) {
+                throw core::CoreException();
+            }
+            copied += len;
+        }
+
+        if( !more ) {
+            break;
+        }
+    }
+
+    // sucessfully retrieved the field, so update our last retrieved field
+    if( stmt->last_field_index < field_index ) {
+        stmt->last_field_index = field_index;
+    }
+
+    return copied;
+}
+
+// core_hdb_get_scalar_field
+// Return the value of an int or float column directly in a zval.  The value is read into a local rather than
+// the heap buffer core_hdb_get_field returns, so numeric fields don't cost an allocation each.
+// Parameters:
+// stmt                 - the hdb_stmt from which to retrieve the column
+// field_index          - 0 based index for the column to retrieve
+// hdb_php_type_in   - hdb_php_type structure that tells what format to return the data in
+// prefer_string        - prefer strings to streams when the default type is used
+// field_z              - zval set to the value of the field
+// Returns:
+// true if the field was retrieved.  false if it isn't returned as an int or float (or was already cached), in which
+// case field_z is untouched and the field is retrieved with core_hdb_get_field.  Exception thrown if an error occurs
+
+bool core_hdb_get_scalar_field( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index, _In_ hdb_phptype hdb_php_type_in,
+                                _In_ bool prefer_string, _Out_ zval& field_z )
+{
+    CHECK_CUSTOM_ERROR( stmt->async_executing, stmt, HDB_ERROR_ASYNC_STILL_EXECUTING ) {
+        throw core::CoreException();
+    }
+
+    // cached fields are returned from the cache by core_hdb_get_field
+    if( zend_hash_index_exists( Z_ARRVAL( stmt->field_cache ), static_cast<zend_ulong>( field_index ))) {
+        return false;
+    }
+
+    // Make sure that the statement was executed and not just prepared.
+    CHECK_CUSTOM_ERROR( !stmt->executed, stmt, HDB_ERROR_STATEMENT_NOT_EXECUTED ) {
+        throw core::CoreException();
+    }
+
+    hdb_phptype hdb_php_type = hdb_php_type_in;
+    if( hdb_php_type.typeinfo.type == HDB_PHPTYPE_INVALID ) {
+        hdb_column_desc& desc = stmt->col_desc( field_index );
+        hdb_php_type = prefer_string ? desc.php_type_prefer_string : desc.php_type;
+    }
+
+    if( hdb_php_type.typeinfo.type != HDB_PHPTYPE_INT && hdb_php_type.typeinfo.type != HDB_PHPTYPE_FLOAT ) {
+        return false;
+    }
+
+    // close the stream to release the resource
+    close_active_stream( stmt );
+
+    // make sure that fetch is called before trying to retrieve.
+    CHECK_CUSTOM_ERROR( !stmt->fetch_called, stmt, HDB_ERROR_FETCH_NOT_CALLED ) {
+        throw core::CoreException();
+    }
+
+    // make sure that fields are not retrieved incorrectly.
+    CHECK_CUSTOM_ERROR( stmt->last_field_index > field_index, stmt, HDB_ERROR_FIELD_INDEX_ERROR, field_index,
+                        stmt->last_field_index ) {
+        throw core::CoreException();
+    }
+
+    LONG long_value = 0;
+    double double_value = 0.0;
+    SQLLEN field_len = 0;
+    SQLRETURN r = SQL_SUCCESS;
+
+    if( hdb_php_type.typeinfo.type == HDB_PHPTYPE_INT ) {
+        r = stmt->current_results->get_data( field_index + 1, SQL_C_LONG, &long_value, sizeof( long_value ),
+                                             &field_len, true /*handle_warning*/ );
+    }
+    else {
+        r = stmt->current_results->get_data( field_index + 1, SQL_C_DOUBLE, &double_value, sizeof( double_value ),
+                                             &field_len, true /*handle_warning*/ );
+    }
+
+    CHECK_SQL_ERROR_OR_WARNING( r, stmt ) {
+        throw core::CoreException();
+    }
+
+    CHECK_CUSTOM_ERROR(( r == SQL_NO_DATA ), stmt, HDB_ERROR_NO_DATA, field_index ) {
+        throw core::CoreException();
+    }
+
+    if( field_len == SQL_NULL_DATA ) {
+        ZVAL_NULL( &field_z );
+    }
+    else if( hdb_php_type.typeinfo.type == HDB_PHPTYPE_INT ) {
+        ZVAL_LONG( &field_z, long_value );
+    }
+    else {
+        ZVAL_DOUBLE( &field_z, double_value );
+    }
+
+    // sucessfully retrieved the field, so update our last retrieved field
+    if( stmt->last_field_index < field_index ) {
+        stmt->last_field_index = field_index;
+    }
+
+    return true;
+}
+
 // core_hdb_has_any_result
 // return if any result set or rows affected message is waiting
 // to be consumed and moved over by hdb_next_result.
@@ -1033,8 +2043,8 @@ void core_hdb_get_field( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
 
 bool core_hdb_has_any_result( _Inout_ hdb_stmt* stmt )
 {
-    // Use SQLNumResultCols to determine if we have rows or not.
-    SQLSMALLINT num_cols = core::SQLNumResultCols( stmt );
+    // Use the number of columns to determine if we have rows or not.
+    SQLSMALLINT num_cols = stmt->num_result_cols();
     // use SQLRowCount to determine if there is a rows status waiting
     SQLLEN rows_affected = core::SQLRowCount( stmt );
     return (num_cols != 0) || (rows_affected > 0);
@@ -1051,6 +2061,10 @@ void core_hdb_next_result( _Inout_ hdb_stmt* stmt , _In_ bool finalize_output_pa
 {
     try {
 
+        CHECK_CUSTOM_ERROR( stmt->async_executing, stmt, HDB_ERROR_ASYNC_STILL_EXECUTING ) {
+            throw core::CoreException();
+        }
+
         // make sure that the statement has been executed.
         CHECK_CUSTOM_ERROR( !stmt->executed, stmt, HDB_ERROR_STATEMENT_NOT_EXECUTED ) {
             throw core::CoreException();
@@ -1062,8 +2076,9 @@ void core_hdb_next_result( _Inout_ hdb_stmt* stmt , _In_ bool finalize_output_pa
 
         close_active_stream( stmt );
 
-        //Clear column sql types and sql display sizes.
-        zend_hash_clean( Z_ARRVAL( stmt->col_cache ));
+        // the column descriptors belong to the result set being left
+        stmt->col_descs.reset();
+        stmt->col_descs_count = -1;
 
         SQLRETURN r;
         if( throw_on_errors ) {
@@ -1127,31 +2142,20 @@ void core_hdb_set_scrollable( _Inout_ hdb_stmt* stmt, _In_ unsigned long cursor_
 {
     try {
 
+        SQLULEN odbc_cursor_type = SQL_CURSOR_FORWARD_ONLY;
+
         switch( cursor_type ) {
 
             case SQL_CURSOR_STATIC:
-                core::SQLSetStmtAttr( stmt, SQL_ATTR_CURSOR_TYPE,
-                                      reinterpret_cast<SQLPOINTER>( SQL_CURSOR_STATIC ), SQL_IS_UINTEGER );
-                break;
-
             case SQL_CURSOR_DYNAMIC:
-                core::SQLSetStmtAttr( stmt, SQL_ATTR_CURSOR_TYPE,
-                                      reinterpret_cast<SQLPOINTER>( SQL_CURSOR_DYNAMIC ), SQL_IS_UINTEGER );
-                break;
-
             case SQL_CURSOR_KEYSET_DRIVEN:
-                core::SQLSetStmtAttr( stmt, SQL_ATTR_CURSOR_TYPE,
-                                      reinterpret_cast<SQLPOINTER>( SQL_CURSOR_KEYSET_DRIVEN ), SQL_IS_UINTEGER );
-                break;
-
             case SQL_CURSOR_FORWARD_ONLY:
-                core::SQLSetStmtAttr( stmt, SQL_ATTR_CURSOR_TYPE,
-                                      reinterpret_cast<SQLPOINTER>( SQL_CURSOR_FORWARD_ONLY ), SQL_IS_UINTEGER );
+                odbc_cursor_type = cursor_type;
                 break;
 
             case HDB_CURSOR_BUFFERED:
-                core::SQLSetStmtAttr( stmt, SQL_ATTR_CURSOR_TYPE,
-                                      reinterpret_cast<SQLPOINTER>( SQL_CURSOR_FORWARD_ONLY ), SQL_IS_UINTEGER );
+            case HDB_CURSOR_BUFFERED_COLUMNAR:
+                odbc_cursor_type = SQL_CURSOR_FORWARD_ONLY;
                 break;
 
             default:
@@ -1159,6 +2163,14 @@ void core_hdb_set_scrollable( _Inout_ hdb_stmt* stmt, _In_ unsigned long cursor_
                 break;
         }
 
+        // a handle from the statement cache is already prepared with its cursor type, which can't be set again then
+        SQLULEN handle_cursor_type = SQL_CURSOR_FORWARD_ONLY;
+        if( !SQL_SUCCEEDED( ::SQLGetStmtAttr( stmt->handle(), SQL_ATTR_CURSOR_TYPE, &handle_cursor_type, SQL_IS_UINTEGER, NULL )) ||
+            handle_cursor_type != odbc_cursor_type ) {
+
+            core::SQLSetStmtAttr( stmt, SQL_ATTR_CURSOR_TYPE, reinterpret_cast<SQLPOINTER>( odbc_cursor_type ), SQL_IS_UINTEGER );
+        }
+
         stmt->cursor_type = cursor_type;
 
     }
@@ -1187,6 +2199,32 @@ void core_hdb_set_buffered_query_limit( _Inout_ hdb_stmt* stmt, _In_ SQLLEN limi
     stmt->buffered_query_limit = limit;
 }
 
+// Sets the most bytes read from a stream parameter and sent to the server with one SQLPutData call.  Larger
+// packets mean fewer round trips through the ODBC driver when sending large streams.
+void core_hdb_set_stream_chunk_size( _Inout_ hdb_stmt* stmt, _In_ zval* value_z )
+{
+    CHECK_CUSTOM_ERROR( Z_TYPE_P( value_z ) != IS_LONG || Z_LVAL_P( value_z ) <= 0 ||
+                        Z_LVAL_P( value_z ) > HDB_STREAM_PARAM_CHUNK_SIZE_MAX, stmt, HDB_ERROR_INVALID_STREAM_CHUNK_SIZE,
+                        HDB_STREAM_PARAM_CHUNK_SIZE_MAX ) {
+        throw core::CoreException();
+    }
+
+    stmt->stream_chunk_size = static_cast<size_t>( Z_LVAL_P( value_z ));
+}
+
+// Sets the most rows of a forward only result set fetched with one SQLFetchScroll call.  The rows are held in the
+// bound column buffers of hdb_bound_result_set and served from there, so 1 turns off block fetches.
+void core_hdb_set_prefetch_rows( _Inout_ hdb_stmt* stmt, _In_ zval* value_z )
+{
+    CHECK_CUSTOM_ERROR( Z_TYPE_P( value_z ) != IS_LONG || Z_LVAL_P( value_z ) <= 0 ||
+                        Z_LVAL_P( value_z ) > HDB_PREFETCH_ROWS_MAX, stmt, HDB_ERROR_INVALID_PREFETCH_ROWS,
+                        HDB_PREFETCH_ROWS_MAX ) {
+        throw core::CoreException();
+    }
+
+    stmt->prefetch_rows = static_cast<SQLULEN>( Z_LVAL_P( value_z ));
+}
+
 
 // Overloaded. Extracts the long value and calls the core_hdb_set_query_timeout
 // which accepts timeout parameter as a long. If the zval is not of type long
@@ -1261,6 +2299,10 @@ void core_hdb_set_send_at_exec( _Inout_ hdb_stmt* stmt, _In_ zval* value_z )
 
 bool core_hdb_send_stream_packet( _Inout_ hdb_stmt* stmt )
 {
+    CHECK_CUSTOM_ERROR( stmt->async_executing, stmt, HDB_ERROR_ASYNC_STILL_EXECUTING ) {
+        throw core::CoreException();
+    }
+
     // if there no current parameter to process, get the next one
     // (probably because this is the first call to hdb_send_stream_data)
     if( stmt->current_stream.stream_z == NULL ) {
@@ -1292,60 +2334,67 @@ bool core_hdb_send_stream_packet( _Inout_ hdb_stmt* stmt )
     }
     // read the data from the stream, send it via SQLPutData and track how much we've sent.
     else {
-        char buffer[ PHP_STREAM_BUFFER_SIZE + 1 ];
-		std::size_t buffer_size = sizeof( buffer ) - 3;   // -3 to preserve enough space for a cut off UTF-8 character
-        std::size_t read = php_stream_read( param_stream, buffer, buffer_size );
+        // the buffers are allocated with the first packet and reused for the rest of the statement's streams.  The
+        // extra 3 bytes hold the rest of a UTF-8 character cut off at the end of a packet.
+        std::size_t buffer_size = stmt->stream_chunk_size;
+        if( stmt->stream_buffer.get() == NULL ) {
+            stmt->stream_buffer = static_cast<char*>( hdb_malloc( buffer_size, sizeof( char ), 3 ));
+        }
+        char* buffer = stmt->stream_buffer;
 
-		if (read > UINT_MAX)
-		{
-			LOG(SEV_ERROR, "PHP stream: buffer length exceeded.");
-			throw core::CoreException();
-		}
+        // fill the buffer, since a stream may return less than was asked for (e.g., a socket or a pipe) and each
+        // packet is a separate call to SQLPutData
+        std::size_t read = 0;
+        while( read < buffer_size ) {
+
+            std::size_t new_read = php_stream_read( param_stream, buffer + read, buffer_size - read );
+            if( new_read > buffer_size - read ) {
+                LOG( SEV_ERROR, "PHP stream: buffer length exceeded." );
+                throw core::CoreException();
+            }
+            if( new_read == 0 ) {
+                break;
+            }
+            read += new_read;
+        }
 
         stmt->current_stream_read += static_cast<unsigned int>( read );
         if( read > 0 ) {
             // if this is a UTF-8 stream, then we will use the UTF-8 encoding to determine if we're in the middle of a character
-            // then read in the appropriate number more bytes and then retest the string.  This way we try at most to convert it
-            // twice.
+            // and read in the appropriate number more bytes before the packet is converted.
             // If we support other encondings in the future, we'll simply need to read a single byte and then retry the conversion
             // since all other MBCS supported by SQL Server are 2 byte maximum size.
             if( stmt->current_stream.encoding == CP_UTF8 ) {
 
-                // the size of wbuffer is set for the worst case of UTF-8 to UTF-16 conversion, which is a
-                // expansion of 2x the UTF-8 size.
-                SQLWCHAR wbuffer[ PHP_STREAM_BUFFER_SIZE + 1 ];
-                int wbuffer_size = static_cast<int>( sizeof( wbuffer ) / sizeof( SQLWCHAR ));
-				DWORD last_error_code = ERROR_SUCCESS;
-				// buffer_size is the # of wchars.  Since it set to stmt->param_buffer_size / 2, this is accurate
-#ifndef _WIN32
-                int wsize = SystemLocale::ToUtf16Strict( stmt->current_stream.encoding, buffer, static_cast<int>(read), wbuffer, wbuffer_size, &last_error_code );
-#else
-                int wsize = MultiByteToWideChar( stmt->current_stream.encoding, MB_ERR_INVALID_CHARS, buffer, static_cast<int>( read ), wbuffer, wbuffer_size );
-                last_error_code = GetLastError();
-#endif // !_WIN32
+                // the size of wbuffer is set for the worst case of UTF-8 to UTF-16 conversion, which is one
+                // UTF-16 character for each byte of UTF-8.
+                int wbuffer_size = static_cast<int>( buffer_size + 3 );
+                if( stmt->stream_wbuffer.get() == NULL ) {
+                    stmt->stream_wbuffer = static_cast<SQLWCHAR*>( hdb_malloc( wbuffer_size, sizeof( SQLWCHAR ), 0 ));
+                }
+                SQLWCHAR* wbuffer = stmt->stream_wbuffer;
 
-				if( wsize == 0 && last_error_code == ERROR_NO_UNICODE_TRANSLATION ) {
+                // read the rest of a character cut off at the end of the packet before converting it, so each packet
+                // is converted once.  Only the last character of the packet is examined.
+                size_t need_to_read = calc_utf8_missing( stmt, buffer, read );
+                if( need_to_read > 0 ) {
 
-                    // this will calculate how many bytes were cut off from the last UTF-8 character and read that many more
-                    // in, then reattempt the conversion.  If it fails the second time, then an error is returned.
-                    size_t need_to_read = calc_utf8_missing( stmt, buffer, read );
-                    // read the missing bytes
-                    size_t new_read = php_stream_read( param_stream, static_cast<char*>( buffer ) + read,
-                                                       need_to_read );
+                    size_t new_read = php_stream_read( param_stream, static_cast<char*>( buffer ) + read, need_to_read );
                     // if the bytes couldn't be read, then we return an error
                     CHECK_CUSTOM_ERROR( new_read != need_to_read, stmt, HDB_ERROR_INPUT_STREAM_ENCODING_TRANSLATE, get_last_error_message( ERROR_NO_UNICODE_TRANSLATION )) {
                         throw core::CoreException();
                     }
-                    // try the conversion again with the complete character
+                    read += new_read;
+                    stmt->current_stream_read += static_cast<unsigned int>( new_read );
+                }
+
 #ifndef _WIN32
-                    wsize = SystemLocale::ToUtf16Strict( stmt->current_stream.encoding, buffer, static_cast<int>(read + new_read), wbuffer, static_cast<int>(sizeof( wbuffer ) / sizeof( SQLWCHAR )));
+                int wsize = SystemLocale::ToUtf16Strict( stmt->current_stream.encoding, buffer, static_cast<int>( read ), wbuffer, wbuffer_size );
 #else
-                    wsize = MultiByteToWideChar( stmt->current_stream.encoding, MB_ERR_INVALID_CHARS, buffer, static_cast<int>( read + new_read ), wbuffer, static_cast<int>( sizeof( wbuffer ) / sizeof( wchar_t )));
-#endif //!_WIN32
-                    // something else must be wrong if it failed
-                    CHECK_CUSTOM_ERROR( wsize == 0, stmt, HDB_ERROR_INPUT_STREAM_ENCODING_TRANSLATE, get_last_error_message( ERROR_NO_UNICODE_TRANSLATION )) {
-                        throw core::CoreException();
-                    }
+                int wsize = MultiByteToWideChar( stmt->current_stream.encoding, MB_ERR_INVALID_CHARS, buffer, static_cast<int>( read ), wbuffer, wbuffer_size );
+#endif // !_WIN32
+                CHECK_CUSTOM_ERROR( wsize == 0, stmt, HDB_ERROR_INPUT_STREAM_ENCODING_TRANSLATE, get_last_error_message( ERROR_NO_UNICODE_TRANSLATION )) {
+                    throw core::CoreException();
                 }
                 core::SQLPutData( stmt, wbuffer, wsize * sizeof( SQLWCHAR ) );
             }
@@ -1391,6 +2440,16 @@ void stmt_option_buffered_query_limit:: operator()( _Inout_ hdb_stmt* stmt, stmt
     core_hdb_set_buffered_query_limit( stmt, value_z );
 }
 
+void stmt_option_stream_chunk_size:: operator()( _Inout_ hdb_stmt* stmt, stmt_option const* /*opt*/, _In_ zval* value_z )
+{
+    core_hdb_set_stream_chunk_size( stmt, value_z );
+}
+
+void stmt_option_prefetch_rows:: operator()( _Inout_ hdb_stmt* stmt, stmt_option const* /*opt*/, _In_ zval* value_z )
+{
+    core_hdb_set_prefetch_rows( stmt, value_z );
+}
+
 
 // internal function to release the active stream.  Called by each main API function
 // that will alter the statement and cancel any retrieval of data from a stream.
@@ -1437,105 +2496,55 @@ bool is_streamable_type( _In_ SQLLEN sql_type )
     return false;
 }
 
-void calc_string_size( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index, _In_ SQLLEN sql_type,  _Inout_ SQLLEN& size )
+// calculates how many bytes of the last UTF-8 character were cut off from the end of a buffer, or 0 if the buffer
+// ends with a complete character.  Only the last character is examined, at most 4 bytes.
+
+size_t calc_utf8_missing( _Inout_ hdb_stmt* stmt, _In_reads_(buffer_end) const char* buffer, _In_ size_t buffer_end )
 {
-    try {
+    const unsigned char* start = reinterpret_cast<const unsigned char*>( buffer ) + buffer_end - 1;
+    size_t have = 1;
 
-        switch( sql_type ) {
-            // for types that are fixed in size or for which the size is unknown, return the display size.
-            case SQL_BIGINT:
-            case SQL_BIT:
-            case SQL_INTEGER:
-            case SQL_SMALLINT:
-            case SQL_TINYINT:
-            case SQL_GUID:
-            case SQL_FLOAT:
-            case SQL_DOUBLE:
-            case SQL_REAL:
-            case SQL_DECIMAL:
-            case SQL_NUMERIC:
-            case SQL_TYPE_TIMESTAMP:
-            case SQL_LONGVARBINARY:
-            case SQL_LONGVARCHAR:
-            case SQL_BINARY:
-            case SQL_CHAR:
-            case SQL_VARBINARY:
-            case SQL_VARCHAR:
-            //case SQL_SS_XML:
-            //case SQL_SS_UDT:
-            case SQL_WLONGVARCHAR:
-            case SQL_DATETIME:
-            case SQL_TYPE_DATE:
-            //case SQL_SS_TIME2:
-            //case SQL_SS_TIMESTAMPOFFSET:
-            //case SQL_SS_VARIANT:
-            {
-                // unixODBC 2.3.1 requires wide calls to support pooling
-                core::SQLColAttributeW( stmt, field_index + 1, SQL_DESC_DISPLAY_SIZE, NULL, 0, NULL, &size );
-                break;
-            }
+    // rewind until we are at the byte that starts the last character
+    while( have < 4 && start > reinterpret_cast<const unsigned char*>( buffer ) && ( *start & UTF8_MIDBYTE_MASK ) == UTF8_MIDBYTE_TAG ) {
+        --start;
+        ++have;
+    }
 
-            // for wide char types for which the size is known, return the octet length instead, since it will include the
-            // the number of bytes necessary for the string, not just the characters
-            case SQL_WCHAR:
-            case SQL_WVARCHAR:
-            {
-                // unixODBC 2.3.1 requires wide calls to support pooling
-                core::SQLColAttributeW( stmt, field_index + 1, SQL_DESC_OCTET_LENGTH, NULL, 0, NULL, &size );
+    // determine how many bytes the character has from the number of high bits set in its first byte
+    size_t char_len = 0;
+    if(( *start & UTF8_MIDBYTE_TAG ) == 0 ) {
+        char_len = 1;
+    }
+    else {
+        switch( *start & UTF8_NBYTESEQ_MASK ) {
+            case UTF8_2BYTESEQ_TAG1:
+            case UTF8_2BYTESEQ_TAG2:
+                char_len = 2;
+                break;
+            case UTF8_3BYTESEQ_TAG:
+                char_len = 3;
+                break;
+            case UTF8_4BYTESEQ_TAG:
+                char_len = 4;
                 break;
-            }
-
-            default:
-                DIE ( "Unexpected SQL type encountered in calc_string_size." );
         }
     }
-    catch( core::CoreException& e ) {
-        throw e;
-    }
-}
-
-
-// calculates how many characters were cut off from the end of a buffer when reading
-// in UTF-8 encoded text
-
-size_t calc_utf8_missing( _Inout_ hdb_stmt* stmt, _In_reads_(buffer_end) const char* buffer, _In_ size_t buffer_end )
-{
-    const char* last_char = buffer + buffer_end - 1;
-    size_t need_to_read = 0;
-
-    // rewind until we are at the byte that starts the cut off character
-    while( (*last_char & UTF8_MIDBYTE_MASK ) == UTF8_MIDBYTE_TAG ) {
-        --last_char;
-        ++need_to_read;
-    }
 
-    // determine how many bytes we need to read in based on the number of bytes in the character
-    // (# of high bits set) versus the number of bytes we've already read.
-    switch( *last_char & UTF8_NBYTESEQ_MASK ) {
-        case UTF8_2BYTESEQ_TAG1:
-        case UTF8_2BYTESEQ_TAG2:
-            need_to_read = 1 - need_to_read;
-            break;
-        case UTF8_3BYTESEQ_TAG:
-            need_to_read = 2 - need_to_read;
-            break;
-        case UTF8_4BYTESEQ_TAG:
-            need_to_read = 3 - need_to_read;
-            break;
-        default:
-            THROW_CORE_ERROR( stmt, HDB_ERROR_INPUT_STREAM_ENCODING_TRANSLATE,
-                              get_last_error_message( ERROR_NO_UNICODE_TRANSLATION ));
-            break;
+    // a byte that can't start a character, or more continuation bytes than the character has
+    CHECK_CUSTOM_ERROR( char_len == 0 || have > char_len, stmt, HDB_ERROR_INPUT_STREAM_ENCODING_TRANSLATE,
+                        get_last_error_message( ERROR_NO_UNICODE_TRANSLATION )) {
+        throw core::CoreException();
     }
 
-    return need_to_read;
+    return char_len - have;
 }
 
 
 // Caller is responsible for freeing the memory allocated for the field_value.
 // The memory allocation has to happen in the core layer because otherwise
 // the driver layer would have to calculate size of the field_value
-// to decide the amount of memory allocation.
+// to decide the amount of memory allocation.  String fields are returned as
+// a zend_string, which the caller releases or hands to a zval.
 void core_get_field_common( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index, _Inout_ hdb_phptype
                             hdb_php_type, _Inout_updates_bytes_(*field_len) void*& field_value, _Inout_ SQLLEN* field_len )
 {
@@ -1558,11 +2567,9 @@ void core_get_field_common( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_inde
 
         case HDB_PHPTYPE_INT:
         {
-            hdb_malloc_auto_ptr<long> field_value_temp;
-            field_value_temp = static_cast<long*>( hdb_malloc( sizeof( long )));
-            *field_value_temp = 0;
+            long field_value_temp = 0;
 
-            SQLRETURN r = stmt->current_results->get_data( field_index + 1, SQL_C_LONG, field_value_temp, sizeof( long ),
+            SQLRETURN r = stmt->current_results->get_data( field_index + 1, SQL_C_LONG, &field_value_temp, sizeof( long ),
                                                            field_len, true /*handle_warning*/ );
 
             CHECK_SQL_ERROR_OR_WARNING( r, stmt ) {
@@ -1578,17 +2585,16 @@ void core_get_field_common( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_inde
                 break;
             }
 
-            field_value = field_value_temp;
-            field_value_temp.transferred();
+            field_value = stmt->alloc_field_value( sizeof( long ));
+            *static_cast<long*>( field_value ) = field_value_temp;
             break;
         }
 
         case HDB_PHPTYPE_FLOAT:
         {
-            hdb_malloc_auto_ptr<double> field_value_temp;
-            field_value_temp = static_cast<double*>( hdb_malloc( sizeof( double )));
+            double field_value_temp = 0.0;
 
-            SQLRETURN r = stmt->current_results->get_data( field_index + 1, SQL_C_DOUBLE, field_value_temp, sizeof( double ),
+            SQLRETURN r = stmt->current_results->get_data( field_index + 1, SQL_C_DOUBLE, &field_value_temp, sizeof( double ),
                                                            field_len, true /*handle_warning*/ );
 
             CHECK_SQL_ERROR_OR_WARNING( r, stmt ) {
@@ -1604,8 +2610,8 @@ void core_get_field_common( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_inde
                 break;
             }
 
-            field_value = field_value_temp;
-            field_value_temp.transferred();
+            field_value = stmt->alloc_field_value( sizeof( double ));
+            *static_cast<double*>( field_value ) = field_value_temp;
             break;
         }
 
@@ -1635,14 +2641,12 @@ void core_get_field_common( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_inde
                 throw core::CoreException();
             }
 
-            zval_auto_ptr return_value_z;
-            return_value_z = ( zval * )hdb_malloc( sizeof( zval ));
-            ZVAL_UNDEF( return_value_z );
+            zval return_value_z;
+            ZVAL_UNDEF( &return_value_z );
 
             if( *field_len == SQL_NULL_DATA ) {
-                ZVAL_NULL( return_value_z );
-                field_value = reinterpret_cast<void*>( return_value_z.get());
-                return_value_z.transferred();
+                field_value = stmt->alloc_field_value( sizeof( zval ));
+                ZVAL_NULL( static_cast<zval*>( field_value ));
                 break;
             }
 
@@ -1651,13 +2655,14 @@ void core_get_field_common( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_inde
             core::hdb_zval_stringl( &function_z, "date_create", sizeof("date_create") - 1 );
             params[0] = field_value_temp_z;
 
-            if( call_user_function( EG( function_table ), NULL, &function_z, return_value_z, 1,
+            if( call_user_function( EG( function_table ), NULL, &function_z, &return_value_z, 1,
                 params ) == FAILURE) {
+                zval_ptr_dtor( &return_value_z );
                 THROW_CORE_ERROR(stmt, HDB_ERROR_DATETIME_CONVERSION_FAILED);
             }
 
-            field_value = reinterpret_cast<void*>( return_value_z.get());
-            return_value_z.transferred();
+            field_value = stmt->alloc_field_value( sizeof( zval ));
+            ZVAL_COPY_VALUE( static_cast<zval*>( field_value ), &return_value_z );
             zend_string_free( Z_STR( field_value_temp_z ));
             zend_string_free( Z_STR( function_z ));
             break;
@@ -1670,18 +2675,14 @@ void core_get_field_common( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_inde
         {
             php_stream* stream = NULL;
             hdb_stream* ss = NULL;
-            SQLLEN sql_type;
-
-            SQLRETURN r = SQLColAttributeW( stmt->handle(), field_index + 1, SQL_DESC_TYPE, NULL, 0, NULL, &sql_type );
-            CHECK_SQL_ERROR_OR_WARNING( r, stmt ) {
-                throw core::CoreException();
-            }
+            SQLLEN sql_type = stmt->col_desc( field_index ).sql_type;
 
             CHECK_CUSTOM_ERROR( !is_streamable_type( sql_type ), stmt, HDB_ERROR_STREAMABLE_TYPES_ONLY ) {
                 throw core::CoreException();
             }
 
-            stream = php_stream_open_wrapper( "hdb://sqlncli10", "r", 0, NULL );
+            // the default stream context may give the chunk size of the stream
+            stream = php_stream_open_wrapper_ex( "hdb://sqlncli10", "r", 0, NULL, php_stream_context_from_zval( NULL, 0 ));
 
             CHECK_CUSTOM_ERROR( !stream, stmt, HDB_ERROR_STREAM_CREATE ) {
                 throw core::CoreException();
@@ -1693,15 +2694,9 @@ void core_get_field_common( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_inde
             ss->sql_type = static_cast<SQLUSMALLINT>( sql_type );
             ss->encoding = static_cast<HDB_ENCODING>( hdb_php_type.typeinfo.encoding );
 
-            zval_auto_ptr return_value_z;
-            return_value_z = ( zval * )hdb_malloc( sizeof( zval ));
-            ZVAL_UNDEF( return_value_z );
-
             // turn our stream into a zval to be returned
-            php_stream_to_zval( stream, return_value_z );
-
-            field_value = reinterpret_cast<void*>( return_value_z.get());
-            return_value_z.transferred();
+            field_value = stmt->alloc_field_value( sizeof( zval ));
+            php_stream_to_zval( stream, static_cast<zval*>( field_value ));
             break;
         }
 
@@ -1762,6 +2757,43 @@ bool check_for_next_stream_parameter( _Inout_ hdb_stmt* stmt )
 }
 
 
+// returns the ODBC C type used to retrieve a column as the PHP type given.  This follows the conversions done
+// by core_get_field_common: numbers are retrieved natively, dates as strings and strings and streams by encoding.
+// Strings are UTF-8 from SQL_C_CHAR when the connection asked the ODBC driver for it (CHAR_AS_UTF8).
+
+SQLSMALLINT column_c_type( _In_ hdb_phptype php_type, _In_ HDB_ENCODING encoding, _In_ bool char_as_utf8 )
+{
+    if( php_type.typeinfo.encoding != HDB_ENCODING_DEFAULT ) {
+        encoding = static_cast<HDB_ENCODING>( php_type.typeinfo.encoding );
+    }
+
+    switch( php_type.typeinfo.type ) {
+        case HDB_PHPTYPE_INT:
+            return SQL_C_LONG;
+        case HDB_PHPTYPE_FLOAT:
+            return SQL_C_DOUBLE;
+        case HDB_PHPTYPE_DATETIME:
+            return SQL_C_CHAR;
+        case HDB_PHPTYPE_STRING:
+            if( encoding == HDB_ENCODING_UTF8 && char_as_utf8 ) {
+                return SQL_C_CHAR;
+            }
+            // fall through
+        case HDB_PHPTYPE_STREAM:
+            switch( encoding ) {
+                case HDB_ENCODING_UTF8:
+                    return SQL_C_WCHAR;
+                case HDB_ENCODING_BINARY:
+                    return SQL_C_BINARY;
+                default:
+                    return SQL_C_CHAR;
+            }
+        default:
+            return SQL_C_DEFAULT;
+    }
+}
+
+
 // utility routine to convert an input parameter from UTF-8 to UTF-16
 
 bool convert_input_param_to_utf16( _In_ zval* input_param_z, _Inout_ zval* converted_param_z )
@@ -1786,35 +2818,27 @@ bool convert_input_param_to_utf16( _In_ zval* input_param_z, _Inout_ zval* conve
         return true;
     }
 
-    // if the parameter is an input parameter, calc the size of the necessary buffer from the length of the string
-#ifndef _WIN32
-    wchar_size = SystemLocale::ToUtf16Strict( CP_UTF8, reinterpret_cast<LPCSTR>( buffer ), static_cast<int>( buffer_len ), NULL, 0 );
-#else
-    wchar_size = MultiByteToWideChar( CP_UTF8, MB_ERR_INVALID_CHARS, reinterpret_cast<LPCSTR>( buffer ), static_cast<int>( buffer_len ), NULL, 0 );
-#endif // !_WIN32
-
-    // if there was a problem determining the size of the string, return false
-    if( wchar_size == 0 ) {
-        return false;
-    }
-    hdb_malloc_auto_ptr<SQLWCHAR> wbuffer;
-    wbuffer = reinterpret_cast<SQLWCHAR*>( hdb_malloc( (wchar_size + 1) * sizeof( SQLWCHAR ) ));
-    // convert the utf-8 string to a wchar string in the new buffer
+    // convert straight into the zend_string the parameter will hold.  No byte of UTF-8 becomes more than one UTF-16
+    // character, so it's allocated for that and shrunk afterwards rather than sized by a separate pass.
+    zend_string* wstr = zend_string_alloc( buffer_len * sizeof( SQLWCHAR ), 0 );
 #ifndef _WIN32
-    int r = SystemLocale::ToUtf16Strict( CP_UTF8, reinterpret_cast<LPCSTR>( buffer ), static_cast<int>( buffer_len ), wbuffer, wchar_size );
+    wchar_size = SystemLocale::ToUtf16Strict( CP_UTF8, reinterpret_cast<LPCSTR>( buffer ), static_cast<int>( buffer_len ),
+                                              reinterpret_cast<SQLWCHAR*>( ZSTR_VAL( wstr )), buffer_len );
 #else
-    int r = MultiByteToWideChar( CP_UTF8, MB_ERR_INVALID_CHARS, reinterpret_cast<LPCSTR>( buffer ), static_cast<int>( buffer_len ), wbuffer, wchar_size );
+    wchar_size = MultiByteToWideChar( CP_UTF8, MB_ERR_INVALID_CHARS, reinterpret_cast<LPCSTR>( buffer ), static_cast<int>( buffer_len ),
+                                      reinterpret_cast<SQLWCHAR*>( ZSTR_VAL( wstr )), static_cast<int>( buffer_len ));
 #endif // !_WIN32
     // if there was a problem converting the string, then free the memory and return false
-    if( r == 0 ) {
+    if( wchar_size == 0 ) {
+        zend_string_free( wstr );
         return false;
     }
 
-    // null terminate the string, set the size within the zval, and return success
-    wbuffer[ wchar_size ] = L'\0';
-    core::hdb_zval_stringl( converted_param_z, reinterpret_cast<char*>( wbuffer.get() ), wchar_size * sizeof( SQLWCHAR ) );
-    hdb_free(wbuffer);
-    wbuffer.transferred();
+    // the input string isn't needed anymore when it is also the destination
+    wstr = zend_string_truncate( wstr, wchar_size * sizeof( SQLWCHAR ), 0 );
+    ZSTR_VAL( wstr )[ ZSTR_LEN( wstr ) ] = '\0';
+    zval_ptr_dtor( converted_param_z );
+    ZVAL_NEW_STR( converted_param_z, wstr );
 
     return true;
 }
@@ -2022,12 +3046,6 @@ void default_sql_size_and_scale( _Inout_ hdb_stmt* stmt, _In_opt_ unsigned int p
     }
 }
 
-void col_cache_dtor( _Inout_ zval* data_z )
-{
-    col_cache* cache = static_cast<col_cache*>( Z_PTR_P( data_z ));
-    hdb_free( cache );
-}
-
 void field_cache_dtor( _Inout_ zval* data_z )
 {
     field_cache* cache = static_cast<field_cache*>( Z_PTR_P( data_z ));
@@ -2168,15 +3186,18 @@ void finalize_output_parameters( _Inout_ hdb_stmt* stmt )
     return;
 }
 
+// retrieve a field as a string.  The data is read straight into a zend_string (or converted straight into one
+// for UTF-8), which is returned in field_value so the driver can hand it to a zval without copying it.
+
 void get_field_as_string( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index, _Inout_ hdb_phptype hdb_php_type,
                           _Inout_updates_bytes_(*field_len) void*& field_value, _Inout_ SQLLEN* field_len )
 {
     SQLRETURN r;
     SQLSMALLINT c_type;
-    SQLLEN sql_field_type = 0;
     SQLSMALLINT extra = 0;
     SQLLEN field_len_temp = 0;
     SQLLEN sql_display_size = 0;
+    zend_string* field_str = NULL;
     char* field_value_temp = NULL;
     unsigned int intial_field_len = INITIAL_FIELD_STRING_LEN;
 
@@ -2189,9 +3210,17 @@ void get_field_as_string( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
             hdb_php_type.typeinfo.encoding = stmt->conn->encoding();
         }
 
-        // Set the C type and account for null characters at the end of the data.
+        // Set the C type and account for null characters at the end of the data.  When the ODBC driver returns
+        // UTF-8 itself (CHAR_AS_UTF8), UTF-8 is read as SQL_C_CHAR and only has to be validated.
+        bool utf8_as_char = false;
         switch( hdb_php_type.typeinfo.encoding ) {
         case CP_UTF8:
+            if( stmt->conn->char_as_utf8 ) {
+                utf8_as_char = true;
+                c_type = SQL_C_CHAR;
+                extra = sizeof( SQLCHAR );
+                break;
+            }
             c_type = SQL_C_WCHAR;
             extra = sizeof( SQLWCHAR );
             break;
@@ -2205,31 +3234,35 @@ void get_field_as_string( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
             break;
         }
 
-        col_cache* cached = NULL;
-        if ( NULL != ( cached = static_cast< col_cache* >( zend_hash_index_find_ptr( Z_ARRVAL( stmt->col_cache ), static_cast< zend_ulong >( field_index ))))) {
-            sql_field_type = cached->sql_type;
-            sql_display_size = cached->display_size;
-        }
-        else {
-            // Get the SQL type of the field. unixODBC 2.3.1 requires wide calls to support pooling
-            core::SQLColAttributeW( stmt, field_index + 1, SQL_DESC_CONCISE_TYPE, NULL, 0, NULL, &sql_field_type );
-
-            // Calculate the field size.
-            calc_string_size( stmt, field_index, sql_field_type, sql_display_size );
-
-            col_cache cache( sql_field_type, sql_display_size );
-            core::hdb_zend_hash_index_update_mem( *stmt, Z_ARRVAL( stmt->col_cache ), field_index, &cache, sizeof( col_cache ) );
-        }
+        // the field size comes from the column descriptor
+        sql_display_size = stmt->col_desc( field_index ).display_size;
 
         // if this is a large type, then read the first few bytes to get the actual length from SQLGetData
         if( sql_display_size == 0 || sql_display_size == INT_MAX ||
             sql_display_size == INT_MAX >> 1 || sql_display_size == UINT_MAX - 1 ) {
 
+            // UTF-16 is converted to UTF-8 a chunk at a time as it's read rather than once the whole field is read
+            if( c_type == SQL_C_WCHAR ) {
+
+                field_str = get_large_field_as_utf8( stmt, field_index );
+                field_value = field_str;
+                *field_len = field_str ? ZSTR_LEN( field_str ) : 0;
+                return;
+            }
+
+            // start with the longest value read from the column so far, so the first read is usually the whole field
+            hdb_column_desc& desc = stmt->col_desc( field_index );
+            if( desc.len_hint > static_cast<SQLLEN>( intial_field_len )) {
+                intial_field_len = static_cast<unsigned int>( desc.len_hint );
+            }
+
             field_len_temp = intial_field_len;
 
             SQLLEN initiallen = field_len_temp + extra;
 
-            field_value_temp = static_cast<char*>( hdb_malloc( field_len_temp + extra + 1 ));
+            // zend_string_alloc already leaves room for a null terminator
+            field_str = zend_string_alloc( field_len_temp + extra, 0 );
+            field_value_temp = ZSTR_VAL( field_str );
 
             r = stmt->current_results->get_data( field_index + 1, c_type, field_value_temp, ( field_len_temp + extra ),
                                                  &field_len_temp, false /*handle_warning*/ );
@@ -2240,7 +3273,7 @@ void get_field_as_string( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
 
             if( field_len_temp == SQL_NULL_DATA ) {
                 field_value = NULL;
-                hdb_free( field_value_temp );
+                zend_string_free( field_str );
                 return;
             }
 
@@ -2273,7 +3306,8 @@ void get_field_as_string( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
                             // Double the size.
                             field_len_temp *= 2;
 
-                            field_value_temp = static_cast<char*>( hdb_realloc( field_value_temp, field_len_temp + extra + 1 ));
+                            field_str = zend_string_extend( field_str, field_len_temp + extra, 0 );
+                            field_value_temp = ZSTR_VAL( field_str );
 
                             field_len_temp -= initial_field_len;
 
@@ -2297,7 +3331,8 @@ void get_field_as_string( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
                     else {
                         // the real field length is returned here, thus no need to double the allocation size here, just have to
                         // allocate field_len_temp (which is the field length retrieved from the first SQLGetData
-                        field_value_temp = static_cast<char*>( hdb_realloc( field_value_temp, field_len_temp + extra + 1 ));
+                        field_str = zend_string_extend( field_str, field_len_temp + extra, 0 );
+                        field_value_temp = ZSTR_VAL( field_str );
 
                         // We have already received intial_field_len size data.
                         field_len_temp -= intial_field_len;
@@ -2309,7 +3344,7 @@ void get_field_as_string( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
 
                         if( dummy_field_len == SQL_NULL_DATA ) {
                             field_value = NULL;
-                            hdb_free( field_value_temp );
+                            zend_string_free( field_str );
                             return;
                         }
 
@@ -2326,14 +3361,8 @@ void get_field_as_string( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
                 }
             }  // if( r == SQL_SUCCESS_WITH_INFO )
 
-            if( hdb_php_type.typeinfo.encoding == HDB_ENCODING_UTF8 ) {
-
-                bool converted = convert_string_from_utf16_inplace( static_cast<HDB_ENCODING>( hdb_php_type.typeinfo.encoding ),
-                                                                    &field_value_temp, field_len_temp );
-
-                CHECK_CUSTOM_ERROR( !converted, stmt, HDB_ERROR_FIELD_ENCODING_TRANSLATE, get_last_error_message()) {
-                    throw core::CoreException();
-                }
+            if( field_len_temp > desc.len_hint ) {
+                desc.len_hint = ( field_len_temp < FIELD_LEN_HINT_MAX ) ? field_len_temp : FIELD_LEN_HINT_MAX;
             }
         } // if ( sql_display_size == 0 || sql_display_size == LONG_MAX .. )
 
@@ -2344,6 +3373,10 @@ void get_field_as_string( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
 
             // null terminator
             if( c_type == SQL_C_CHAR ) {
+                // a character (or UTF-16 code unit of a wide column) is up to 3 bytes of UTF-8
+                if( utf8_as_char ) {
+                    sql_display_size *= 3;
+                }
                 sql_display_size += sizeof( SQLCHAR );
             }
 
@@ -2352,7 +3385,14 @@ void get_field_as_string( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
                 sql_display_size = (sql_display_size * sizeof(WCHAR)) + sizeof(WCHAR);
             }
 
-            field_value_temp = static_cast<char*>( hdb_malloc( sql_display_size + extra + 1 ));
+            // UTF-16 is only needed until it's converted below, so it's read into the fetch arena rather than a string
+            if( c_type == SQL_C_WCHAR ) {
+                field_value_temp = static_cast<char*>( stmt->fetch_arena.alloc( sql_display_size + extra ));
+            }
+            else {
+                field_str = zend_string_alloc( sql_display_size + extra, 0 );
+                field_value_temp = ZSTR_VAL( field_str );
+            }
 
             // get the data
             r = stmt->current_results->get_data( field_index + 1, c_type, field_value_temp, sql_display_size,
@@ -2366,18 +3406,10 @@ void get_field_as_string( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
 
             if( field_len_temp == SQL_NULL_DATA ) {
                 field_value = NULL;
-                hdb_free( field_value_temp );
-                return;
-            }
-
-            if( hdb_php_type.typeinfo.encoding == CP_UTF8 ) {
-
-                bool converted = convert_string_from_utf16_inplace( static_cast<HDB_ENCODING>( hdb_php_type.typeinfo.encoding ),
-                                                                    &field_value_temp, field_len_temp );
-
-                CHECK_CUSTOM_ERROR( !converted, stmt, HDB_ERROR_FIELD_ENCODING_TRANSLATE, get_last_error_message()) {
-                    throw core::CoreException();
+                if( field_str ) {
+                    zend_string_free( field_str );
                 }
+                return;
             }
         } // else if( sql_display_size >= 1 && sql_display_size <= SQL_SERVER_MAX_FIELD_SIZE )
 
@@ -2387,41 +3419,220 @@ void get_field_as_string( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index,
             return; // to eliminate a warning
         }
 
-field_value = field_value_temp;
-*field_len = field_len_temp;
+        // with unixODBC connection pooling sometimes field_len_temp can be SQL_NO_DATA.
+        // In that cause return an empty string.
+        if( field_len_temp < 0 ) {
+            field_len_temp = 0;
+        }
+        // never use more than what was read into the buffer
+        SQLLEN buffer_len = field_str ? static_cast<SQLLEN>( ZSTR_LEN( field_str )) : sql_display_size;
+        if( field_len_temp > buffer_len ) {
+            field_len_temp = buffer_len;
+        }
 
-        // prevent a warning in debug mode about strings not being NULL terminated.  Even though nulls are not necessary, the PHP
-        // runtime checks to see if a string is null terminated and issues a warning about it if running in debug mode.
-        // SQL_C_BINARY fields don't return a NULL terminator, so we allocate an extra byte on each field and use the ternary
-        // operator to set add 1 to fill the null terminator
+        if( hdb_php_type.typeinfo.encoding == CP_UTF8 && !utf8_as_char ) {
 
-        // with unixODBC connection pooling sometimes field_len_temp can be SQL_NO_DATA.
-        // In that cause do not set null terminator and set length to 0.
-        if ( field_len_temp > 0 )
-        {
-            field_value_temp[field_len_temp] = '\0';
+            // convert from the UTF-16 buffer straight into the string returned
+            zend_string* utf8_str = NULL;
+            bool converted = convert_zend_string_from_utf16( static_cast<HDB_ENCODING>( hdb_php_type.typeinfo.encoding ),
+                                                             reinterpret_cast<const SQLWCHAR*>( field_value_temp ),
+                                                             static_cast<SQLINTEGER>( field_len_temp / sizeof( SQLWCHAR )), &utf8_str );
+
+            CHECK_CUSTOM_ERROR( !converted, stmt, HDB_ERROR_FIELD_ENCODING_TRANSLATE, get_last_error_message()) {
+                throw core::CoreException();
+            }
+
+            if( field_str ) {
+                zend_string_free( field_str );
+            }
+            field_str = utf8_str;
         }
-        else
-        {
-            *field_len = 0;
+        else {
+
+            CHECK_CUSTOM_ERROR( utf8_as_char && !is_valid_utf8( ZSTR_VAL( field_str ), field_len_temp ), stmt,
+                                HDB_ERROR_FIELD_ENCODING_TRANSLATE, get_last_error_message( ERROR_NO_UNICODE_TRANSLATION )) {
+                throw core::CoreException();
+            }
+
+            // the data was read into the string returned, so only its length has to be set.  PHP in debug mode warns
+            // about strings not being NULL terminated, and SQL_C_BINARY fields don't return a NULL terminator.
+            field_str = zend_string_truncate( field_str, field_len_temp, 0 );
+            ZSTR_VAL( field_str )[ field_len_temp ] = '\0';
         }
+
+        field_value = field_str;
+        *field_len = ZSTR_LEN( field_str );
     }
 
     catch( core::CoreException& ) {
 
         field_value = NULL;
         *field_len = 0;
-        hdb_free( field_value_temp );
+        if( field_str ) {
+            zend_string_free( field_str );
+        }
         throw;
     }
     catch ( ... ) {
 
         field_value = NULL;
         *field_len = 0;
-        hdb_free( field_value_temp );
+        if( field_str ) {
+            zend_string_free( field_str );
+        }
+        throw;
+    }
+
+}
+
+
+// Reads a large UTF-16 field (NCLOB, long NVARCHAR) a chunk at a time and converts each chunk to UTF-8 as it arrives,
+// so the field is never held as UTF-16 in full and each code unit is converted once.  The only state kept between
+// chunks is a high surrogate cut off from its low surrogate at the end of a chunk, which is moved to the start of the
+// next one.  The UTF-8 string is sized from the length of the field and grows geometrically with zend_string_extend
+// if the field isn't all ASCII.  The first chunk is sized from the longest value read from the column so far.
+// Returns NULL if the field is null.
+
+zend_string* get_large_field_as_utf8( _Inout_ hdb_stmt* stmt, _In_ SQLUSMALLINT field_index )
+{
+    // the first chunk is no larger than the column's values have been, so short values in large columns don't need a
+    // large buffer.  The chunks are only needed until they are converted, so they come from the fetch arena.
+    hdb_column_desc& desc = stmt->col_desc( field_index );
+    SQLLEN chunk_len = desc.len_hint / static_cast<SQLLEN>( sizeof( SQLWCHAR ));
+    if( chunk_len < INITIAL_FIELD_STRING_LEN ) {
+        chunk_len = INITIAL_FIELD_STRING_LEN;
+    }
+    else if( chunk_len > UTF16_FIELD_CHUNK_LEN ) {
+        chunk_len = UTF16_FIELD_CHUNK_LEN;
+    }
+    SQLWCHAR* chunk = static_cast<SQLWCHAR*>( stmt->fetch_arena.alloc(( chunk_len + 2 ) * sizeof( SQLWCHAR )));
+    SQLLEN carried = 0;                 // 1 when chunk[0] holds a high surrogate left from the last chunk
+    zend_string* utf8_str = NULL;
+    size_t utf8_len = 0;
+    SQLLEN field_units = 0;             // code units read so far
+    bool more = true;
+
+    try {
+
+        while( more ) {
+
+            // room for chunk_len code units after the carried surrogate and a null terminator
+            SQLLEN buffer_len = ( chunk_len + 1 ) * sizeof( SQLWCHAR );
+            SQLLEN field_len = 0;
+            SQLRETURN r = stmt->current_results->get_data( field_index + 1, SQL_C_WCHAR, chunk + carried, buffer_len,
+                                                           &field_len, false /*handle_warning*/ );
+
+            CHECK_CUSTOM_ERROR(( r == SQL_NO_DATA ), stmt, HDB_ERROR_NO_DATA, field_index ) {
+                throw core::CoreException();
+            }
+
+            if( field_len == SQL_NULL_DATA ) {
+                return NULL;
+            }
+
+            more = false;
+            if( r == SQL_SUCCESS_WITH_INFO ) {
+
+                SQLCHAR state[SQL_SQLSTATE_BUFSIZE] = { 0 };
+                SQLSMALLINT len = 0;
+
+                stmt->current_results->get_diag_field( 1, SQL_DIAG_SQLSTATE, state, SQL_SQLSTATE_BUFSIZE, &len );
+
+                // with Linux connection pooling may not get a truncated warning back but the field length can still
+                // be greater than the buffer
+#ifndef _WIN32
+                more = is_truncated_warning( state ) || field_len == SQL_NO_TOTAL ||
+                       field_len > buffer_len - static_cast<SQLLEN>( sizeof( SQLWCHAR ));
+#else
+                more = is_truncated_warning( state );
+#endif // !_WIN32
+                if( !more ) {
+                    CHECK_SQL_ERROR_OR_WARNING( r, stmt ) {
+                        throw core::CoreException();
+                    }
+                }
+            }
+
+            // a truncated chunk fills the buffer.  with unixODBC connection pooling the length of the last chunk
+            // can be SQL_NO_DATA, which is treated as empty.
+            SQLLEN units = chunk_len;
+            if( !more ) {
+                units = ( field_len < 0 ) ? 0 : field_len / static_cast<SQLLEN>( sizeof( SQLWCHAR ));
+                if( units > chunk_len ) {
+                    units = chunk_len;
+                }
+            }
+            field_units += units;
+
+            // the first call gives the length of the whole field, so the string is sized for all of it as ASCII plus
+            // the worst case of a chunk that isn't
+            if( utf8_str == NULL ) {
+                size_t total = ( more && field_len != SQL_NO_TOTAL ) ? field_len / sizeof( SQLWCHAR ) : units;
+                size_t largest_chunk = ( total < static_cast<size_t>( UTF16_FIELD_CHUNK_LEN )) ? total : UTF16_FIELD_CHUNK_LEN;
+                utf8_str = zend_string_alloc( total + 2 * largest_chunk, 0 );
+            }
+
+            units += carried;
+            carried = 0;
+            // hold back a high surrogate whose low surrogate is in the next chunk
+            if( more && units > 0 && chunk[ units - 1 ] >= 0xd800 && chunk[ units - 1 ] < 0xdc00 ) {
+                carried = 1;
+                --units;
+            }
+
+            // a UTF-16 code unit never becomes more than 3 bytes of UTF-8
+            size_t needed = utf8_len + units * 3;
+            if( needed > ZSTR_LEN( utf8_str )) {
+                size_t doubled = ZSTR_LEN( utf8_str ) * 2;
+                utf8_str = zend_string_extend( utf8_str, ( needed > doubled ) ? needed : doubled, 0 );
+            }
+
+            if( units > 0 ) {
+
+                char* utf8_end = ZSTR_VAL( utf8_str ) + utf8_len;
+                size_t utf8_room = ZSTR_LEN( utf8_str ) - utf8_len;
+#ifndef _WIN32
+                size_t converted = SystemLocale::FromUtf16Strict( CP_UTF8, chunk, units, utf8_end, utf8_room );
+#else
+                DWORD flags = isVistaOrGreater ? WC_ERR_INVALID_CHARS : 0;
+                size_t converted = WideCharToMultiByte( CP_UTF8, flags, chunk, static_cast<int>( units ), utf8_end,
+                                                        static_cast<int>( utf8_room ), NULL, NULL );
+#endif // !_WIN32
+                CHECK_CUSTOM_ERROR( converted == 0, stmt, HDB_ERROR_FIELD_ENCODING_TRANSLATE, get_last_error_message()) {
+                    throw core::CoreException();
+                }
+                utf8_len += converted;
+            }
+
+            if( more ) {
+
+                SQLWCHAR high_surrogate = carried ? chunk[ units ] : 0;
+                // the rest of the field is read in larger chunks
+                if( chunk_len < UTF16_FIELD_CHUNK_LEN ) {
+                    chunk_len = UTF16_FIELD_CHUNK_LEN;
+                    chunk = static_cast<SQLWCHAR*>( stmt->fetch_arena.alloc(( chunk_len + 2 ) * sizeof( SQLWCHAR )));
+                }
+                chunk[0] = high_surrogate;
+            }
+        }
+
+        utf8_str = zend_string_truncate( utf8_str, utf8_len, 0 );
+        ZSTR_VAL( utf8_str )[ utf8_len ] = '\0';
+
+        SQLLEN field_bytes = field_units * static_cast<SQLLEN>( sizeof( SQLWCHAR ));
+        if( field_bytes > desc.len_hint ) {
+            desc.len_hint = ( field_bytes < FIELD_LEN_HINT_MAX ) ? field_bytes : FIELD_LEN_HINT_MAX;
+        }
+    }
+    catch( core::CoreException& ) {
+
+        if( utf8_str ) {
+            zend_string_free( utf8_str );
+        }
         throw;
     }
 
+    return utf8_str;
 }
 
 
@@ -2441,6 +3652,34 @@ stmt_option const* get_stmt_option( hdb_conn const* conn, _In_ zend_ulong key, _
     return NULL;    // no option found
 }
 
+// perform the actions of each statement option in options_ht on the statement
+
+void set_stmt_options( _Inout_ hdb_stmt* stmt, _In_opt_ HashTable* options_ht, _In_opt_ const stmt_option valid_stmt_opts[] )
+{
+    if( options_ht && zend_hash_num_elements( options_ht ) > 0 && valid_stmt_opts ) {
+        zend_ulong index = -1;
+        zend_string *key = NULL;
+        zval* value_z = NULL;
+
+        ZEND_HASH_FOREACH_KEY_VAL( options_ht, index, key, value_z ) {
+
+            int type = key ? HASH_KEY_IS_STRING : HASH_KEY_IS_LONG;
+
+            // The driver layer should ensure a valid key.
+            DEBUG_HDB_ASSERT(( type == HASH_KEY_IS_LONG ), "allocate_stmt: Invalid statment option key provided." );
+
+            const stmt_option* stmt_opt = get_stmt_option( stmt->conn, index, valid_stmt_opts );
+
+            // if the key didn't match, then return the error to the script.
+            // The driver layer should ensure that the key is valid.
+            DEBUG_HDB_ASSERT( stmt_opt != NULL, "allocate_stmt: unexpected null value for statement option." );
+
+            // perform the actions the statement option needs done.
+            (*stmt_opt->func)( stmt, stmt_opt, value_z );
+        } ZEND_HASH_FOREACH_END();
+    }
+}
+
 // is_fixed_size_type
 // returns true if the SQL data type is a fixed length, as opposed to a variable length data type such as varchar or varbinary
 
@@ -2750,6 +3989,256 @@ void hdb_output_param_dtor( _Inout_ zval* data )
 	hdb_free( output_param );
 }
 
+// put the statement back to binding a single set of parameters after core_hdb_execute_batch.  Errors are ignored
+// since this is also called while another error is being handled.
+void reset_batch_params( _Inout_ hdb_stmt* stmt )
+{
+    ::SQLSetStmtAttr( stmt->handle(), SQL_ATTR_PARAMSET_SIZE, reinterpret_cast<SQLPOINTER>( 1 ), SQL_IS_UINTEGER );
+    ::SQLSetStmtAttr( stmt->handle(), SQL_ATTR_PARAM_STATUS_PTR, NULL, SQL_IS_POINTER );
+    ::SQLSetStmtAttr( stmt->handle(), SQL_ATTR_PARAMS_PROCESSED_PTR, NULL, SQL_IS_POINTER );
+    ::SQLFreeStmt( stmt->handle(), SQL_RESET_PARAMS );
+}
+
+// finish an execution that returned r: send the stream parameters if they're sent at execute time, move to the first
+// result set and finalize the output parameters if there are no results to read first
+SQLRETURN complete_execute( _Inout_ hdb_stmt* stmt, _In_ SQLRETURN r )
+{
+    // if data is needed (streams were bound) and they should be sent at execute time, then do so now
+    if( r == SQL_NEED_DATA && stmt->send_streams_at_exec ) {
+
+        send_param_streams( stmt );
+    }
+
+    stmt->new_result_set( );
+    stmt->executed = true;
+
+    // if all the data has been sent and no data was returned then finalize the output parameters
+    if( stmt->send_streams_at_exec && ( r == SQL_NO_DATA || !core_hdb_has_any_result( stmt ))) {
+
+        finalize_output_parameters( stmt );
+    }
+    // stream parameters are sent, clean the Hashtable
+    if ( stmt->send_streams_at_exec ) {
+         zend_hash_clean( Z_ARRVAL( stmt->param_streams ));
+    }
+    return r;
+}
+
+// clean up after an execution that failed
+void abandon_execute( _Inout_ hdb_stmt* stmt )
+{
+    // if the statement executed but failed in a subsequent operation before returning,
+    // we need to cancel the statement and deref the output and stream parameters
+    if ( stmt->send_streams_at_exec ) {
+        finalize_output_parameters( stmt );
+        zend_hash_clean( Z_ARRVAL( stmt->param_streams ));
+    }
+    if( stmt->executed ) {
+        SQLCancel( stmt->handle() );
+        // stmt->executed = false; should this be reset if something fails?
+    }
+}
+
+// turn asynchronous execution back off once core_hdb_poll sees an execution complete, so that the statement's other
+// functions run synchronously.  The execution is over either way, but if the attribute can't be changed the error is
+// reported and async_enabled stays set.
+void end_async_execute( _Inout_ hdb_stmt* stmt )
+{
+    stmt->async_executing = false;
+
+    core::SQLSetStmtAttr( stmt, SQL_ATTR_ASYNC_ENABLE, reinterpret_cast<SQLPOINTER>( SQL_ASYNC_ENABLE_OFF ), SQL_IS_UINTEGER );
+    stmt->async_enabled = false;
+}
+
+// returns the entry of the statement cache holding a handle prepared with the key given, or NULL if there isn't one
+hdb_stmt_cache_entry* find_stmt_cache_entry( _In_ hdb_stmt_cache* cache, _In_ zend_string* key )
+{
+    zend_ulong hash = ZSTR_H( key );
+
+    for( zend_long i = 0; i < cache->count; ++i ) {
+
+        hdb_stmt_cache_entry* entry = &cache->entries[ i ];
+        if( ZSTR_H( entry->key ) == hash && zend_string_equals( entry->key, key )) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+// releases what a statement cache entry holds.  The entry itself stays in the cache's array.
+void free_stmt_cache_entry( _Inout_ hdb_stmt_cache_entry* entry )
+{
+    if( entry->handle != SQL_NULL_HANDLE ) {
+        ::SQLFreeHandle( SQL_HANDLE_STMT, entry->handle );
+        entry->handle = SQL_NULL_HANDLE;
+    }
+    if( entry->param_descriptions != NULL ) {
+        hdb_free( entry->param_descriptions );
+        entry->param_descriptions = NULL;
+    }
+    zend_string_release( entry->key );
+    entry->key = NULL;
+}
+
+// close a statement's cursor, unbind its columns and parameters, and keep its prepared handle in the
+// connection's statement cache, evicting the least recently used handle if the cache is full.  A handle
+// that can't be reset, or whose SQL text is already cached, is left to be freed with the statement.
+void return_stmt_to_cache( _Inout_ hdb_stmt* stmt )
+{
+    hdb_stmt_cache* cache = stmt->conn->stmt_cache;
+
+    if( !SQL_SUCCEEDED( ::SQLFreeStmt( stmt->handle(), SQL_CLOSE )) ||
+        !SQL_SUCCEEDED( ::SQLFreeStmt( stmt->handle(), SQL_UNBIND )) ||
+        !SQL_SUCCEEDED( ::SQLFreeStmt( stmt->handle(), SQL_RESET_PARAMS ))) {
+        return;
+    }
+
+    if( find_stmt_cache_entry( cache, stmt->cache_key ) != NULL ) {
+        return;
+    }
+
+    hdb_stmt_cache_entry* entry = NULL;
+
+    if( cache->count < cache->capacity ) {
+        entry = &cache->entries[ cache->count++ ];
+    }
+    else {
+        entry = &cache->entries[ 0 ];
+        for( zend_long i = 1; i < cache->count; ++i ) {
+            if( cache->entries[ i ].last_used < entry->last_used ) {
+                entry = &cache->entries[ i ];
+            }
+        }
+        free_stmt_cache_entry( entry );
+    }
+
+    entry->key = zend_string_copy( stmt->cache_key );
+    entry->param_count = stmt->param_descriptions.size();
+    entry->param_descriptions = NULL;
+    if( entry->param_count > 0 ) {
+        entry->param_descriptions = reinterpret_cast<param_meta_data*>( hdb_malloc( entry->param_count, sizeof( param_meta_data ), 0 ));
+        std::copy( stmt->param_descriptions.begin(), stmt->param_descriptions.end(), entry->param_descriptions );
+    }
+    entry->last_used = ++cache->clock;
+    entry->handle = stmt->detach_handle();
+}
+
+// builds the key a statement is cached with: the SQL text followed by the key and value of each statement option,
+// since the options are applied to the handle before it is prepared.  The hash of the key is computed here so
+// that lookups only compare the text of keys with the same hash.
+zend_string* stmt_cache_key( _In_reads_bytes_(sql_len) const char* sql, _In_ SQLLEN sql_len, _In_opt_ HashTable* options_ht )
+{
+    std::string key( sql, sql_len );
+
+    if( options_ht != NULL ) {
+
+        zend_ulong index = -1;
+        zval* value_z = NULL;
+
+        ZEND_HASH_FOREACH_NUM_KEY_VAL( options_ht, index, value_z ) {
+
+            zend_string* value = zval_get_string( value_z );
+            key += '\0';
+            key += std::to_string( index );
+            key += '=';
+            key.append( ZSTR_VAL( value ), ZSTR_LEN( value ));
+            zend_string_release( value );
+        } ZEND_HASH_FOREACH_END();
+    }
+
+    zend_string* key_str = zend_string_init( key.c_str(), key.length(), 0 );
+    zend_string_hash_val( key_str );
+    return key_str;
+}
+
+// returns the connection's statement pool, creating it the first time a statement is freed
+hdb_stmt_pool* stmt_pool( _Inout_ hdb_conn* conn )
+{
+    if( conn->stmt_pool == NULL ) {
+        conn->stmt_pool = static_cast<hdb_stmt_pool*>( hdb_malloc( sizeof( hdb_stmt_pool )));
+        conn->stmt_pool->handle_count = 0;
+        conn->stmt_pool->tables_count = 0;
+    }
+    return conn->stmt_pool;
+}
+
+// close a statement's cursor, unbind its columns and parameters, and keep its handle in the connection's statement
+// pool.  The handle is left to be freed with the statement if the pool is full or the handle can't be reset.  A
+// statement given a query timeout also changed the lock timeout of the session, so its handle isn't reused.
+void return_stmt_to_pool( _Inout_ hdb_stmt* stmt )
+{
+    hdb_stmt_pool* pool = stmt_pool( stmt->conn );
+
+    if( pool->handle_count == hdb_stmt_pool::CAPACITY || stmt->query_timeout != QUERY_TIMEOUT_INVALID ) {
+        return;
+    }
+
+    if( !SQL_SUCCEEDED( ::SQLFreeStmt( stmt->handle(), SQL_CLOSE )) ||
+        !SQL_SUCCEEDED( ::SQLFreeStmt( stmt->handle(), SQL_UNBIND )) ||
+        !SQL_SUCCEEDED( ::SQLFreeStmt( stmt->handle(), SQL_RESET_PARAMS ))) {
+        return;
+    }
+
+    if( stmt->cursor_type != SQL_CURSOR_FORWARD_ONLY &&
+        !SQL_SUCCEEDED( ::SQLSetStmtAttr( stmt->handle(), SQL_ATTR_CURSOR_TYPE, reinterpret_cast<SQLPOINTER>( SQL_CURSOR_FORWARD_ONLY ),
+                                          SQL_IS_UINTEGER ))) {
+        return;
+    }
+
+    pool->handles[ pool->handle_count++ ] = stmt->detach_handle();
+}
+
+// gives a new statement the tables of a statement freed earlier on its connection.  Returns false if there are none.
+bool take_pooled_tables( _Inout_ hdb_stmt* stmt )
+{
+    hdb_stmt_pool* pool = ( stmt->conn != NULL ) ? stmt->conn->stmt_pool : NULL;
+
+    if( pool == NULL || pool->tables_count == 0 ) {
+        return false;
+    }
+
+    hdb_stmt_pool::tables& t = pool->spare_tables[ --pool->tables_count ];
+    ZVAL_ARR( &stmt->param_input_strings, t.param_input_strings );
+    ZVAL_ARR( &stmt->output_params, t.output_params );
+    ZVAL_ARR( &stmt->param_streams, t.param_streams );
+    ZVAL_ARR( &stmt->param_datetime_buffers, t.param_datetime_buffers );
+    ZVAL_ARR( &stmt->field_cache, t.field_cache );
+    return true;
+}
+
+// empties the tables of a statement being destroyed and keeps them in its connection's statement pool.  Returns
+// false, leaving them to be destroyed, if the pool is full or something else still holds one of them.
+bool return_tables_to_pool( _Inout_ hdb_stmt* stmt )
+{
+    zval* members[] = { &stmt->param_input_strings, &stmt->output_params, &stmt->param_streams,
+                        &stmt->param_datetime_buffers, &stmt->field_cache };
+
+    for( size_t i = 0; i < sizeof( members ) / sizeof( members[0] ); ++i ) {
+        if( Z_TYPE_P( members[i] ) != IS_ARRAY || GC_REFCOUNT( Z_ARR_P( members[i] )) != 1 ) {
+            return false;
+        }
+    }
+
+    hdb_stmt_pool* pool = stmt_pool( stmt->conn );
+
+    if( pool->tables_count == hdb_stmt_pool::CAPACITY ) {
+        return false;
+    }
+
+    for( size_t i = 0; i < sizeof( members ) / sizeof( members[0] ); ++i ) {
+        zend_hash_clean( Z_ARR_P( members[i] ));
+    }
+
+    hdb_stmt_pool::tables& t = pool->spare_tables[ pool->tables_count++ ];
+    t.param_input_strings = Z_ARR( stmt->param_input_strings );
+    t.output_params = Z_ARR( stmt->output_params );
+    t.param_streams = Z_ARR( stmt->param_streams );
+    t.param_datetime_buffers = Z_ARR( stmt->param_datetime_buffers );
+    t.field_cache = Z_ARR( stmt->field_cache );
+    return true;
+}
+
 // called by Zend for each stream in the hdb_stmt::param_streams hash table when it is cleaned/destroyed
 void hdb_stream_dtor( _Inout_ zval* data )
 {
@@ -30,307 +30,197 @@ int hdb_stream_close( _Inout_ php_stream* stream, int /*close_handle*/ )
 
 // read from a hdb stream into the buffer provided by Zend.  The parameters for binary vs. char are
 // set when hdb_get_field is called by the user specifying which field type they want.
-#ifdef PHP_SIZE_T
-    size_t hdb_stream_read( _Inout_ php_stream* stream, _Out_writes_bytes_(count) char* buf, _Inout_ size_t count )
-    {
-    	SQLLEN read = 0;
-        SQLSMALLINT c_type = SQL_C_CHAR;
-        char* get_data_buffer = buf;
-        hdb_malloc_auto_ptr<char> temp_buf;
-
-        hdb_stream* ss = static_cast<hdb_stream*>( stream->abstract );
-        HDB_ASSERT( ss != NULL && ss->stmt != NULL, "hdb_stream_read: hdb_stream* ss is NULL." );
-
-        try {
-
-            if( stream->eof ) {
-                return 0;
-            };
-
-            switch( ss->encoding ) {
-                case HDB_ENCODING_CHAR:
-                    c_type = SQL_C_CHAR;
-                    break;
-
-                case HDB_ENCODING_BINARY:
-                    c_type = SQL_C_BINARY;
-                    break;
-
-                case CP_UTF8:
-                {
-                    c_type = SQL_C_WCHAR;
-                    count /= 2;    // divide the number of bytes we read by 2 since converting to UTF-8 can cause an increase in bytes
-                    if( count > PHP_STREAM_BUFFER_SIZE ) {
-                        count = PHP_STREAM_BUFFER_SIZE;
-                    }
-
-                    // use a temporary buffer to retrieve from SQLGetData since we need to translate it to UTF-8 from UTF-16
-                    temp_buf = static_cast<char*>( hdb_malloc( PHP_STREAM_BUFFER_SIZE ));
-                    memset(temp_buf, 0, PHP_STREAM_BUFFER_SIZE);
-                    get_data_buffer = temp_buf;
-                    break;
-                }
-
-                default:
-                    DIE( "Unknown encoding type when reading from a stream" );
-                    break;
-            }
+size_t read_field( _Inout_ php_stream* stream, _Out_writes_bytes_(count) char* buf, _In_ size_t count )
+{
+    SQLLEN read = 0;
+    SQLSMALLINT c_type = SQL_C_CHAR;
+    char* get_data_buffer = buf;
+    size_t buffer_len = count;
+    size_t kept_len = 0;            // bytes of UTF-16 held back by the last read, placed before get_data_buffer
 
-            SQLRETURN r = SQLGetData( ss->stmt->handle(), ss->field_index + 1, c_type, get_data_buffer, count /*BufferLength*/, &read );
+    hdb_stream* ss = static_cast<hdb_stream*>( stream->abstract );
+    HDB_ASSERT( ss != NULL && ss->stmt != NULL, "hdb_stream_read: hdb_stream* ss is NULL." );
 
-            CHECK_SQL_ERROR( r, ss->stmt ) {
-                stream->eof = 1; 
-                throw core::CoreException();
-            }
+    try {
 
-            // if the stream returns either no data, NULL data, or returns data < than the count requested then
-            // we are at the "end of the stream" so we mark it
-            if( r == SQL_NO_DATA || read == SQL_NULL_DATA || ( static_cast<size_t>( read ) <= count && read != SQL_NO_TOTAL )) {
-                stream->eof = 1;
+        if( stream->eof ) {
+            return 0;
+        };
+
+        switch( ss->encoding ) {
+            case HDB_ENCODING_CHAR:
+                c_type = SQL_C_CHAR;
+                break;
+
+            case HDB_ENCODING_BINARY:
+                c_type = SQL_C_BINARY;
+                break;
+
+            case CP_UTF8:
+            {
+                c_type = SQL_C_WCHAR;
+
+                // the UTF-16 data is read into the end of Zend's buffer and converted to UTF-8 at its start.  Each
+                // UTF-16 character becomes at most 3 bytes, so reading no more than a third of the buffer's size in
+                // characters keeps the UTF-8 written behind the UTF-16 still to be converted.
+                size_t wide_count = ( count - 1 ) / 3;
+                size_t offset = count - wide_count * sizeof( SQLWCHAR );
+                offset -= reinterpret_cast<uintptr_t>( buf + offset ) % sizeof( SQLWCHAR );
+
+                get_data_buffer = buf + offset;
+                buffer_len = wide_count * sizeof( SQLWCHAR );
+
+                // the first half of a surrogate pair held back by the last read goes first, to be converted with
+                // its second half
+                if( ss->split_surrogate != 0 ) {
+                    HDB_ASSERT( buffer_len > 2 * sizeof( SQLWCHAR ), "read_field: buffer too small to hold a surrogate pair." );
+                    *reinterpret_cast<SQLWCHAR*>( get_data_buffer ) = ss->split_surrogate;
+                    kept_len = sizeof( SQLWCHAR );
+                    get_data_buffer += kept_len;
+                    buffer_len -= kept_len;
+                }
+                break;
             }
 
-            // if ODBC returns the 01004 (truncated string) warning, then we return the count minus the null terminator
-            // if it's not a binary encoded field
-            if( r == SQL_SUCCESS_WITH_INFO ) {
+            default:
+                DIE( "Unknown encoding type when reading from a stream" );
+                break;
+        }
 
-                SQLCHAR state[SQL_SQLSTATE_BUFSIZE] = { 0 };
-                SQLSMALLINT len = 0;
+        // read through the result set, since the field may have been fetched as part of a block of bound rows
+        SQLRETURN r = ss->stmt->current_results->get_data( ss->field_index + 1, c_type, get_data_buffer, buffer_len /*BufferLength*/,
+                                                           &read, false /*handle_warning*/ );
 
-                ss->stmt->current_results->get_diag_field( 1, SQL_DIAG_SQLSTATE, state, SQL_SQLSTATE_BUFSIZE, &len );
+        CHECK_SQL_ERROR( r, ss->stmt ) {
+            stream->eof = 1; 
+            throw core::CoreException();
+        }
 
-                if( read == SQL_NO_TOTAL ) {
-                    HDB_ASSERT( is_truncated_warning( state ), "hdb_stream_read: truncation warning was expected but it "
-                                   "did not occur." );
-                }
-                
-            // with unixODBC connection pooling enabled the truncated state may not be returned so check the actual length read
-            // with buffer length.
-            #ifndef _WIN32
-                if( is_truncated_warning( state ) || count < read) {
-            #else
-                if( is_truncated_warning( state ) ) {
-            #endif // !_WIN32 
-                    switch( c_type ) {
-                        
-                        // As per SQLGetData documentation, if the length of character data exceeds the BufferLength, 
-                        // SQLGetData truncates the data to BufferLength less the length of null-termination character.
-                        case SQL_C_BINARY:
-                            read = count;
-                            break;
-                        case SQL_C_WCHAR:
-                            read = ( count % 2 == 0 ? count - 2 : count - 3 );                       
-                            break;
-                        case SQL_C_CHAR:
-                            read  = count - 1;
-                            break;
-                        default:
-                            DIE( "hdb_stream_read: should have never reached in this switch case.");
-                            break;
-                    }
-                }
-                else {
-                    CHECK_SQL_WARNING( r, ss->stmt );
-                }
-            }
+        // if the stream returns either no data, NULL data, or returns data < than the count requested then
+        // we are at the "end of the stream" so we mark it
+        if( r == SQL_NO_DATA || read == SQL_NULL_DATA || ( static_cast<size_t>( read ) <= buffer_len && read != SQL_NO_TOTAL )) {
+            stream->eof = 1;
+        }
 
-            // if the encoding is UTF-8
-            if( c_type == SQL_C_WCHAR ) {
-                count *= 2;          
-                // undo the shift to use the full buffer
-                // flags set to 0 by default, which means that any invalid characters are dropped rather than causing
-                // an error.  This happens only on XP.
-                // convert to UTF-8
-            #ifdef _WIN32
-                DWORD flags = 0;
-                if( isVistaOrGreater ) {
-                    // Vista (and later) will detect invalid UTF-16 characters and raise an error.
-                    flags = WC_ERR_INVALID_CHARS;
-                }
-            #endif // _WIN32
-               if( count > INT_MAX || (read >> 1) > INT_MAX ) {
-                   LOG(SEV_ERROR, "UTF-16 (wide character) string mapping: buffer length exceeded.");
-                   throw core::CoreException();
-               }
-
-            #ifndef _WIN32
-                int enc_len = SystemLocale::FromUtf16( ss->encoding, reinterpret_cast<LPCWSTR>( temp_buf.get() ),
-                                                       static_cast<int>(read >> 1), buf, static_cast<int>(count), NULL, NULL );
-            #else
-                int enc_len = WideCharToMultiByte( ss->encoding, flags, reinterpret_cast<LPCWSTR>( temp_buf.get() ),
-                                                   static_cast<int>(read >> 1), buf, static_cast<int>(count), NULL, NULL );
-            #endif // !_WIN32
-                if( enc_len == 0 ) {
-                
-                    stream->eof = 1;
-                    THROW_CORE_ERROR( ss->stmt, HDB_ERROR_FIELD_ENCODING_TRANSLATE, get_last_error_message() );
-                }
+        // if ODBC returns the 01004 (truncated string) warning, then we return the count minus the null terminator
+        // if it's not a binary encoded field
+        if( r == SQL_SUCCESS_WITH_INFO ) {
 
-                read = enc_len;
-            }
+            SQLCHAR state[SQL_SQLSTATE_BUFSIZE] = { 0 };
+            SQLSMALLINT len = 0;
 
-            return static_cast<size_t>( read );
-        } 
+            ss->stmt->current_results->get_diag_field( 1, SQL_DIAG_SQLSTATE, state, SQL_SQLSTATE_BUFSIZE, &len );
 
-        catch( core::CoreException& ) {
+            if( read == SQL_NO_TOTAL ) {
+                HDB_ASSERT( is_truncated_warning( state ), "hdb_stream_read: truncation warning was expected but it "
+                               "did not occur." );
+            }
             
-            return 0;
-        }
-        catch( ... ) {
-
-            LOG( SEV_ERROR, "hdb_stream_read: Unknown exception caught." );
-            return 0;
-        }
-    }
-#else
-    ssize_t hdb_stream_read( _Inout_ php_stream* stream, _Out_writes_bytes_(count) char* buf, _Inout_ size_t count )
-    {
-        SQLLEN read = 0;
-        SQLSMALLINT c_type = SQL_C_CHAR;
-        char* get_data_buffer = buf;
-        hdb_malloc_auto_ptr<char> temp_buf;
-
-        hdb_stream* ss = static_cast<hdb_stream*>( stream->abstract );
-        HDB_ASSERT( ss != NULL && ss->stmt != NULL, "hdb_stream_read: hdb_stream* ss is NULL." );
-
-        try {
-
-            if( stream->eof ) {
-                return 0;
-            };
-
-            switch( ss->encoding ) {
-                case HDB_ENCODING_CHAR:
-                    c_type = SQL_C_CHAR;
-                    break;
-
-                case HDB_ENCODING_BINARY:
-                    c_type = SQL_C_BINARY;
-                    break;
-
-                case CP_UTF8:
-                {
-                    c_type = SQL_C_WCHAR;
-                    count /= 2;    // divide the number of bytes we read by 2 since converting to UTF-8 can cause an increase in bytes
-                    if( count > PHP_STREAM_BUFFER_SIZE ) {
-                        count = PHP_STREAM_BUFFER_SIZE;
-                    }
-
-                    // use a temporary buffer to retrieve from SQLGetData since we need to translate it to UTF-8 from UTF-16
-                    temp_buf = static_cast<char*>( hdb_malloc( PHP_STREAM_BUFFER_SIZE ));
-                    memset(temp_buf, 0, PHP_STREAM_BUFFER_SIZE);
-                    get_data_buffer = temp_buf;
-                    break;
+        // with unixODBC connection pooling enabled the truncated state may not be returned so check the actual length read
+        // with buffer length.
+        #ifndef _WIN32
+            if( is_truncated_warning( state ) || buffer_len < static_cast<size_t>( read )) {
+        #else
+            if( is_truncated_warning( state ) ) {
+        #endif // !_WIN32 
+                switch( c_type ) {
+                    
+                    // As per SQLGetData documentation, if the length of character data exceeds the BufferLength, 
+                    // SQLGetData truncates the data to BufferLength less the length of null-termination character.
+                    case SQL_C_BINARY:
+                        read = buffer_len;
+                        break;
+                    case SQL_C_WCHAR:
+                        read = ( buffer_len % 2 == 0 ? buffer_len - 2 : buffer_len - 3 );
+                        break;
+                    case SQL_C_CHAR:
+                        read  = buffer_len - 1;
+                        break;
+                    default:
+                        DIE( "hdb_stream_read: should have never reached in this switch case.");
+                        break;
                 }
-
-                default:
-                    DIE( "Unknown encoding type when reading from a stream" );
-                    break;
             }
-
-            SQLRETURN r = SQLGetData( ss->stmt->handle(), ss->field_index + 1, c_type, get_data_buffer, count /*BufferLength*/, &read );
-
-            CHECK_SQL_ERROR( r, ss->stmt ) {
-                stream->eof = 1; 
-                throw core::CoreException();
+            else {
+                CHECK_SQL_WARNING( r, ss->stmt );
             }
+        }
 
-            // if the stream returns either no data, NULL data, or returns data < than the count requested then
-            // we are at the "end of the stream" so we mark it
-            if( r == SQL_NO_DATA || read == SQL_NULL_DATA || ( static_cast<size_t>( read ) <= count && read != SQL_NO_TOTAL )) {
-                stream->eof = 1;
+        // if the encoding is UTF-8
+        if( c_type == SQL_C_WCHAR ) {
+            // flags set to 0 by default, which means that any invalid characters are dropped rather than causing
+            // an error.  This happens only on XP.
+            // convert to UTF-8
+        #ifdef _WIN32
+            DWORD flags = 0;
+            if( isVistaOrGreater ) {
+                // Vista (and later) will detect invalid UTF-16 characters and raise an error.
+                flags = WC_ERR_INVALID_CHARS;
             }
-
-            // if ODBC returns the 01004 (truncated string) warning, then we return the count minus the null terminator
-            // if it's not a binary encoded field
-            if( r == SQL_SUCCESS_WITH_INFO ) {
-
-                SQLCHAR state[SQL_SQLSTATE_BUFSIZE] = { 0 };
-                SQLSMALLINT len = 0;
-
-                ss->stmt->current_results->get_diag_field( 1, SQL_DIAG_SQLSTATE, state, SQL_SQLSTATE_BUFSIZE, &len );
-
-                if( read == SQL_NO_TOTAL ) {
-                    HDB_ASSERT( is_truncated_warning( state ), "hdb_stream_read: truncation warning was expected but it "
-                                   "did not occur." );
-                }
-                
-            // with unixODBC connection pooling enabled the truncated state may not be returned so check the actual length read
-            // with buffer length.
-            #ifndef _WIN32
-                if( is_truncated_warning( state ) || count < read) {
-            #else
-                if( is_truncated_warning( state ) ) {
-            #endif // !_WIN32 
-                    switch( c_type ) {
-                        
-                        // As per SQLGetData documentation, if the length of character data exceeds the BufferLength, 
-                        // SQLGetData truncates the data to BufferLength less the length of null-termination character.
-                        case SQL_C_BINARY:
-                            read = count;
-                            break;
-                        case SQL_C_WCHAR:
-                            read = ( count % 2 == 0 ? count - 2 : count - 3 );                       
-                            break;
-                        case SQL_C_CHAR:
-                            read  = count - 1;
-                            break;
-                        default:
-                            DIE( "hdb_stream_read: should have never reached in this switch case.");
-                            break;
-                    }
-                }
-                else {
-                    CHECK_SQL_WARNING( r, ss->stmt );
-                }
+        #endif // _WIN32
+           if( count > INT_MAX || (read >> 1) > INT_MAX ) {
+               LOG(SEV_ERROR, "UTF-16 (wide character) string mapping: buffer length exceeded.");
+               throw core::CoreException();
+           }
+
+            SQLWCHAR* wide = reinterpret_cast<SQLWCHAR*>( get_data_buffer - kept_len );
+            SQLLEN wide_len = ( static_cast<SQLLEN>( kept_len ) + (( read > 0 ) ? read : 0 )) / static_cast<SQLLEN>( sizeof( SQLWCHAR ));
+
+            // a read that ends with the first half of a surrogate pair holds it back for the next read, since
+            // converting it without its second half would fail
+            ss->split_surrogate = 0;
+            if( !stream->eof && wide_len > 0 && ( wide[ wide_len - 1 ] & 0xFC00 ) == 0xD800 ) {
+                ss->split_surrogate = wide[ --wide_len ];
             }
 
-            // if the encoding is UTF-8
-            if( c_type == SQL_C_WCHAR ) {
-                count *= 2;          
-                // undo the shift to use the full buffer
-                // flags set to 0 by default, which means that any invalid characters are dropped rather than causing
-                // an error.  This happens only on XP.
-                // convert to UTF-8
-            #ifdef _WIN32
-                DWORD flags = 0;
-                if( isVistaOrGreater ) {
-                    // Vista (and later) will detect invalid UTF-16 characters and raise an error.
-                    flags = WC_ERR_INVALID_CHARS;
-                }
-            #endif // _WIN32
-               if( count > INT_MAX || (read >> 1) > INT_MAX ) {
-                   LOG(SEV_ERROR, "UTF-16 (wide character) string mapping: buffer length exceeded.");
-                   throw core::CoreException();
-               }
-
-            #ifndef _WIN32
-                int enc_len = SystemLocale::FromUtf16( ss->encoding, reinterpret_cast<LPCWSTR>( temp_buf.get() ),
-                                                       static_cast<int>(read >> 1), buf, static_cast<int>(count), NULL, NULL );
-            #else
-                int enc_len = WideCharToMultiByte( ss->encoding, flags, reinterpret_cast<LPCWSTR>( temp_buf.get() ),
-                                                   static_cast<int>(read >> 1), buf, static_cast<int>(count), NULL, NULL );
-            #endif // !_WIN32
+            int enc_len = 0;
+            if( wide_len > 0 ) {
+        #ifndef _WIN32
+                enc_len = SystemLocale::FromUtf16( ss->encoding, reinterpret_cast<LPCWSTR>( wide ),
+                                                   static_cast<int>( wide_len ), buf, static_cast<int>(count), NULL, NULL );
+        #else
+                enc_len = WideCharToMultiByte( ss->encoding, flags, reinterpret_cast<LPCWSTR>( wide ),
+                                               static_cast<int>( wide_len ), buf, static_cast<int>(count), NULL, NULL );
+        #endif // !_WIN32
                 if( enc_len == 0 ) {
                 
                     stream->eof = 1;
                     THROW_CORE_ERROR( ss->stmt, HDB_ERROR_FIELD_ENCODING_TRANSLATE, get_last_error_message() );
                 }
-
-                read = enc_len;
             }
 
-            return static_cast<size_t>( read );
-        } 
-
-        catch( core::CoreException& ) {
-            
-            return 0;
+            read = enc_len;
         }
-        catch( ... ) {
 
-            LOG( SEV_ERROR, "hdb_stream_read: Unknown exception caught." );
-            return 0;
+        // a read that filled the buffer means more data is likely to follow, so ask Zend for larger reads next time,
+        // up to the chunk size given in the stream context
+        if( !stream->eof && stream->chunk_size < ss->max_chunk_size ) {
+            php_stream_set_chunk_size( stream, std::min( stream->chunk_size * 2, ss->max_chunk_size ));
         }
+
+        return static_cast<size_t>( read );
+    } 
+
+    catch( core::CoreException& ) {
+        
+        return 0;
+    }
+    catch( ... ) {
+
+        LOG( SEV_ERROR, "hdb_stream_read: Unknown exception caught." );
+        return 0;
+    }
+}
+
+#ifdef PHP_SIZE_T
+    size_t hdb_stream_read( _Inout_ php_stream* stream, _Out_writes_bytes_(count) char* buf, _Inout_ size_t count )
+    {
+        return read_field( stream, buf, count );
+    }
+#else
+    ssize_t hdb_stream_read( _Inout_ php_stream* stream, _Out_writes_bytes_(count) char* buf, _Inout_ size_t count )
+    {
+        return static_cast<ssize_t>( read_field( stream, buf, count ));
     }
 #endif
 
@@ -352,7 +242,7 @@ php_stream_ops hdb_stream_ops = {
 // return value.  There is only one valid way to open a stream, using hdb_get_field on
 // certain field types.  A hdb stream may only be opened in read mode.
 static php_stream* hdb_stream_opener( _In_opt_ php_stream_wrapper* wrapper, _In_ const char*, _In_ const char* mode, 
-                                         _In_opt_ int options, _In_ zend_string **, php_stream_context* STREAMS_DC )
+                                         _In_opt_ int options, _In_ zend_string **, _In_opt_ php_stream_context* context STREAMS_DC )
 {
 
 #if ZEND_DEBUG
@@ -368,6 +258,9 @@ static php_stream* hdb_stream_opener( _In_opt_ php_stream_wrapper* wrapper, _In_
     ss = static_cast<hdb_stream*>( hdb_malloc( sizeof( hdb_stream )));
     memset( ss, 0, sizeof( hdb_stream ));
 
+    // the largest read made from the field, which reads grow to while the field has more data
+    ss->max_chunk_size = core_hdb_stream_max_chunk_size( context );
+
     // check for valid options
     if( options != REPORT_ERRORS ) { 
         php_stream_wrapper_log_error( wrapper, options , "Invalid option: no options except REPORT_ERRORS may be specified with a hdb stream" );
@@ -401,6 +294,24 @@ php_stream_wrapper_ops hdb_stream_wrapper_ops = {
 
 }
 
+// core_hdb_stream_max_chunk_size
+// Returns the largest read from a field given by the hdb chunk_size option of a stream context.
+// Parameters:
+// context - stream context, which may be NULL
+// Return:
+// The chunk size in bytes, 0 if the option isn't positive, or HDB_STREAM_MAX_CHUNK_SIZE_DEFAULT if it isn't given.
+
+size_t core_hdb_stream_max_chunk_size( _In_opt_ php_stream_context* context )
+{
+    zval* chunk_size_z = ( context != NULL ) ? php_stream_context_get_option( context, HDB_STREAM_WRAPPER, HDB_STREAM_CONTEXT_CHUNK_SIZE ) : NULL;
+    if( chunk_size_z == NULL ) {
+        return HDB_STREAM_MAX_CHUNK_SIZE_DEFAULT;
+    }
+
+    zend_long chunk_size = zval_get_long( chunk_size_z );
+    return ( chunk_size > 0 ) ? static_cast<size_t>( chunk_size ) : 0;
+}
+
 // structure used by PHP to get the function table for opening, closing, etc. of the stream
 php_stream_wrapper g_hdb_stream_wrapper = {
     &hdb_stream_wrapper_ops,
@@ -51,6 +51,91 @@ void core_hdb_register_logger( _In_ log_callback driver_logger )
 }
 
 
+// hdb_arena::alloc
+// carves the memory out of the current block, and only goes to hdb_malloc when it doesn't fit.  A request larger
+// than a block gets a block of its own that is put behind the current one, so the current one keeps serving the
+// small requests.
+
+void* hdb_arena::alloc( _In_ size_t size )
+{
+    // round up so the next allocation is aligned as well
+    size_t aligned = ( size + ALIGNMENT - 1 ) & ~( ALIGNMENT - 1 );
+    if( aligned < size ) {
+        DIE( "Integer overflow in hdb_arena::alloc" );
+    }
+    if( aligned == 0 ) {
+        aligned = ALIGNMENT;
+    }
+
+    if( head_ != NULL && aligned <= head_->size - used_ ) {
+        void* ptr = reinterpret_cast<char*>( head_ ) + sizeof( block ) + used_;
+        used_ += aligned;
+        return ptr;
+    }
+
+    if( aligned > BLOCK_SIZE ) {
+        block* b = new_block( aligned );
+        if( head_ != NULL ) {
+            b->next = head_->next;
+            head_->next = b;
+        }
+        else {
+            b->next = NULL;
+            head_ = b;
+            used_ = aligned;
+        }
+        return reinterpret_cast<char*>( b ) + sizeof( block );
+    }
+
+    block* b = new_block( BLOCK_SIZE );
+    b->next = head_;
+    head_ = b;
+    used_ = aligned;
+    return reinterpret_cast<char*>( b ) + sizeof( block );
+}
+
+// hdb_arena::reset
+// frees the blocks except for one of the standard size, which is kept for the next round of allocations
+
+void hdb_arena::reset( void )
+{
+    block* keep = NULL;
+    block* b = head_;
+    while( b != NULL ) {
+        block* next = b->next;
+        if( keep == NULL && b->size == BLOCK_SIZE ) {
+            keep = b;
+            keep->next = NULL;
+        }
+        else {
+            hdb_free( b );
+        }
+        b = next;
+    }
+    head_ = keep;
+    used_ = 0;
+}
+
+void hdb_arena::release( void )
+{
+    reset();
+    if( head_ != NULL ) {
+        hdb_free( head_ );
+        head_ = NULL;
+    }
+}
+
+hdb_arena::block* hdb_arena::new_block( _In_ size_t size )
+{
+    static_assert( sizeof( block ) % ALIGNMENT == 0, "hdb_arena block header breaks the alignment of allocations" );
+
+    block* b = static_cast<block*>( hdb_malloc( size, sizeof( char ), sizeof( block )));
+    b->next = NULL;
+    b->size = size;
+    return b;
+}
+
+
 // convert a string from utf-16 to the encoding and return the new string in the pointer parameter and new
 // length in the len parameter.  If no errors occurred during convertion, true is returned and the original
 // utf-16 string is released by this function if no errors occurred.  Otherwise the parameters are not changed
@@ -167,6 +252,73 @@ bool convert_string_from_utf16( _In_ HDB_ENCODING encoding, _In_reads_bytes_(cch
     return true;
 }
 
+// convert a string from utf-16 directly into a new zend_string, so the result can be handed to a zval without
+// being copied again.  The converter measures the result first, so the zend_string is allocated at exactly the
+// converted length.  Returns false and leaves outString NULL if the string couldn't be converted.
+
+bool convert_zend_string_from_utf16( _In_ HDB_ENCODING encoding, _In_reads_(cchInLen) const SQLWCHAR* inString, _In_ SQLINTEGER cchInLen, _Out_ zend_string** outString )
+{
+    HDB_ASSERT( inString != NULL, "Input string must be specified" );
+    HDB_ASSERT( outString != NULL, "Output string pointer must be specified" );
+
+    *outString = NULL;
+
+    if( cchInLen == 0 ) {
+        *outString = ZSTR_EMPTY_ALLOC();
+        return true;
+    }
+
+    // the length of the converted string is calculated first, so the string returned is allocated once at its final
+    // size rather than for the longest possible conversion and then shrunk
+#ifndef _WIN32
+    size_t cchOutLen = SystemLocale::FromUtf16Strict( encoding, inString, cchInLen, NULL, 0 );
+#else
+    DWORD flags = ( encoding == CP_UTF8 && isVistaOrGreater ) ? WC_ERR_INVALID_CHARS : 0;
+    size_t cchOutLen = WideCharToMultiByte( encoding, flags, inString, cchInLen, NULL, 0, NULL, NULL );
+#endif // !_WIN32
+    if( cchOutLen == 0 ) {
+        return false;
+    }
+
+    zend_string* newString = zend_string_alloc( cchOutLen, 0 );
+
+#ifndef _WIN32
+    size_t rc = SystemLocale::FromUtf16Strict( encoding, inString, cchInLen, ZSTR_VAL( newString ), cchOutLen );
+#else
+    size_t rc = WideCharToMultiByte( encoding, flags, inString, cchInLen, ZSTR_VAL( newString ), static_cast<int>( cchOutLen ),
+                                     NULL, NULL );
+#endif // !_WIN32
+    if( rc != cchOutLen ) {
+        zend_string_free( newString );
+        return false;
+    }
+
+    ZSTR_VAL( newString )[ cchOutLen ] = '\0';   // null terminate the encoded string
+    *outString = newString;
+
+    return true;
+}
+
+// returns true if the string is valid UTF-8.  Strings the ODBC driver returns as UTF-8 (SQL_C_CHAR on a
+// connection with CHAR_AS_UTF8) are checked with this before they are given to the script unconverted.
+
+bool is_valid_utf8( _In_reads_bytes_(len) const char* str, _In_ SQLLEN len )
+{
+    if( len == 0 ) {
+        return true;
+    }
+
+#ifndef _WIN32
+    return SystemLocale::ToUtf16Strict( CP_UTF8, str, len, NULL, 0 ) != 0;
+#else
+    if( len > INT_MAX ) {
+        LOG( SEV_ERROR, "UTF-8 string validation: buffer length exceeded." );
+        throw core::CoreException();
+    }
+    return MultiByteToWideChar( CP_UTF8, MB_ERR_INVALID_CHARS, str, static_cast<int>( len ), NULL, 0 ) != 0;
+#endif // !_WIN32
+}
+
 // thin wrapper around convert_string_from_default_encoding that handles
 // allocation of the destination string.  An empty string passed in returns
 // failure since it's a failure case for convert_string_from_default_encoding.
@@ -188,6 +340,15 @@ SQLWCHAR* utf16_string_from_mbcs_string( _In_ HDB_ENCODING php_encoding, _In_rea
     return utf16_string;
 }
 
+// converts into a buffer given by the caller, which must hold mbcs_len + 1 characters since no byte becomes
+// more than one UTF-16 character.  Returns the number of characters converted (not counting the terminating
+// NULL), or 0 on failure as the other version does.
+unsigned int utf16_string_from_mbcs_string( _In_ HDB_ENCODING php_encoding, _In_reads_bytes_(mbcs_len) const char* mbcs_string, _In_ unsigned int mbcs_len,
+                                            _Out_writes_(mbcs_len + 1) SQLWCHAR* utf16_string )
+{
+    return convert_string_from_default_encoding( php_encoding, mbcs_string, mbcs_len, utf16_string, mbcs_len + 1 );
+}
+
 // call to retrieve an error from ODBC.  This uses SQLGetDiagRec, so the
 // errno is 1 based.  It returns it as an array with 3 members:
 // 1/SQLSTATE) sqlstate
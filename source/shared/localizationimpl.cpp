@@ -12,6 +12,10 @@
 #include "globalization.h"
 #include "StringFunctions.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 struct cp_iconv
 {
     UINT CodePage;
@@ -324,9 +328,130 @@ const SystemLocale & SystemLocale::Singleton()
     return s_Default;
 }
 
+// Transcodes UTF8 to UTF16 without iconv, since SQL text and string parameters are converted on every
+// execution.  Runs of ASCII are widened 16 bytes at a time with SSE2; other characters are decoded one at
+// a time and validated the way iconv does (no overlong forms, surrogates or code points past U+10FFFF).
+// Returns the number of code units written, or the number needed when cchDest is 0.  Invalid or truncated
+// input fails with ERROR_NO_UNICODE_TRANSLATION and a dest too small with ERROR_INSUFFICIENT_BUFFER.
+static size_t Utf8ToUtf16( const char * src, size_t cchSrc, WCHAR * dest, size_t cchDest, DWORD * pErrorCode )
+{
+    const BYTE * pIn = reinterpret_cast<const BYTE *>( src );
+    const bool sizeOnly = ( 0 == cchDest );
+    size_t cchOut = 0;
+    size_t idx = 0;
+
+    if ( NULL != pErrorCode )
+        *pErrorCode = ERROR_SUCCESS;
+
+    while ( idx < cchSrc )
+    {
+#if defined(__SSE2__)
+        while ( idx + 16 <= cchSrc && ( sizeOnly || cchOut + 16 <= cchDest ) )
+        {
+            __m128i bytes = _mm_loadu_si128( reinterpret_cast<const __m128i *>( pIn + idx ) );
+            if ( 0 != _mm_movemask_epi8( bytes ) )
+                break;
+            if ( !sizeOnly )
+            {
+                _mm_storeu_si128( reinterpret_cast<__m128i *>( dest + cchOut ), _mm_unpacklo_epi8( bytes, _mm_setzero_si128() ) );
+                _mm_storeu_si128( reinterpret_cast<__m128i *>( dest + cchOut + 8 ), _mm_unpackhi_epi8( bytes, _mm_setzero_si128() ) );
+            }
+            idx += 16;
+            cchOut += 16;
+        }
+        if ( idx == cchSrc )
+            break;
+#endif
+        DWORD ch = pIn[idx];
+        size_t cbIn;
+        DWORD chMin;
+        if ( ch < 0x80 )
+        {
+            cbIn = 1;
+            chMin = 0;
+        }
+        else if ( 0xc2 <= ch && ch <= 0xdf )
+        {
+            cbIn = 2;
+            chMin = 0x80;
+            ch &= 0x1f;
+        }
+        else if ( 0xe0 <= ch && ch <= 0xef )
+        {
+            cbIn = 3;
+            chMin = 0x800;
+            ch &= 0x0f;
+        }
+        else if ( 0xf0 <= ch && ch <= 0xf4 )
+        {
+            cbIn = 4;
+            chMin = 0x10000;
+            ch &= 0x07;
+        }
+        else
+        {
+            if ( NULL != pErrorCode )
+                *pErrorCode = ERROR_NO_UNICODE_TRANSLATION;
+            return 0;
+        }
+
+        bool valid = ( cbIn <= cchSrc - idx );
+        for ( size_t i = 1; valid && i < cbIn; ++i )
+        {
+            BYTE trail = pIn[idx + i];
+            valid = ( 0x80 == (trail & 0xc0) );
+            ch = (ch << 6) | (trail & 0x3f);
+        }
+        if ( !valid || ch < chMin || 0x10ffff < ch || (0xd800 <= ch && ch <= 0xdfff) )
+        {
+            if ( NULL != pErrorCode )
+                *pErrorCode = ERROR_NO_UNICODE_TRANSLATION;
+            return 0;
+        }
+        idx += cbIn;
+
+        size_t cch = ( ch < 0x10000 ? 1 : 2 );
+        if ( !sizeOnly )
+        {
+            if ( cchDest - cchOut < cch )
+            {
+                if ( NULL != pErrorCode )
+                    *pErrorCode = ERROR_INSUFFICIENT_BUFFER;
+                return 0;
+            }
+            if ( 1 == cch )
+            {
+                dest[cchOut] = (WCHAR)ch;
+            }
+            else
+            {
+                dest[cchOut] = (WCHAR)( 0xd800 + ((ch - 0x10000) >> 10) );
+                dest[cchOut + 1] = (WCHAR)( 0xdc00 + ((ch - 0x10000) & 0x3ff) );
+            }
+        }
+        cchOut += cch;
+    }
+
+    return cchOut;
+}
+
 size_t SystemLocale::ToUtf16( UINT srcCodePage, const char * src, SSIZE_T cchSrc, WCHAR * dest, size_t cchDest, DWORD * pErrorCode )
 {
     srcCodePage = ExpandSpecialCP( srcCodePage );
+    size_t cchSrcActual = (cchSrc < 0 ? (1+strnlen_s(src)) : cchSrc);
+    if ( CP_UTF8 == srcCodePage && 2 == sizeof(WCHAR) )
+    {
+        // invalid input is left to iconv, which replaces it rather than failing
+        DWORD rc = ERROR_SUCCESS;
+        size_t cchCvt = Utf8ToUtf16( src, cchSrcActual, dest, cchDest, &rc );
+        if ( ERROR_NO_UNICODE_TRANSLATION != rc )
+        {
+            if ( NULL != pErrorCode )
+                *pErrorCode = rc;
+            return cchCvt;
+        }
+    }
+
     EncodingConverter cvt( CP_UTF16, srcCodePage );
     if ( !cvt.Initialize() )
     {
@@ -334,7 +459,6 @@ size_t SystemLocale::ToUtf16( UINT srcCodePage, const char * src, SSIZE_T cchSrc
             *pErrorCode = ERROR_INVALID_PARAMETER;
         return 0;
     }
-    size_t cchSrcActual = (cchSrc < 0 ? (1+strnlen_s(src)) : cchSrc);
     bool hasLoss;
     return cvt.Convert( dest, cchDest, src, cchSrcActual, false, &hasLoss, pErrorCode );
 }
@@ -342,6 +466,10 @@ size_t SystemLocale::ToUtf16( UINT srcCodePage, const char * src, SSIZE_T cchSrc
 size_t SystemLocale::ToUtf16Strict( UINT srcCodePage, const char * src, SSIZE_T cchSrc, WCHAR * dest, size_t cchDest, DWORD * pErrorCode )
 {
     srcCodePage = ExpandSpecialCP( srcCodePage );
+    size_t cchSrcActual = (cchSrc < 0 ? (1+strnlen_s(src)) : cchSrc);
+    if ( CP_UTF8 == srcCodePage && 2 == sizeof(WCHAR) )
+        return Utf8ToUtf16( src, cchSrcActual, dest, cchDest, pErrorCode );
+
     EncodingConverter cvt( CP_UTF16, srcCodePage );
     if ( !cvt.Initialize() )
     {
@@ -349,14 +477,118 @@ size_t SystemLocale::ToUtf16Strict( UINT srcCodePage, const char * src, SSIZE_T
             *pErrorCode = ERROR_INVALID_PARAMETER;
         return 0;
     }
-    size_t cchSrcActual = (cchSrc < 0 ? (1+strnlen_s(src)) : cchSrc);
     bool hasLoss;
     return cvt.Convert( dest, cchDest, src, cchSrcActual, true, &hasLoss, pErrorCode );
 }
 
+// Transcodes UTF16 to UTF8 without iconv.  Converting fetched strings to UTF8 is by far the most
+// common conversion, and iconv's fixed cost per call outweighs the conversion itself for short strings.
+// Runs of ASCII are converted 8 code units at a time with SSE2; everything else, including surrogate
+// pairs, one code unit at a time.
+// Returns the number of bytes written, or the number needed when cchDest is 0, and fails like
+// EncodingConverter::Convert: a lone surrogate is an error (ERROR_NO_UNICODE_TRANSLATION) when failIfLossy
+// is set and is replaced by U+FFFD otherwise, and a dest too small is ERROR_INSUFFICIENT_BUFFER.
+// Each code unit is read before its bytes are written, so dest may overlap src as long as the output
+// never overtakes the code units still to be read.
+static size_t Utf16ToUtf8( const WCHAR * src, size_t cchSrc, char * dest, size_t cchDest, bool failIfLossy, bool * pHasDataLoss, DWORD * pErrorCode )
+{
+    const bool sizeOnly = ( 0 == cchDest );
+    size_t cchOut = 0;
+    size_t idx = 0;
+
+    if ( NULL != pHasDataLoss )
+        *pHasDataLoss = false;
+    if ( NULL != pErrorCode )
+        *pErrorCode = ERROR_SUCCESS;
+
+    while ( idx < cchSrc )
+    {
+#if defined(__SSE2__)
+        const __m128i nonAscii = _mm_set1_epi16( (short)0xff80 );
+        while ( idx + 8 <= cchSrc && ( sizeOnly || cchOut + 8 <= cchDest ) )
+        {
+            __m128i units = _mm_loadu_si128( reinterpret_cast<const __m128i *>( src + idx ) );
+            if ( 0xffff != _mm_movemask_epi8( _mm_cmpeq_epi16( _mm_and_si128( units, nonAscii ), _mm_setzero_si128() ) ) )
+                break;
+            if ( !sizeOnly )
+                _mm_storel_epi64( reinterpret_cast<__m128i *>( dest + cchOut ), _mm_packus_epi16( units, units ) );
+            idx += 8;
+            cchOut += 8;
+        }
+        if ( idx == cchSrc )
+            break;
+#endif
+        DWORD ch = src[idx++];
+        size_t cb;
+        if ( ch < 0x80 )
+            cb = 1;
+        else if ( ch < 0x800 )
+            cb = 2;
+        else if ( ch < 0xd800 || 0xdfff < ch )
+            cb = 3;
+        else if ( ch < 0xdc00 && idx < cchSrc && 0xdc00 <= src[idx] && src[idx] <= 0xdfff )
+        {
+            ch = 0x10000 + ( (ch - 0xd800) << 10 ) + ( src[idx++] - 0xdc00 );
+            cb = 4;
+        }
+        else
+        {
+            if ( failIfLossy )
+            {
+                if ( NULL != pErrorCode )
+                    *pErrorCode = ERROR_NO_UNICODE_TRANSLATION;
+                return 0;
+            }
+            if ( NULL != pHasDataLoss )
+                *pHasDataLoss = true;
+            ch = 0xfffd;
+            cb = 3;
+        }
+
+        if ( !sizeOnly )
+        {
+            if ( cchDest - cchOut < cb )
+            {
+                if ( NULL != pErrorCode )
+                    *pErrorCode = ERROR_INSUFFICIENT_BUFFER;
+                return 0;
+            }
+            char * pOut = dest + cchOut;
+            switch ( cb )
+            {
+            case 1:
+                pOut[0] = (char)ch;
+                break;
+            case 2:
+                pOut[0] = (char)( 0xc0 | (ch >> 6) );
+                pOut[1] = (char)( 0x80 | (ch & 0x3f) );
+                break;
+            case 3:
+                pOut[0] = (char)( 0xe0 | (ch >> 12) );
+                pOut[1] = (char)( 0x80 | ((ch >> 6) & 0x3f) );
+                pOut[2] = (char)( 0x80 | (ch & 0x3f) );
+                break;
+            default:
+                pOut[0] = (char)( 0xf0 | (ch >> 18) );
+                pOut[1] = (char)( 0x80 | ((ch >> 12) & 0x3f) );
+                pOut[2] = (char)( 0x80 | ((ch >> 6) & 0x3f) );
+                pOut[3] = (char)( 0x80 | (ch & 0x3f) );
+                break;
+            }
+        }
+        cchOut += cb;
+    }
+
+    return cchOut;
+}
+
 size_t SystemLocale::FromUtf16( UINT destCodePage, const WCHAR * src, SSIZE_T cchSrc, char * dest, size_t cchDest, bool * pHasDataLoss, DWORD * pErrorCode )
 {
     destCodePage = ExpandSpecialCP( destCodePage );
+    size_t cchSrcActual = (cchSrc < 0 ? (1+mplat_wcslen(src)) : cchSrc);
+    if ( CP_UTF8 == destCodePage && 2 == sizeof(WCHAR) )
+        return Utf16ToUtf8( src, cchSrcActual, dest, cchDest, false, pHasDataLoss, pErrorCode );
+
     EncodingConverter cvt( destCodePage, CP_UTF16 );
     if ( !cvt.Initialize() )
     {
@@ -364,7 +596,6 @@ size_t SystemLocale::FromUtf16( UINT destCodePage, const WCHAR * src, SSIZE_T cc
             *pErrorCode = ERROR_INVALID_PARAMETER;
         return 0;
     }
-    size_t cchSrcActual = (cchSrc < 0 ? (1+mplat_wcslen(src)) : cchSrc);
     bool hasLoss;
     return cvt.Convert( dest, cchDest, src, cchSrcActual, false, &hasLoss, pErrorCode );
 }
@@ -372,6 +603,10 @@ size_t SystemLocale::FromUtf16( UINT destCodePage, const WCHAR * src, SSIZE_T cc
 size_t SystemLocale::FromUtf16Strict(UINT destCodePage, const WCHAR * src, SSIZE_T cchSrc, char * dest, size_t cchDest, bool * pHasDataLoss, DWORD * pErrorCode)
 {
     destCodePage = ExpandSpecialCP(destCodePage);
+    size_t cchSrcActual = (cchSrc < 0 ? (1 + mplat_wcslen(src)) : cchSrc);
+    if (CP_UTF8 == destCodePage && 2 == sizeof(WCHAR))
+        return Utf16ToUtf8(src, cchSrcActual, dest, cchDest, true, pHasDataLoss, pErrorCode);
+
     EncodingConverter cvt(destCodePage, CP_UTF16);
     if (!cvt.Initialize())
     {
@@ -379,7 +614,6 @@ size_t SystemLocale::FromUtf16Strict(UINT destCodePage, const WCHAR * src, SSIZE
             *pErrorCode = ERROR_INVALID_PARAMETER;
         return 0;
     }
-    size_t cchSrcActual = (cchSrc < 0 ? (1 + mplat_wcslen(src)) : cchSrc);
     bool hasLoss;
     return cvt.Convert(dest, cchDest, src, cchSrcActual, true, &hasLoss, pErrorCode);
 }
@@ -77,10 +77,10 @@ const char SS_HDB_WARNING_PARAM_VAR_NOT_REF[] = "Variable parameter %d not passe
 
 /* internal functions */
 
-void convert_to_zval( _Inout_ hdb_stmt* stmt, _In_ HDB_PHPTYPE hdb_php_type, _In_opt_ void* in_val, _In_ SQLLEN field_len, _Inout_ zval& out_zval );
+void convert_to_zval( _Inout_ hdb_stmt* stmt, _In_ HDB_PHPTYPE hdb_php_type, _Inout_opt_ void*& in_val, _In_ SQLLEN field_len, _Inout_ zval& out_zval );
 
-void fetch_fields_common( _Inout_ ss_hdb_stmt* stmt, _In_ zend_long fetch_type, _Out_ zval& fields, _In_ bool allow_empty_field_names
-						);
+void fetch_fields_common( _Inout_ ss_hdb_stmt* stmt, _In_ zend_long fetch_type, _Out_ zval& fields, _In_ bool allow_empty_field_names,
+                          _In_ SQLSMALLINT num_cols = -1 );
 bool determine_column_size_or_precision( hdb_stmt const* stmt, _In_ hdb_sqltype hdb_type, _Inout_ SQLULEN* column_size,
  _Out_ SQLSMALLINT* decimal_digits );
 hdb_phptype determine_hdb_php_type( hdb_stmt const* stmt, SQLINTEGER sql_type, SQLUINTEGER size, bool prefer_string );
@@ -105,6 +105,7 @@ namespace SSCursorTypes {
     const char QUERY_OPTION_SCROLLABLE_KEYSET[] = "keyset";
     const char QUERY_OPTION_SCROLLABLE_FORWARD[] = "forward";
     const char QUERY_OPTION_SCROLLABLE_BUFFERED[] = "buffered";
+    const char QUERY_OPTION_SCROLLABLE_BUFFERED_COLUMNAR[] = "buffered_columnar";
 }
 
 ss_hdb_stmt::ss_hdb_stmt( _In_ hdb_conn* c, _In_ SQLHANDLE handle, _In_ error_callback e, _In_ void* drv ) :
@@ -120,11 +121,17 @@ ss_hdb_stmt::ss_hdb_stmt( _In_ hdb_conn* c, _In_ SQLHANDLE handle, _In_ error_ca
 
 ss_hdb_stmt::~ss_hdb_stmt( void )
 {
+    // the parameters freed below may still be read by an execution in progress, so cancel it first.  The base
+    // destructor then frees the handle rather than reusing it.
+    if( async_executing && valid() ) {
+        ::SQLCancel( handle() );
+    }
+
     if( fetch_field_names != NULL ) {
 
         for( int i=0; i < fetch_fields_count; ++i ) {
             
-            hdb_free( fetch_field_names[ i ].name );
+            zend_string_release( fetch_field_names[ i ].name );
         }
         hdb_free( fetch_field_names );
     }
@@ -142,7 +149,7 @@ void ss_hdb_stmt::new_result_set( )
 
         for( int i=0; i < fetch_fields_count; ++i ) {
             
-            hdb_free( fetch_field_names[ i ].name );
+            zend_string_release( fetch_field_names[ i ].name );
         }
         hdb_free( fetch_field_names );
     }
@@ -300,6 +307,235 @@ PHP_FUNCTION( hdb_execute )
     }
 }
 
+// hdb_execute_batch( resource $stmt, array $rows )
+//
+// Executes a previously prepared statement once for each row of parameter values, sending all the rows
+// to the server in a single round trip.  Each parameter is sent as an array of its values in every row, so
+// this is the fastest way to insert or update many rows with the same statement.
+//
+// Parameters
+// $stmt: A resource specifying the statement to be executed, prepared with hdb_prepare.  The parameters
+// given to hdb_prepare are not used.
+// $rows: An array of rows.  Each row is an array of the values of the statement's parameters, in order.
+// The values may only be null, booleans, integers, floats or strings; a parameter that has strings in some
+// rows sends all of its values as strings.
+//
+// Return Value
+// An array holding the status of each row, in the order of $rows: HDB_PARAM_SUCCESS,
+// HDB_PARAM_SUCCESS_WITH_INFO, HDB_PARAM_ERROR, HDB_PARAM_UNUSED or HDB_PARAM_DIAG_UNAVAILABLE.  If
+// only some of the rows failed, the errors are returned by hdb_errors as warnings.  Otherwise, false if
+// an error occurred.
+
+PHP_FUNCTION( hdb_execute_batch )
+{
+    LOG_FUNCTION( "hdb_execute_batch" );
+
+    ss_hdb_stmt* stmt = NULL;
+    zval* rows_z = NULL;
+
+    PROCESS_PARAMS( stmt, "ra", _FN_, 1, &rows_z );
+
+    zval statuses;
+    ZVAL_UNDEF( &statuses );
+
+    try {
+
+        CHECK_CUSTOM_ERROR(( !stmt->prepared ), stmt, SS_HDB_ERROR_STATEMENT_NOT_PREPARED ) {
+            throw ss::SSException();
+        }
+
+        CHECK_CUSTOM_ERROR( stmt->async_executing, stmt, HDB_ERROR_ASYNC_STILL_EXECUTING ) {
+            throw ss::SSException();
+        }
+
+        // the statuses are only ever appended, so start with a packed table
+        array_init( &statuses );
+        zend_hash_real_init( Z_ARRVAL( statuses ), 1 /*packed*/ );
+        if( zend_hash_num_elements( Z_ARRVAL_P( rows_z )) == 0 ) {
+            RETURN_ARR( Z_ARRVAL( statuses ));
+        }
+
+        // prepare for the next execution by flushing anything remaining in the result set
+        if( stmt->executed ) {
+
+            while( stmt->past_next_result_end == false ) {
+
+                core_hdb_next_result( stmt, false, false );
+            }
+        }
+
+        core_hdb_execute_batch( stmt, Z_ARRVAL_P( rows_z ), &statuses );
+
+        RETURN_ARR( Z_ARRVAL( statuses ));
+    }
+    catch( core::CoreException& ) {
+
+        zval_ptr_dtor( &statuses );
+        RETURN_FALSE;
+    }
+    catch( ... ) {
+
+        DIE( "hdb_execute_batch: Unknown exception caught." );
+    }
+}
+
+// hdb_execute_async( resource $stmt )
+//
+// Starts executing a previously prepared statement and returns without waiting for the server, so that
+// several statements (on different connections) can execute at the same time.  Call hdb_poll or hdb_wait
+// until the execution completes before using the statement again.
+//
+// Parameters
+// $stmt: A resource specifying the statement to be executed, prepared with hdb_prepare.  Its parameters may
+// not include streams; use hdb_execute for those.
+//
+// Return Value
+// A Boolean value: true if the execution was started (or already completed). Otherwise, false.
+
+PHP_FUNCTION( hdb_execute_async )
+{
+    LOG_FUNCTION( "hdb_execute_async" );
+
+    ss_hdb_stmt* stmt = NULL;
+
+    try {
+
+        PROCESS_PARAMS( stmt, "r", _FN_, 0 );
+        CHECK_CUSTOM_ERROR(( !stmt->prepared ), stmt, SS_HDB_ERROR_STATEMENT_NOT_PREPARED ) {
+            throw ss::SSException();
+        }
+
+        // prepare for the next execution by flushing anything remaining in the result set
+        if( stmt->executed ) {
+
+            while( stmt->past_next_result_end == false ) {
+
+                core_hdb_next_result( stmt, false, false );
+            }
+        }
+
+        // bind parameters before executing
+        bind_params( stmt );
+
+        core_hdb_execute_async( stmt );
+
+        RETURN_TRUE;
+    }
+    catch( core::CoreException& ) {
+
+        RETURN_FALSE;
+    }
+    catch( ... ) {
+
+        DIE( "hdb_execute_async: Unknown exception caught." );
+    }
+}
+
+// hdb_poll( resource $stmt )
+//
+// Checks whether the execution started by hdb_execute_async completed, without waiting.
+//
+// Parameters
+// $stmt: A statement resource passed to hdb_execute_async.
+//
+// Return Value
+// true if the execution completed and the statement's results can be read, null if it is still executing, and
+// false if an error occurred.
+
+PHP_FUNCTION( hdb_poll )
+{
+    LOG_FUNCTION( "hdb_poll" );
+
+    ss_hdb_stmt* stmt = NULL;
+    PROCESS_PARAMS( stmt, "r", _FN_, 0 );
+
+    try {
+
+        if( core_hdb_poll( stmt )) {
+            RETURN_TRUE;
+        }
+
+        RETURN_NULL();
+    }
+    catch( core::CoreException& ) {
+
+        RETURN_FALSE;
+    }
+    catch( ... ) {
+
+        DIE( "hdb_poll: Unknown exception caught." );
+    }
+}
+
+// hdb_wait( array $stmts [, float $timeout] )
+//
+// Waits for the executions started by hdb_execute_async on several statements to complete.
+//
+// Parameters
+// $stmts: An array of statement resources passed to hdb_execute_async.
+// $timeout (OPTIONAL): The number of seconds to wait at most.  If omitted or negative, hdb_wait waits until
+// all the executions complete.
+//
+// Return Value
+// true if all the executions completed, null if the timeout expired first, and false if an error occurred.
+// Errors are reported for the first statement whose execution failed; call hdb_wait again with the
+// others to keep waiting for them.
+
+PHP_FUNCTION( hdb_wait )
+{
+    LOG_FUNCTION( "hdb_wait" );
+
+    zval* stmts_z = NULL;
+    double timeout = -1.0;
+
+    // reset the errors from the previous API call
+    reset_errors();
+
+    // dummy context to pass to the error handler
+    hdb_context error_ctx( 0, ss_error_handler, NULL );
+    error_ctx.set_func( _FN_ );
+
+    try {
+
+        int zr = zend_parse_parameters( ZEND_NUM_ARGS(), "a|d", &stmts_z, &timeout );
+        CHECK_CUSTOM_ERROR(( zr == FAILURE ), &error_ctx, SS_HDB_ERROR_INVALID_FUNCTION_PARAMETER, _FN_ ) {
+            throw ss::SSException();
+        }
+
+        std::vector<hdb_stmt*> stmts;
+        zval* stmt_z = NULL;
+
+        ZEND_HASH_FOREACH_VAL( Z_ARRVAL_P( stmts_z ), stmt_z ) {
+
+            ss_hdb_stmt* stmt = NULL;
+            if( Z_TYPE_P( stmt_z ) == IS_RESOURCE ) {
+                stmt = static_cast<ss_hdb_stmt*>( zend_fetch_resource( Z_RES_P( stmt_z ), ss_hdb_stmt::resource_name,
+                                                                       ss_hdb_stmt::descriptor ));
+            }
+            CHECK_CUSTOM_ERROR(( stmt == NULL ), &error_ctx, SS_HDB_ERROR_INVALID_FUNCTION_PARAMETER, _FN_ ) {
+                throw ss::SSException();
+            }
+
+            stmt->set_func( _FN_ );
+            stmts.push_back( stmt );
+        } ZEND_HASH_FOREACH_END();
+
+        if( core_hdb_wait( stmts, timeout )) {
+            RETURN_TRUE;
+        }
+
+        RETURN_NULL();
+    }
+    catch( core::CoreException& ) {
+
+        RETURN_FALSE;
+    }
+    catch( ... ) {
+
+        DIE( "hdb_wait: Unknown exception caught." );
+    }
+}
+
 
 // hdb_fetch( resource $stmt )
 //
@@ -413,6 +649,87 @@ PHP_FUNCTION( hdb_fetch_array )
     }
 }
 
+// hdb_fetch_all( resource $stmt [, int $fetchType [, int $maxRows]] )
+//
+// Retrieves the remaining rows of the current result set as an array of rows.
+// Each row is built the same way hdb_fetch_array builds it, but the loop runs
+// natively so the column count and field names are only retrieved once for
+// the whole result set rather than once per row.
+//
+// Parameters
+// $stmt: A statement resource corresponding to an executed statement.
+// $fetchType [OPTIONAL]: A predefined constant. See HDB_FETCH_TYPE in php_hdb.h
+// $maxRows [OPTIONAL]: The maximum number of rows to retrieve.  0 (the default)
+// retrieves all remaining rows.
+//
+// Return Value
+// A numerically indexed array of rows, which is empty if there are no more rows
+// to retrieve.  If an error occurs, false is returned.
+
+PHP_FUNCTION( hdb_fetch_all )
+{
+    LOG_FUNCTION( "hdb_fetch_all" );
+
+    ss_hdb_stmt* stmt = NULL;
+    zend_long fetch_type = HDB_FETCH_BOTH; // default value for parameter if one isn't supplied
+    zend_long max_rows = 0;                   // default value for parameter if one isn't supplied
+
+    // retrieve the statement resource and optional fetch type (see enum HDB_FETCH_TYPE) and row limit
+    PROCESS_PARAMS( stmt, "r|ll", _FN_, 2, &fetch_type, &max_rows );
+
+    zval rows;
+    ZVAL_UNDEF( &rows );
+
+    try {
+
+        CHECK_CUSTOM_ERROR(( fetch_type < MIN_HDB_FETCH || fetch_type > MAX_HDB_FETCH ), stmt,
+                           SS_HDB_ERROR_INVALID_FETCH_TYPE ) {
+            throw ss::SSException();
+        }
+
+        CHECK_CUSTOM_ERROR(( max_rows < 0 ), stmt, SS_HDB_ERROR_INVALID_MAX_ROWS ) {
+            throw ss::SSException();
+        }
+
+        // the rows are only ever appended, so start with a packed table
+        array_init( &rows );
+        zend_hash_real_init( Z_ARRVAL( rows ), 1 /*packed*/ );
+
+        SQLSMALLINT num_cols = -1;
+        zend_long row_count = 0;
+
+        while(( max_rows == 0 || row_count < max_rows ) && core_hdb_fetch( stmt, SQL_FETCH_NEXT, 0 )) {
+
+            // core_hdb_fetch verified the result set has columns on its first call
+            if( num_cols < 0 ) {
+                num_cols = stmt->num_result_cols();
+            }
+
+            zval fields;
+            ZVAL_UNDEF( &fields );
+            fetch_fields_common( stmt, fetch_type, fields, true /*allow_empty_field_names*/, num_cols );
+
+            int zr = add_next_index_zval( &rows, &fields );
+            CHECK_ZEND_ERROR( zr, stmt, HDB_ERROR_ZEND_HASH ) {
+                zval_ptr_dtor( &fields );
+                throw ss::SSException();
+            }
+            ++row_count;
+        }
+
+        RETURN_ARR( Z_ARRVAL( rows ));
+    }
+
+    catch( core::CoreException& ) {
+        zval_ptr_dtor( &rows );
+        RETURN_FALSE;
+    }
+    catch( ... ) {
+
+        DIE( "hdb_fetch_all: Unknown exception caught." );
+    }
+}
+
 // hdb_field_metadata( resource $stmt )
 // 
 // Retrieves metadata for the fields of a prepared statement. For information
@@ -445,6 +762,10 @@ PHP_FUNCTION( hdb_field_metadata )
 
     try {
 
+    CHECK_CUSTOM_ERROR( stmt->async_executing, stmt, HDB_ERROR_ASYNC_STILL_EXECUTING ) {
+        throw ss::SSException();
+    }
+
     // get the number of fields in the resultset
     num_cols = core::SQLNumResultCols( stmt);
 
@@ -595,6 +916,10 @@ PHP_FUNCTION( hdb_rows_affected )
 
      try {
 
+        CHECK_CUSTOM_ERROR( stmt->async_executing, stmt, HDB_ERROR_ASYNC_STILL_EXECUTING ) {
+            throw ss::SSException();
+        }
+
         // make sure that the statement has already been executed.
         CHECK_CUSTOM_ERROR( !stmt->executed, stmt, HDB_ERROR_STATEMENT_NOT_EXECUTED ) {
             throw ss::SSException();
@@ -643,6 +968,10 @@ PHP_FUNCTION( hdb_num_rows )
 
     try {
 
+        CHECK_CUSTOM_ERROR( stmt->async_executing, stmt, HDB_ERROR_ASYNC_STILL_EXECUTING ) {
+            throw ss::SSException();
+        }
+
         // make sure that the statement has already been executed.
         CHECK_CUSTOM_ERROR( !stmt->executed, stmt, HDB_ERROR_STATEMENT_NOT_EXECUTED ) {
             throw ss::SSException();
@@ -693,6 +1022,10 @@ PHP_FUNCTION( hdb_num_fields )
 
     try {
     
+        CHECK_CUSTOM_ERROR( stmt->async_executing, stmt, HDB_ERROR_ASYNC_STILL_EXECUTING ) {
+            throw ss::SSException();
+        }
+
         // retrieve the number of columns from ODBC
         fields = core::SQLNumResultCols( stmt);
    
@@ -943,6 +1276,10 @@ PHP_FUNCTION( hdb_has_rows )
 
         PROCESS_PARAMS( stmt, "r", _FN_, 0 );
 
+        CHECK_CUSTOM_ERROR( stmt->async_executing, stmt, HDB_ERROR_ASYNC_STILL_EXECUTING ) {
+            throw ss::SSException();
+        }
+
         CHECK_CUSTOM_ERROR( !stmt->executed, stmt, HDB_ERROR_STATEMENT_NOT_EXECUTED ) {
             throw ss::SSException();
         }
@@ -1068,16 +1405,19 @@ PHP_FUNCTION( hdb_get_field )
     try {
 
         // validate that the field index is within range
-        int num_cols = core::SQLNumResultCols( stmt);
+        int num_cols = stmt->num_result_cols();
 
         if( field_index < 0 || field_index >= num_cols ) {
             THROW_SS_ERROR( stmt, SS_HDB_ERROR_INVALID_FUNCTION_PARAMETER, _FN_ );
         }
 
-        core_hdb_get_field( stmt, static_cast<SQLUSMALLINT>( field_index ), hdb_php_type, false, field_value, &field_len, false/*cache_field*/,
-                               &hdb_php_type_out);
-        convert_to_zval( stmt, hdb_php_type_out, field_value, field_len, retval_z );		
-        hdb_free( field_value );
+        // ints and floats are returned straight in the zval, everything else goes through a buffer
+        if( !core_hdb_get_scalar_field( stmt, static_cast<SQLUSMALLINT>( field_index ), hdb_php_type, false, retval_z )) {
+
+            core_hdb_get_field( stmt, static_cast<SQLUSMALLINT>( field_index ), hdb_php_type, false, field_value, &field_len, false/*cache_field*/,
+                                   &hdb_php_type_out);
+            convert_to_zval( stmt, hdb_php_type_out, field_value, field_len, retval_z );
+        }
         RETURN_ZVAL( &retval_z, 1, 1 );
     }
 
@@ -1090,6 +1430,59 @@ PHP_FUNCTION( hdb_get_field )
     }
 }
 
+// hdb_copy_field_to_stream( resource $stmt, int $fieldIndex, resource $stream )
+//
+// Writes a character or binary field of the current row to a stream, such as php://output or a file.  The
+// field is read in large chunks and each is written straight to the stream, so serving a large LOB neither
+// builds a PHP string nor goes through the buffer of an hdb stream as hdb_get_field and fpassthru do.
+//
+// Parameters
+// $stmt: A statement resource corresponding to an executed statement.
+// $fieldIndex: The index of the field to be retrieved.  Indexes begin at 0.
+// $stream: The stream the field is written to.
+//
+// Return Value
+// The number of bytes written to the stream (0 if the field is NULL), or false if an error occurred.
+
+PHP_FUNCTION( hdb_copy_field_to_stream )
+{
+    LOG_FUNCTION( "hdb_copy_field_to_stream" );
+
+    ss_hdb_stmt* stmt = NULL;
+    zend_long field_index = -1;
+    zval* stream_z = NULL;
+
+    PROCESS_PARAMS( stmt, "rlr", _FN_, 2, &field_index, &stream_z );
+
+    try {
+
+        // validate that the field index is within range
+        int num_cols = stmt->num_result_cols();
+
+        if( field_index < 0 || field_index >= num_cols ) {
+            THROW_SS_ERROR( stmt, SS_HDB_ERROR_INVALID_FUNCTION_PARAMETER, _FN_ );
+        }
+
+        php_stream* stream = NULL;
+        php_stream_from_zval_no_verify( stream, stream_z );
+        CHECK_CUSTOM_ERROR( stream == NULL, stmt, SS_HDB_ERROR_INVALID_FUNCTION_PARAMETER, _FN_ ) {
+            throw ss::SSException();
+        }
+
+        size_t copied = core_hdb_copy_field_to_stream( stmt, static_cast<SQLUSMALLINT>( field_index ), stream );
+
+        RETURN_LONG( static_cast<zend_long>( copied ));
+    }
+    catch( core::CoreException& ) {
+
+        RETURN_FALSE;
+    }
+    catch( ... ) {
+
+        DIE( "hdb_copy_field_to_stream: Unknown exception caught." );
+    }
+}
+
 
 // ** type functions. **
 // When specifying PHP and SQL Server types that take parameters, such as VARCHAR(2000), we use functions
@@ -1160,6 +1553,11 @@ PHP_FUNCTION(HDB_SQLTYPE_VARCHAR)
 
 void bind_params( _Inout_ ss_hdb_stmt* stmt )
 {
+    // the parameters of an execution still in progress can't be freed
+    CHECK_CUSTOM_ERROR( stmt->async_executing, stmt, HDB_ERROR_ASYNC_STILL_EXECUTING ) {
+        throw ss::SSException();
+    }
+
     // if there's nothing to do, just return
     if( stmt->params_z == NULL ) {
         return;
@@ -1428,6 +1826,11 @@ void stmt_option_ss_scrollable:: operator()( _Inout_ hdb_stmt* stmt, stmt_option
         cursor_type = HDB_CURSOR_BUFFERED;
     }
 
+    else if( !stricmp( scroll_type, SSCursorTypes::QUERY_OPTION_SCROLLABLE_BUFFERED_COLUMNAR )) {
+        
+        cursor_type = HDB_CURSOR_BUFFERED_COLUMNAR;
+    }
+
     else {
 
         THROW_SS_ERROR( stmt, HDB_ERROR_INVALID_OPTION_SCROLLABLE );
@@ -1439,7 +1842,10 @@ void stmt_option_ss_scrollable:: operator()( _Inout_ hdb_stmt* stmt, stmt_option
 
 namespace {
 
-void convert_to_zval( _Inout_ hdb_stmt* stmt, _In_ HDB_PHPTYPE hdb_php_type, _In_opt_ void* in_val, _In_ SQLLEN field_len, _Inout_ zval& out_zval)
+// convert a field value returned by core_hdb_get_field to a zval.  The field value is consumed: strings are
+// handed to the zval as they are and everything else is released once copied, so in_val is NULL afterwards.
+
+void convert_to_zval( _Inout_ hdb_stmt* stmt, _In_ HDB_PHPTYPE hdb_php_type, _Inout_opt_ void*& in_val, _In_ SQLLEN field_len, _Inout_ zval& out_zval)
 {
 	if ( in_val == NULL ) {
 		ZVAL_NULL( &out_zval);
@@ -1462,8 +1868,10 @@ void convert_to_zval( _Inout_ hdb_stmt* stmt, _In_ HDB_PHPTYPE hdb_php_type, _In
 
 	case HDB_PHPTYPE_STRING:
 	{
-		ZVAL_STRINGL( &out_zval, static_cast<const char*>( in_val ), field_len);
-		break;
+		// the zval takes over the string, so there is nothing left to release
+		ZVAL_STR( &out_zval, static_cast<zend_string*>( in_val ));
+		in_val = NULL;
+		return;
 	}
 
 	case HDB_PHPTYPE_STREAM:
@@ -1488,7 +1896,8 @@ void convert_to_zval( _Inout_ hdb_stmt* stmt, _In_ HDB_PHPTYPE hdb_php_type, _In
 		DIE("Unknown php type");
 		break;
 	}
-	return;
+	stmt->free_field_value( in_val );
+	in_val = NULL;
 }
 
 
@@ -1694,15 +2103,13 @@ hdb_phptype determine_hdb_php_type( _In_ ss_hdb_stmt const* stmt, _In_ SQLINTEGE
 }
 
 
-// determine if a query returned any rows of data.  It does this by actually fetching the first row
-// (though not retrieving the data) and setting the has_rows flag in the stmt the fetch was successful.
-// The return value simply states whether or not if an error occurred during the determination.
+// determine if a query returned any rows of data and set the has_rows flag in the stmt.  The result set answers
+// this itself: a buffered result set already has its rows, the others fetch the first row (or block of rows) and
+// keep it for the first hdb_fetch, so the cursor isn't scrolled back and nothing is fetched twice.
 // (All errors are posted here before returning.)
 
 void determine_stmt_has_rows( _Inout_ ss_hdb_stmt* stmt )
 {
-    SQLRETURN r = SQL_SUCCESS;
-
     if( stmt->fetch_called ) {
 
         return;
@@ -1712,44 +2119,18 @@ void determine_stmt_has_rows( _Inout_ ss_hdb_stmt* stmt )
     stmt->has_rows = false;
 
     // if there are no columns then there are no rows
-    if( core::SQLNumResultCols( stmt) == 0 ) {
+    if( stmt->num_result_cols() == 0 ) {
 
         return;
     }
 
-    // if the statement is scrollable, our work is easier though less performant.  We simply
-    // fetch the first row, and then roll the cursor back to be prior to the first row
-    if( stmt->cursor_type != SQL_CURSOR_FORWARD_ONLY ) {
-
-        r = stmt->current_results->fetch( SQL_FETCH_FIRST, 0);
-        if( SQL_SUCCEEDED( r )) {
-
-            stmt->has_rows = true;
-            CHECK_SQL_WARNING( r, stmt );
-            // restore the cursor to its original position.
-            r = stmt->current_results->fetch( SQL_FETCH_ABSOLUTE, 0);
-            HDB_ASSERT(( r == SQL_NO_DATA ), "core_hdb_has_rows: Should have scrolled the cursor to the beginning "
-                          "of the result set." );
-        }
-    }
-    else {
-        
-        // otherwise, we fetch the first row, but record that we did.  hdb_fetch checks this
-        // flag and simply skips the first fetch, knowing it was already done.  It records its own 
-        // flags to know if it should fetch on subsequent calls.
-
-        r = core::SQLFetchScroll( stmt, SQL_FETCH_NEXT, 0);
-        if( SQL_SUCCEEDED( r )) {
-
-            stmt->has_rows = true;
-            CHECK_SQL_WARNING( r, stmt );
-            return;
-        }
-    }
+    stmt->has_rows = stmt->current_results->has_rows();
 }
 
-void fetch_fields_common( _Inout_ ss_hdb_stmt* stmt, _In_ zend_long fetch_type, _Out_ zval& fields, _In_ bool allow_empty_field_names
-						)
+// num_cols may be passed in by callers that fetch many rows from the same result set (hdb_fetch_all)
+// so the column count is only queried once.  -1 means query it from the statement.
+void fetch_fields_common( _Inout_ ss_hdb_stmt* stmt, _In_ zend_long fetch_type, _Out_ zval& fields, _In_ bool allow_empty_field_names,
+                          _In_ SQLSMALLINT num_cols )
 {
 	void* field_value = NULL;
 	hdb_phptype hdb_php_type;
@@ -1762,7 +2143,9 @@ void fetch_fields_common( _Inout_ ss_hdb_stmt* stmt, _In_ zend_long fetch_type,
 	}
 
 	// get the numer of columns in the result set
-	SQLSMALLINT num_cols = core::SQLNumResultCols(stmt);
+	if( num_cols < 0 ) {
+		num_cols = stmt->num_result_cols();
+	}
 
 	// if this is the first fetch in a new result set, then get the field names and
 	// store them off for successive fetches.
@@ -1775,75 +2158,120 @@ void fetch_fields_common( _Inout_ ss_hdb_stmt* stmt, _In_ zend_long fetch_type,
         hdb_malloc_auto_ptr<hdb_fetch_field_name> field_names;
         field_names = static_cast<hdb_fetch_field_name*>( hdb_malloc( num_cols * sizeof( hdb_fetch_field_name )));
         HDB_ENCODING encoding = (( stmt->encoding() == HDB_ENCODING_DEFAULT ) ? stmt->conn->encoding() : stmt->encoding());
-        for( int i = 0; i < num_cols; ++i ) {
+        int i = 0;
+        try {
 
-            core::SQLColAttributeW ( stmt, i + 1, SQL_DESC_NAME, field_name_w, ( SS_MAXCOLNAMELEN + 1 ) * 2, &field_name_len_w, NULL);
+            for( i = 0; i < num_cols; ++i ) {
 
-            //Conversion function expects size in characters
-            field_name_len_w = field_name_len_w / sizeof ( SQLWCHAR );
-            bool converted = convert_string_from_utf16( encoding, field_name_w,
-                field_name_len_w, ( char** ) &field_name, field_name_len );
+                core::SQLColAttributeW ( stmt, i + 1, SQL_DESC_NAME, field_name_w, ( SS_MAXCOLNAMELEN + 1 ) * 2, &field_name_len_w, NULL);
+
+                //Conversion function expects size in characters
+                field_name_len_w = field_name_len_w / sizeof ( SQLWCHAR );
+                bool converted = convert_string_from_utf16( encoding, field_name_w,
+                    field_name_len_w, ( char** ) &field_name, field_name_len );
+
+                CHECK_CUSTOM_ERROR( !converted, stmt, HDB_ERROR_FIELD_ENCODING_TRANSLATE, get_last_error_message() ) {
+                    throw core::CoreException();
+                }
+
+                // the key is shared by every row, so its hash is only computed here
+                zend_string* name = zend_string_init( field_name, field_name_len, 0 );
+                zend_string_hash_val( name );
+                field_name.reset();
+
+                // numeric names become integer keys and a repeated name replaces the earlier field, as with
+                // add_assoc_zval, so only the other keys may be added without a lookup
+                zend_ulong numeric_key = 0;
+                bool add_new = !ZEND_HANDLE_NUMERIC_STR( ZSTR_VAL( name ), ZSTR_LEN( name ), numeric_key );
+                for( int j = 0; add_new && j < i; ++j ) {
+                    if( zend_string_equals( field_names[j].name, name )) {
+                        add_new = false;
+                    }
+                }
 
-            CHECK_CUSTOM_ERROR( !converted, stmt, HDB_ERROR_FIELD_ENCODING_TRANSLATE, get_last_error_message() ) {
-                throw core::CoreException();
+                field_names[i].name = name;
+                field_names[i].add_new = add_new;
             }
+        }
+        catch( core::CoreException& ) {
 
-            field_names[i].name = static_cast<char*>( hdb_malloc( field_name_len, sizeof( char ), 1 ));
-            memcpy_s(( void* )field_names[i].name, ( field_name_len * sizeof( char )) , ( void* ) field_name, field_name_len );
-            field_names[i].name[field_name_len] = '\0';  // null terminate the field name since SQLColAttribute doesn't.
-            field_names[i].len = field_name_len + 1;
-            field_name.reset();
+            for( int j = 0; j < i; ++j ) {
+                zend_string_release( field_names[j].name );
+            }
+            throw;
         }
-		
+
         stmt->fetch_field_names = field_names;
         stmt->fetch_fields_count = num_cols;
         field_names.transferred();
     }
 
-    array_init( &fields );
+    // size the row for all its fields up front.  Numeric only rows are packed arrays.
+    uint32_t table_size = ( fetch_type == HDB_FETCH_BOTH ) ? num_cols * 2 : num_cols;
+    array_init_size( &fields, table_size );
+    zend_hash_real_init( Z_ARRVAL( fields ), ( fetch_type == HDB_FETCH_NUMERIC ) /*packed*/ );
     int zr = SUCCESS ;
-	CHECK_ZEND_ERROR( zr, stmt, HDB_ERROR_ZEND_HASH ) {
-		throw ss::SSException();
-	}
 
 	for( int i = 0; i < num_cols; ++i ) {
 		SQLLEN field_len = -1;
 
-		core_hdb_get_field( stmt, i, hdb_php_type, true /*prefer string*/,
-									field_value, &field_len, false /*cache_field*/, &hdb_php_type_out);
-
 		zval field;
 		ZVAL_UNDEF( &field );
-		convert_to_zval( stmt, hdb_php_type_out, field_value, field_len, field );
-		hdb_free( field_value );
-		if( fetch_type & HDB_FETCH_NUMERIC ) {
 
-			zr = add_next_index_zval( &fields, &field );
-			CHECK_ZEND_ERROR( zr, stmt, HDB_ERROR_ZEND_HASH ) {
+		// ints and floats are returned straight in the zval, everything else goes through a buffer
+		if( !core_hdb_get_scalar_field( stmt, i, hdb_php_type, true /*prefer string*/, field )) {
+
+			core_hdb_get_field( stmt, i, hdb_php_type, true /*prefer string*/,
+										field_value, &field_len, false /*cache_field*/, &hdb_php_type_out);
+			convert_to_zval( stmt, hdb_php_type_out, field_value, field_len, field );
+		}
+		bool add_assoc = false;
+		if( fetch_type & HDB_FETCH_ASSOC ) {
+
+			bool empty_name = ( ZSTR_LEN( stmt->fetch_field_names[i].name ) == 0 );
+			CHECK_CUSTOM_WARNING_AS_ERROR(( empty_name && !allow_empty_field_names ), stmt,
+											SS_HDB_WARNING_FIELD_NAME_EMPTY) {
+				zval_ptr_dtor( &field );
 				throw ss::SSException();
 			}
+
+			add_assoc = ( !empty_name || allow_empty_field_names );
 		}
 
-		if( fetch_type & HDB_FETCH_ASSOC ) {
+		if( fetch_type & HDB_FETCH_NUMERIC ) {
 
-			CHECK_CUSTOM_WARNING_AS_ERROR(( stmt->fetch_field_names[i].len == 1 && !allow_empty_field_names ), stmt,
-											SS_HDB_WARNING_FIELD_NAME_EMPTY) {
+			zr = ( zend_hash_next_index_insert_new( Z_ARRVAL( fields ), &field ) != NULL ) ? SUCCESS : FAILURE;
+			CHECK_ZEND_ERROR( zr, stmt, HDB_ERROR_ZEND_HASH ) {
+				zval_ptr_dtor( &field );
 				throw ss::SSException();
 			}
 
-			if( stmt->fetch_field_names[ i ].len > 1 || allow_empty_field_names ) {
+			//only addref when the field is in the row twice, so that deleting the row releases it
+			if( add_assoc ) {
+				Z_TRY_ADDREF( field );
+			}
+		}
 
-				// zr = add_assoc_zval( &fields, stmt->fetch_field_names[i].name, &field );
-				// CHECK_ZEND_ERROR( zr, stmt, HDB_ERROR_ZEND_HASH ) {
-				// 	throw ss::SSException();
-				// }
+		if( add_assoc ) {
+
+			hdb_fetch_field_name& field_name = stmt->fetch_field_names[i];
+			zval* added = NULL;
+			if( field_name.add_new ) {
+				added = zend_hash_add_new( Z_ARRVAL( fields ), field_name.name, &field );
+			}
+			else {
+				added = zend_symtable_update( Z_ARRVAL( fields ), field_name.name, &field );
+			}
+			zr = ( added != NULL ) ? SUCCESS : FAILURE;
+			CHECK_ZEND_ERROR( zr, stmt, HDB_ERROR_ZEND_HASH ) {
+				zval_ptr_dtor( &field );
+				throw ss::SSException();
 			}
 		}
-		//only addref when the fetch_type is BOTH because this is the only case when fields(hashtable)
-		//has 2 elements pointing to field. Do not addref if the type is NUMERIC or ASSOC because 
-		//fields now only has 1 element pointing to field and we want the ref count to be only 1
-		if (fetch_type == HDB_FETCH_BOTH) {
-			Z_TRY_ADDREF(field);
+		else if( !( fetch_type & HDB_FETCH_NUMERIC )) {
+
+			// the field isn't part of the row
+			zval_ptr_dtor( &field );
 		}
 	} //for loop
 
@@ -318,7 +318,7 @@ ss_error SS_ERRORS[] = {
     {
         HDB_ERROR_INVALID_OPTION_SCROLLABLE,
         { IMSSP, (SQLCHAR*)"The value passed for the 'Scrollable' statement option is invalid.  Please use 'static', 'dynamic', "
-          "'keyset', 'forward', or 'buffered'.", -54, false }
+          "'keyset', 'forward', 'buffered', or 'buffered_columnar'.", -54, false }
     },
  
     {
@@ -362,6 +362,14 @@ ss_error SS_ERRORS[] = {
         SS_HDB_ERROR_AE_QUERY_SQLTYPE_REQUIRED,
         { IMSSP, (SQLCHAR*)"Must specify the SQL type for each parameter in a parameterized query when using hdb_query in a column encryption enabled connection.", -63, false }
     },
+    {
+        SS_HDB_ERROR_INVALID_MAX_ROWS,
+        { IMSSP, (SQLCHAR*)"The maximum number of rows passed to hdb_fetch_all must be zero or a positive integer.", -64, false }
+    },
+    {
+        SS_HDB_ERROR_INVALID_STMT_CACHE_SIZE,
+        { IMSSP, (SQLCHAR*)"The StatementCacheSize connection option must be zero or a positive integer.", -65, false }
+    },
 
     // internal warning definitions
     {
@@ -408,6 +416,34 @@ ss_error SS_ERRORS[] = {
         HDB_ERROR_KEYSTORE_INVALID_VALUE,
         { IMSSP, (SQLCHAR*) "Invalid value for loading Azure Key Vault.", -114, false}
     },
+    {
+        HDB_ERROR_BATCH_ROW_INVALID,
+        { IMSSP, (SQLCHAR*) "Row %1!d! of the batch must be an array holding a value for each of the %2!d! parameters of the statement.", -115, true }
+    },
+    {
+        HDB_ERROR_BATCH_PARAM_INVALID_TYPE,
+        { IMSSP, (SQLCHAR*) "An invalid PHP type for parameter %1!d! in row %2!d! of the batch was specified.  Only null, boolean, integer, float and string values can be sent in a batch.", -116, true }
+    },
+    {
+        HDB_ERROR_ASYNC_STILL_EXECUTING,
+        { IMSSP, (SQLCHAR*) "The statement is still executing.  Call hdb_poll or hdb_wait until the execution completes.", -117, false }
+    },
+    {
+        HDB_ERROR_STREAM_WRITE,
+        { IMSSP, (SQLCHAR*) "Failed to write the field to the stream.", -118, false }
+    },
+    {
+        HDB_ERROR_INVALID_STREAM_CHUNK_SIZE,
+        { IMSSP, (SQLCHAR*) "Invalid value specified for option StreamChunkSize.  It must be an integer from 1 to %1!d!.", -119, true }
+    },
+    {
+        HDB_ERROR_INVALID_PREFETCH_ROWS,
+        { IMSSP, (SQLCHAR*) "Invalid value specified for option PrefetchRows.  It must be an integer from 1 to %1!d!.", -120, true }
+    },
+    {
+        HDB_ERROR_ASYNC_STREAM_PARAMS,
+        { IMSSP, (SQLCHAR*) "A statement with stream parameters can't be executed asynchronously.  Use hdb_execute instead.", -121, false }
+    },
 
     // terminate the list of errors/warnings
     { UINT_MAX, {} }
@@ -0,0 +1,110 @@
+<?php
+// Executes a slow query with hdb_execute_async and polls it until it completes, then
+// fetches its rows.  While it's still running, a second execution, a fetch and reading
+// a field of the row fetched by an earlier execution on the same statement must fail
+// with error -117, and a statement with a stream parameter must be refused with error
+// -121.
+$server = 'localhost:30515';
+$uid = 'SYSTEM';
+$pwd = 'manager';
+
+$options = array("UID"=>$uid, "PWD"=>$pwd);
+$conn = hdb_connect($server, $options);
+if($conn === false) {
+    die(print_r(hdb_errors(), true));
+
+}
+
+function expect_error($result, $code, $what) {
+    $errors = hdb_errors();
+    if($result !== false || $errors === null || $errors[0]['code'] != $code) {
+        echo "$what: expected error $code\n";
+        die(print_r($errors, true));
+    }
+    echo "$what: error $code as expected\n";
+}
+
+// the cross join keeps the server busy long enough to be polled a few times
+$query = "SELECT COUNT(*) AS N FROM SYS.OBJECTS A, SYS.OBJECTS B, SYS.OBJECTS C";
+$stmt = hdb_prepare($conn, $query);
+if($stmt === false) {
+    die(print_r(hdb_errors(), true));
+
+}
+
+// run it synchronously and fetch its row first, so there is a row from an earlier
+// execution while the asynchronous one runs
+if(hdb_execute($stmt) === false || hdb_fetch($stmt) !== true) {
+    die(print_r(hdb_errors(), true));
+
+}
+
+if(hdb_execute_async($stmt) === false) {
+    die(print_r(hdb_errors(), true));
+
+}
+
+$polls = 0;
+while(($done = hdb_poll($stmt)) === null) {
+
+    // the statement can't be used while the execution is in progress
+    if($polls == 0) {
+        expect_error(hdb_execute($stmt), -117, "hdb_execute while executing");
+        expect_error(hdb_execute_async($stmt), -117, "hdb_execute_async while executing");
+        expect_error(hdb_fetch($stmt), -117, "hdb_fetch while executing");
+        expect_error(hdb_get_field($stmt, 0), -117, "hdb_get_field while executing");
+        $out = fopen('php://memory', 'w+b');
+        expect_error(hdb_copy_field_to_stream($stmt, 0, $out), -117, "hdb_copy_field_to_stream while executing");
+        fclose($out);
+    }
+    ++$polls;
+    usleep(1000);
+}
+if($done === false) {
+    die(print_r(hdb_errors(), true));
+
+}
+if($polls == 0) {
+    echo "Execution completed before it was polled, so the calls while executing weren't tried.\n";
+}
+echo "Execution completed after $polls polls.\n";
+
+while($row = hdb_fetch_array($stmt)) {
+    echo "N: ".$row['N']."\n";
+}
+hdb_free_stmt($stmt);
+
+// stream parameters are sent while the execution waits for them, which can't be done asynchronously
+$tableName = 'PHP_ASYNC_TEST';
+hdb_query($conn, "DROP TABLE $tableName");
+$stmt = hdb_query($conn, "CREATE COLUMN TABLE $tableName (ID int, DATA BLOB)");
+if($stmt === false) {
+    die(print_r(hdb_errors(), true));
+
+}
+hdb_free_stmt($stmt);
+
+$data = fopen('php://memory', 'w+b');
+fwrite($data, str_repeat('x', 1024));
+rewind($data);
+$params = array(1, array($data, HDB_PARAM_IN, HDB_PHPTYPE_STREAM(HDB_ENC_BINARY), HDB_SQLTYPE_IMAGE));
+$stmt = hdb_prepare($conn, "INSERT INTO $tableName (ID, DATA) VALUES (?, ?)", $params);
+if($stmt === false) {
+    die(print_r(hdb_errors(), true));
+
+}
+expect_error(hdb_execute_async($stmt), -121, "hdb_execute_async with a stream parameter");
+
+// the same statement still executes synchronously
+rewind($data);
+if(hdb_execute($stmt) === false) {
+    die(print_r(hdb_errors(), true));
+
+}
+echo "Statement with a stream parameter executed.\n";
+hdb_free_stmt($stmt);
+fclose($data);
+
+hdb_query($conn, "DROP TABLE $tableName");
+hdb_close($conn);
+?>
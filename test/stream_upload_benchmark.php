@@ -0,0 +1,62 @@
+<?php
+// Measures the upload throughput of a BLOB stream parameter for a range of
+// StreamChunkSize values.  Each chunk size inserts the same file, read from
+// php://temp, and the rows report the chunk size, the seconds taken and MB/s.
+//
+// php stream_upload_benchmark.php [blob size in MB]
+$server = 'localhost:30515';
+$uid = 'SYSTEM';
+$pwd = 'manager';
+
+$blobSize = (isset($argv[1]) ? (int)$argv[1] : 200) * 1024 * 1024;
+$chunkSizes = array(8192, 32768, 131072, 524288, 1048576, 4194304);
+
+$options = array("UID"=>$uid, "PWD"=>$pwd);
+$conn = hdb_connect($server, $options);
+if($conn === false) {
+    die(print_r(hdb_errors(), true));
+
+}
+
+$tableName = 'PHP_STREAM_UPLOAD_TEST';
+hdb_query($conn, "DROP TABLE $tableName");
+$stmt = hdb_query($conn, "CREATE COLUMN TABLE $tableName (ID int, DATA BLOB)");
+if($stmt === false) {
+    die(print_r(hdb_errors(), true));
+
+}
+hdb_free_stmt($stmt);
+
+// build the data once, 1 MB at a time
+$data = fopen('php://temp', 'w+b');
+$block = random_bytes(1024 * 1024);
+for($written = 0; $written < $blobSize; $written += strlen($block)) {
+    fwrite($data, substr($block, 0, $blobSize - $written));
+}
+
+printf("%12s %10s %10s\n", "chunk size", "seconds", "MB/s");
+foreach($chunkSizes as $id => $chunkSize) {
+    rewind($data);
+    $params = array($id, array($data, HDB_PARAM_IN, HDB_PHPTYPE_STREAM(HDB_ENC_BINARY), HDB_SQLTYPE_IMAGE));
+    $stmt = hdb_prepare($conn, "INSERT INTO $tableName (ID, DATA) VALUES (?, ?)", $params,
+                        array("StreamChunkSize"=>$chunkSize));
+    if($stmt === false) {
+        die(print_r(hdb_errors(), true));
+
+    }
+
+    $start = microtime(true);
+    if(hdb_execute($stmt) === false) {
+        die(print_r(hdb_errors(), true));
+
+    }
+    $seconds = microtime(true) - $start;
+    hdb_free_stmt($stmt);
+
+    printf("%12d %10.3f %10.1f\n", $chunkSize, $seconds, $blobSize / (1024 * 1024) / $seconds);
+}
+
+fclose($data);
+hdb_query($conn, "DROP TABLE $tableName");
+hdb_close($conn);
+?>